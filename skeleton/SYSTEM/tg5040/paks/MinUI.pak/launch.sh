@@ -151,6 +151,8 @@ cd $(dirname "$0")
 
 EXEC_PATH="/tmp/nextui_exec"
 NEXT_PATH="/tmp/next"
+WARM_PID_PATH="/tmp/minarch_warm.pid"
+rm -f /tmp/minarch.sock "$WARM_PID_PATH" # nothing from a previous boot is listening
 touch "$EXEC_PATH"  && sync
 while [ -f $EXEC_PATH ]; do
 	nextui.elf &> $LOGS_PATH/nextui.txt
@@ -161,6 +163,15 @@ while [ -f $EXEC_PATH ]; do
 		eval $CMD
 		rm -f $NEXT_PATH
 		echo $CPU_SPEED_PERF > $CPU_PATH
+		
+		# keep one minarch exec'd and idling so the next game skips loading it,
+		# it leaves the display, audio and cpu to nextui until then (see
+		# Warm_request in minarch.c)
+		if ! kill -0 `cat "$WARM_PID_PATH" 2> /dev/null` 2> /dev/null; then
+			rm -f /tmp/minarch.sock
+			(HOME="$USERDATA_PATH"; cd "$HOME"; exec minarch.elf --warm) &> $LOGS_PATH/minarch_warm.txt &
+			echo $! > "$WARM_PID_PATH"
+		fi
 	fi
 
 	if [ -f "/tmp/poweroff" ]; then
@@ -0,0 +1,38 @@
+// scanline and grid screen effects, drawn over the game rect with no image
+// assets. coverage is integrated across each screen pixel so fractional
+// scales stay even instead of beating against the game's pixels
+#if defined(VERTEX)
+attribute vec2 VertexCoord;
+attribute vec2 TexCoord;
+uniform vec2 OutputSize;
+uniform vec2 EffectScale; // screen pixels per game pixel
+varying vec2 vPixel;
+varying vec2 vInverse;
+
+void main() {
+    vPixel = vec2(TexCoord.x, 1.0 - TexCoord.y) * OutputSize; // top left of the game rect is 0,0
+    vInverse = 1.0 / EffectScale;
+    gl_Position = vec4(VertexCoord, 0.0, 1.0);
+}
+#endif
+
+#if defined(FRAGMENT)
+uniform vec2 EffectScale;
+uniform vec2 EffectBand; // dark width at the start of every cell, 0 to skip an axis
+uniform float EffectIntensity;
+uniform vec3 EffectColor;
+varying vec2 vPixel;
+varying vec2 vInverse;
+
+// length of [0,x) inside the band of every cell
+vec2 covered(vec2 x) {
+    vec2 cell = floor(x * vInverse);
+    return cell * EffectBand + min(x - cell * EffectScale, EffectBand);
+}
+
+void main() {
+    vec2 p = floor(vPixel);
+    vec2 dark = covered(p + 1.0) - covered(p);
+    gl_FragColor = vec4(EffectColor, (dark.x + dark.y - dark.x * dark.y) * EffectIntensity);
+}
+#endif
@@ -0,0 +1,40 @@
+// lcd subpixel screen effect, multiplied over the game rect: one stripe per
+// channel across each game pixel and a dark gap between rows
+#if defined(VERTEX)
+attribute vec2 VertexCoord;
+attribute vec2 TexCoord;
+uniform vec2 OutputSize;
+uniform vec2 EffectScale; // screen pixels per game pixel
+varying vec2 vPixel;
+varying vec2 vInverse;
+
+void main() {
+    vPixel = vec2(TexCoord.x, 1.0 - TexCoord.y) * OutputSize; // top left of the game rect is 0,0
+    vInverse = 1.0 / EffectScale;
+    gl_Position = vec4(VertexCoord, 0.0, 1.0);
+}
+#endif
+
+#if defined(FRAGMENT)
+uniform vec2 EffectScale;
+uniform vec2 EffectBand; // x is the stripe width, y the gap between rows
+uniform float EffectIntensity;
+uniform float EffectLayout; // 0 rgb, 1 bgr
+varying vec2 vPixel;
+varying vec2 vInverse;
+
+// length of [0,x) inside the band of every cell
+vec2 covered(vec2 x) {
+    vec2 cell = floor(x * vInverse);
+    return cell * EffectBand + min(x - cell * EffectScale, EffectBand);
+}
+
+void main() {
+    vec2 p = floor(vPixel);
+    vec2 first = covered(p + 1.0) - covered(p);
+    vec2 second = covered(p + 1.0 - EffectBand.x) - covered(p - EffectBand.x);
+    float third = 1.0 - first.x - second.x;
+    vec3 lit = EffectLayout > 0.5 ? vec3(third, second.x, first.x) : vec3(first.x, second.x, third);
+    gl_FragColor = vec4(mix(vec3(1.0), lit * (1.0 - first.y), EffectIntensity), 1.0);
+}
+#endif
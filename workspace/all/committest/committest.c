@@ -0,0 +1,172 @@
+// checks that commitFile and putFileDurable replace a file atomically and
+// times them against what saves used to do (write in place, then sync()).
+// a writer process is killed at random points mid-save and the file must
+// then hold one complete version, old or new, never a mix. run it on the
+// card the saves live on:
+//   committest.elf [dir] [kills]   (defaults to /mnt/SDCARD/.userdata and 200)
+// killing the process doesn't lose the page cache so this covers crashes
+// and force quits, pulling the power needs a person and a stopwatch
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/wait.h>
+
+#include "defines.h"
+#include "utils.h"
+
+#define VERSION_SIZE (256 * 1024) // about a large sram or a small state
+#define VERSION_MAGIC 0x54494D43 // CMIT
+#define TIMED_WRITES 20
+
+enum {
+	WRITER_PUT_DURABLE,
+	WRITER_COMMIT, // stdio to the .tmp, then commitFile
+	WRITER_IN_PLACE, // the old way, should tear, shows the check works
+	WRITER_COUNT,
+};
+static const char* writer_names[] = {"putFileDurable", "commitFile", "in place (control)"};
+
+typedef struct VersionHeader {
+	uint32_t magic;
+	uint32_t generation;
+	uint32_t size;
+} VersionHeader;
+
+static uint8_t* version;
+
+static void fillVersion(uint32_t generation) {
+	VersionHeader* header = (VersionHeader*)version;
+	header->magic = VERSION_MAGIC;
+	header->generation = generation;
+	header->size = VERSION_SIZE;
+	for (int i=sizeof(VersionHeader); i<VERSION_SIZE; i++) {
+		version[i] = (generation * 31 + i) & 0xFF;
+	}
+}
+
+static int writeVersion(int writer, const char* path) {
+	if (writer==WRITER_PUT_DURABLE) return putFileDurable(path, version, VERSION_SIZE);
+	
+	char tmp_path[MAX_PATH];
+	if (writer==WRITER_COMMIT) getTempPath(path, tmp_path);
+	FILE* file = fopen(writer==WRITER_COMMIT ? tmp_path : path, "wb");
+	if (!file) return 0;
+	int ok = fwrite(version, 1, VERSION_SIZE, file)==VERSION_SIZE;
+	if (fclose(file)) ok = 0;
+	if (writer==WRITER_COMMIT) return ok && commitFile(tmp_path, path);
+	sync();
+	return ok;
+}
+
+// returns the generation in path, -1 if it's torn
+static int readVersion(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (!file) return -1;
+	uint8_t* contents = malloc(VERSION_SIZE + 1);
+	size_t size = fread(contents, 1, VERSION_SIZE + 1, file);
+	fclose(file);
+	
+	int generation = -1;
+	VersionHeader* header = (VersionHeader*)contents;
+	if (size==VERSION_SIZE && header->magic==VERSION_MAGIC && header->size==VERSION_SIZE) {
+		generation = header->generation;
+		for (int i=sizeof(VersionHeader); i<VERSION_SIZE; i++) {
+			if (contents[i]!=((generation * 31 + i) & 0xFF)) {
+				generation = -1;
+				break;
+			}
+		}
+	}
+	free(contents);
+	return generation;
+}
+
+static void writeForever(int writer, const char* path) {
+	for (uint32_t generation=1;; generation++) {
+		fillVersion(generation);
+		if (!writeVersion(writer, path)) {
+			fprintf(stderr, "write failed: %s\n", strerror(errno));
+			_exit(EXIT_FAILURE);
+		}
+	}
+}
+
+// kills a writer kills times, returns how many left a torn file behind
+static int killWriters(int writer, const char* path, int kills) {
+	fillVersion(0);
+	writeVersion(WRITER_PUT_DURABLE, path);
+	
+	int torn = 0;
+	int last = 0;
+	for (int i=0; i<kills; i++) {
+		pid_t pid = fork();
+		if (pid<0) {
+			perror("fork");
+			exit(EXIT_FAILURE);
+		}
+		if (pid==0) writeForever(writer, path);
+		
+		usleep(1000 + rand() % 50000);
+		kill(pid, SIGKILL);
+		waitpid(pid, NULL, 0);
+		
+		int generation = readVersion(path);
+		if (generation<0) {
+			torn += 1;
+			// start the next round from something whole
+			fillVersion(0);
+			writeVersion(WRITER_PUT_DURABLE, path);
+		}
+		else last = generation;
+	}
+	printf("%-20s %i/%i kills left a torn file (last whole generation %i)\n", writer_names[writer], torn, kills, last);
+	return torn;
+}
+
+static void timeWriters(const char* path) {
+	for (int writer=0; writer<WRITER_COUNT; writer++) {
+		uint64_t slowest = 0;
+		uint64_t total = 0;
+		for (int i=0; i<TIMED_WRITES; i++) {
+			fillVersion(i);
+			uint64_t start = getMicroseconds();
+			writeVersion(writer, path);
+			uint64_t elapsed = getMicroseconds() - start;
+			total += elapsed;
+			if (elapsed>slowest) slowest = elapsed;
+		}
+		printf("%-20s avg %6.2fms  worst %6.2fms per %ikB save\n", writer_names[writer],
+			total / 1000.0 / TIMED_WRITES, slowest / 1000.0, VERSION_SIZE / 1024);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const char* dir = argc>1 ? argv[1] : SDCARD_PATH "/.userdata";
+	int kills = argc>2 ? atoi(argv[2]) : 200;
+	
+	char path[MAX_PATH];
+	char tmp_path[MAX_PATH];
+	snprintf(path, sizeof(path), "%s/committest.bin", dir);
+	getTempPath(path, tmp_path);
+	
+	version = malloc(VERSION_SIZE);
+	if (!version) return EXIT_FAILURE;
+	srand(getpid());
+	
+	int torn = 0;
+	for (int writer=0; writer<WRITER_COUNT; writer++) {
+		int count = killWriters(writer, path, kills);
+		if (writer!=WRITER_IN_PLACE) torn += count;
+	}
+	timeWriters(path);
+	
+	unlink(path);
+	unlink(tmp_path);
+	free(version);
+	return torn ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -218,6 +218,10 @@ int currentshaderdstw = 0;
 int currentshaderdsth = 0;
 int currentshadertexw = 0;
 int currentshadertexh = 0;
+int currentglcalls = 0;
+int currentgluniforms = 0;
+int currentgldraws = 0;
+char currentframetimings[128] = "";
 
 int currentbuffersize = 0;
 int currentsampleratein = 0;
@@ -235,11 +239,381 @@ FALLBACK_IMPLEMENTATION void PLAT_getCPUTemp()
 	currentcputemp = 0;
 }
 
+///////////////////////////////
+
+// glyph atlas, the system fonts keep every glyph they've drawn in a white
+// sheet along with its metrics. measuring becomes a sum of cached advances
+// and kerning, drawing copies coverage out of the sheet instead of
+// rasterizing the whole string again. only the basic multilingual plane is
+// cached, other fonts and strings fall back to SDL_ttf. a sheet stops growing
+// at ATLAS_MAX_HEIGHT, glyphs that don't fit after that (a long cjk rom list)
+// are left to SDL_ttf too
+
+#define ATLAS_WIDTH 1024
+#define ATLAS_MAX_HEIGHT 1024 // 4MB per font
+#define ATLAS_KERNING 256 // direct mapped pair cache
+
+typedef struct Glyph
+{
+	SDL_Rect rect; // in the sheet, origin already shifted like SDL_ttf does
+	int minx;
+	int maxx;
+	int advance;
+	int state; // 0 not loaded, 1 cached, -1 needs SDL_ttf
+} Glyph;
+
+typedef struct GlyphAtlas
+{
+	TTF_Font *font; // NULL until first used
+	int disabled;	// layout didn't match SDL_ttf for this font
+	int kerning;
+	int height;
+	SDL_Surface *sheet; // ARGB8888, white with coverage in alpha
+	int shelf_x;
+	int shelf_y;
+	Glyph *pages[256]; // 256 codepoints each, allocated on first use
+	struct
+	{
+		uint32_t pair; // prev << 16 | ch, 0 when empty
+		int offset;
+	} kerning_pairs[ATLAS_KERNING];
+} GlyphAtlas;
+
+typedef struct TextRun
+{
+	int pen;
+	int minx;
+	int maxx;
+	uint16_t prev;
+} TextRun;
+
+static GlyphAtlas atlases[5]; // one per system font
+static SDL_mutex *atlas_lock;
+static struct
+{
+	int glyphs;
+	int strings;
+	int fallbacks;
+	int overflows; // glyphs a full sheet had no room for
+} atlas_stats;
+
+// the stats are shared by every thread that draws text, for callers not holding atlas_lock
+static void GlyphAtlas_countFallback(void)
+{
+	if (atlas_lock)
+		SDL_LockMutex(atlas_lock);
+	atlas_stats.fallbacks += 1;
+	if (atlas_lock)
+		SDL_UnlockMutex(atlas_lock);
+}
+
+static void GlyphAtlas_free(GlyphAtlas *atlas)
+{
+	if (atlas->sheet)
+		SDL_FreeSurface(atlas->sheet);
+	for (int i = 0; i < 256; i++)
+		free(atlas->pages[i]);
+	memset(atlas, 0, sizeof(*atlas));
+}
+
+static void GlyphAtlas_freeAll(void)
+{
+	if (atlas_stats.strings)
+		LOG_info("Text: %i strings from %i cached glyphs, %i through SDL_ttf (%i glyphs didn't fit)\n", atlas_stats.strings, atlas_stats.glyphs, atlas_stats.fallbacks, atlas_stats.overflows);
+	for (int i = 0; i < 5; i++)
+		GlyphAtlas_free(&atlases[i]);
+}
+
+// returns the next codepoint and advances str, 0xFFFF for anything outside the bmp or malformed
+static uint32_t GlyphAtlas_decode(const char **str)
+{
+	const unsigned char *s = (const unsigned char *)*str;
+	uint32_t ch;
+	int extra;
+	if (s[0] < 0x80)
+	{
+		*str += 1;
+		return s[0];
+	}
+	else if ((s[0] & 0xE0) == 0xC0)
+	{
+		ch = s[0] & 0x1F;
+		extra = 1;
+	}
+	else if ((s[0] & 0xF0) == 0xE0)
+	{
+		ch = s[0] & 0x0F;
+		extra = 2;
+	}
+	else
+	{
+		*str += 1;
+		return 0xFFFF;
+	}
+
+	for (int i = 1; i <= extra; i++)
+	{
+		if ((s[i] & 0xC0) != 0x80)
+		{
+			*str += i;
+			return 0xFFFF;
+		}
+		ch = (ch << 6) | (s[i] & 0x3F);
+	}
+	*str += extra + 1;
+	return ch;
+}
+
+static Glyph *GlyphAtlas_glyph(GlyphAtlas *atlas, uint32_t ch)
+{
+	if (ch >= 0xFFFF)
+		return NULL;
+
+	Glyph **page = &atlas->pages[ch >> 8];
+	if (!*page)
+		*page = calloc(256, sizeof(Glyph));
+	if (!*page)
+		return NULL;
+
+	Glyph *glyph = &(*page)[ch & 0xFF];
+	if (glyph->state)
+		return glyph->state > 0 ? glyph : NULL;
+
+	glyph->state = -1;
+	int miny, maxy;
+	if (!TTF_GlyphIsProvided(atlas->font, ch) || TTF_GlyphMetrics(atlas->font, ch, &glyph->minx, &glyph->maxx, &miny, &maxy, &glyph->advance) < 0)
+		return NULL;
+
+	// rendered like a one character string so the glyph's origin
+	// sits at -min(0,minx), same as it would inside a longer one
+	SDL_Surface *rendered = TTF_RenderGlyph_Blended(atlas->font, ch, (SDL_Color){255, 255, 255, 255});
+	if (rendered)
+	{
+		int w = rendered->w;
+		int h = rendered->h < atlas->height ? rendered->h : atlas->height;
+		if (w > ATLAS_WIDTH)
+		{
+			SDL_FreeSurface(rendered);
+			return NULL;
+		}
+		if (atlas->shelf_x + w > ATLAS_WIDTH)
+		{
+			atlas->shelf_x = 0;
+			atlas->shelf_y += atlas->height;
+		}
+		if (!atlas->sheet || atlas->shelf_y + atlas->height > atlas->sheet->h)
+		{
+			int sheet_h = atlas->sheet ? atlas->sheet->h * 2 : atlas->height * 8;
+			if (sheet_h > ATLAS_MAX_HEIGHT)
+				sheet_h = ATLAS_MAX_HEIGHT;
+			if (atlas->shelf_y + atlas->height > sheet_h)
+			{
+				SDL_FreeSurface(rendered);
+				atlas_stats.overflows += 1;
+				return NULL;
+			}
+			SDL_Surface *sheet = SDL_CreateRGBSurfaceWithFormat(0, ATLAS_WIDTH, sheet_h, 32, SDL_PIXELFORMAT_ARGB8888);
+			if (!sheet)
+			{
+				SDL_FreeSurface(rendered);
+				return NULL;
+			}
+			SDL_FillRect(sheet, NULL, 0x00FFFFFF);
+			if (atlas->sheet)
+			{
+				SDL_SetSurfaceBlendMode(atlas->sheet, SDL_BLENDMODE_NONE);
+				SDL_BlitSurface(atlas->sheet, NULL, sheet, NULL);
+				SDL_FreeSurface(atlas->sheet);
+			}
+			atlas->sheet = sheet;
+		}
+
+		glyph->rect = (SDL_Rect){atlas->shelf_x, atlas->shelf_y, w, h};
+		SDL_SetSurfaceBlendMode(rendered, SDL_BLENDMODE_NONE);
+		SDL_BlitSurface(rendered, &(SDL_Rect){0, 0, w, h}, atlas->sheet, &(SDL_Rect){glyph->rect.x, glyph->rect.y});
+		SDL_FreeSurface(rendered);
+		atlas->shelf_x += w;
+	}
+	glyph->state = 1;
+	atlas_stats.glyphs += 1;
+	return glyph;
+}
+
+// lays out one more glyph, returns the x its rendered cell starts at
+static int TextRun_add(GlyphAtlas *atlas, TextRun *run, uint16_t ch, Glyph *glyph)
+{
+	if (run->prev && atlas->kerning)
+	{
+		uint32_t pair = (run->prev << 16) | ch;
+		int slot = (pair ^ (pair >> 13)) % ATLAS_KERNING;
+		if (atlas->kerning_pairs[slot].pair != pair)
+		{
+			atlas->kerning_pairs[slot].pair = pair;
+			atlas->kerning_pairs[slot].offset = TTF_GetFontKerningSizeGlyphs(atlas->font, run->prev, ch);
+		}
+		run->pen += atlas->kerning_pairs[slot].offset;
+	}
+
+	int left = run->pen + glyph->minx;
+	int right = run->pen + (glyph->advance > glyph->maxx ? glyph->advance : glyph->maxx);
+	if (left < run->minx)
+		run->minx = left;
+	if (right > run->maxx)
+		run->maxx = right;
+
+	int x = run->pen + (glyph->minx < 0 ? glyph->minx : 0);
+	run->pen += glyph->advance;
+	run->prev = ch;
+	return x;
+}
+
+// returns 0 if str needs SDL_ttf, stops after len bytes (or at the end when negative)
+static int GlyphAtlas_layout(GlyphAtlas *atlas, TextRun *run, const char *str, int len)
+{
+	const char *end = len < 0 ? NULL : str + len;
+	while (*str && (!end || str < end))
+	{
+		uint32_t ch = GlyphAtlas_decode(&str);
+		Glyph *glyph = GlyphAtlas_glyph(atlas, ch);
+		if (!glyph)
+			return 0;
+		TextRun_add(atlas, run, ch, glyph);
+	}
+	return 1;
+}
+
+// NULL for fonts and strings that go through SDL_ttf, locks atlas_lock on success
+static GlyphAtlas *GlyphAtlas_get(TTF_Font *ttf)
+{
+	TTF_Font *fonts[5] = {font.large, font.medium, font.small, font.tiny, font.micro};
+	int i;
+	for (i = 0; i < 5; i++)
+	{
+		if (ttf && fonts[i] == ttf)
+			break;
+	}
+	if (i == 5 || !atlas_lock)
+		return NULL;
+
+	SDL_LockMutex(atlas_lock);
+	GlyphAtlas *atlas = &atlases[i];
+	if (atlas->font != ttf)
+	{
+		GlyphAtlas_free(atlas);
+		atlas->font = ttf;
+		atlas->height = TTF_FontHeight(ttf);
+		atlas->kerning = TTF_GetFontKerning(ttf);
+
+		// SDL_ttf's own layout rules vary between versions (bold
+		// overhang mostly), so make sure ours agrees before using it
+		const char *sample = "Wave Tokyo, AV 0123456789 ...";
+		TextRun run = {0};
+		int w = 0;
+		TTF_SizeUTF8(ttf, sample, &w, NULL);
+		if (!GlyphAtlas_layout(atlas, &run, sample, -1) || run.maxx - run.minx != w)
+		{
+			LOG_info("Text: glyph layout doesn't match SDL_ttf for %ipx font, using SDL_ttf\n", atlas->height);
+			atlas->disabled = 1;
+		}
+	}
+	if (atlas->disabled)
+	{
+		SDL_UnlockMutex(atlas_lock);
+		return NULL;
+	}
+	return atlas;
+}
+
+int GFX_sizeUTF8(TTF_Font *ttf, const char *str, int *w, int *h)
+{
+	GlyphAtlas *atlas = GlyphAtlas_get(ttf);
+	if (atlas)
+	{
+		TextRun run = {0};
+		int ok = GlyphAtlas_layout(atlas, &run, str, -1);
+		if (ok)
+		{
+			if (w)
+				*w = run.maxx - run.minx;
+			if (h)
+				*h = atlas->height;
+		}
+		SDL_UnlockMutex(atlas_lock);
+		if (ok)
+			return 0;
+	}
+	return TTF_SizeUTF8(ttf, str, w, h);
+}
+
+SDL_Surface *GFX_renderUTF8(TTF_Font *ttf, const char *str, SDL_Color color)
+{
+	GlyphAtlas *atlas = GlyphAtlas_get(ttf);
+	if (!atlas)
+	{
+		GlyphAtlas_countFallback();
+		return TTF_RenderUTF8_Blended(ttf, str, color);
+	}
+
+	TextRun run = {0};
+	SDL_Surface *text = NULL;
+	if (GlyphAtlas_layout(atlas, &run, str, -1) && run.maxx > run.minx)
+		text = SDL_CreateRGBSurfaceWithFormat(0, run.maxx - run.minx, atlas->height, 32, SDL_PIXELFORMAT_ARGB8888);
+	if (!text)
+	{
+		atlas_stats.fallbacks += 1;
+		SDL_UnlockMutex(atlas_lock);
+		return TTF_RenderUTF8_Blended(ttf, str, color);
+	}
+
+	// all glyphs share one colour so overlaps just keep the strongest coverage
+	uint32_t rgb = (color.r << 16) | (color.g << 8) | color.b;
+	SDL_FillRect(text, NULL, rgb);
+	int origin = run.minx;
+	run = (TextRun){0};
+	while (*str)
+	{
+		uint32_t ch = GlyphAtlas_decode(&str);
+		Glyph *glyph = GlyphAtlas_glyph(atlas, ch);
+		int x = TextRun_add(atlas, &run, ch, glyph) - origin;
+		for (int y = 0; y < glyph->rect.h; y++)
+		{
+			uint32_t *src = (uint32_t *)((uint8_t *)atlas->sheet->pixels + (glyph->rect.y + y) * atlas->sheet->pitch) + glyph->rect.x;
+			uint32_t *dst = (uint32_t *)((uint8_t *)text->pixels + y * text->pitch) + x;
+			int w = glyph->rect.w;
+			if (x < 0)
+			{
+				src -= x;
+				w += x;
+				dst -= x;
+			}
+			if (x + glyph->rect.w > text->w)
+				w -= x + glyph->rect.w - text->w;
+			for (int i = 0; i < w; i++)
+			{
+				uint32_t a = src[i] >> 24;
+				if (color.a != 255)
+					a = a * color.a / 255;
+				if (a > dst[i] >> 24)
+					dst[i] = (a << 24) | rgb;
+			}
+		}
+	}
+	atlas_stats.strings += 1;
+	SDL_UnlockMutex(atlas_lock);
+	return text;
+}
+
 int GFX_loadSystemFont(const char *fontPath)
 {
 	// Load/Reload fonts
 	if (!TTF_WasInit())
 		TTF_Init();
+	if (!atlas_lock)
+		atlas_lock = SDL_CreateMutex();
+
+	SDL_LockMutex(atlas_lock);
+	GlyphAtlas_freeAll();
+	SDL_UnlockMutex(atlas_lock);
 
 	TTF_CloseFont(font.large);
 	TTF_CloseFont(font.medium);
@@ -367,6 +741,9 @@ SDL_Surface *GFX_init(int mode)
 }
 void GFX_quit(void)
 {
+	SDL_LockMutex(atlas_lock);
+	GlyphAtlas_freeAll();
+	SDL_UnlockMutex(atlas_lock);
 
 	TTF_CloseFont(font.large);
 	TTF_CloseFont(font.medium);
@@ -749,14 +1126,59 @@ void GFX_delay(void)
 
 FALLBACK_IMPLEMENTATION int PLAT_supportsOverscan(void) { return 0; }
 FALLBACK_IMPLEMENTATION void PLAT_setEffectColor(int next_color) {}
+FALLBACK_IMPLEMENTATION void PLAT_warmShader(const char* filename) {}
+FALLBACK_IMPLEMENTATION int PLAT_setShaderPreset(const char* path) { return path ? -1 : 0; }
+FALLBACK_IMPLEMENTATION void PLAT_setFrameTimings(int enabled) {}
+FALLBACK_IMPLEMENTATION void PLAT_surfaceChanged(SDL_Surface* surface) {}
+FALLBACK_IMPLEMENTATION void PLAT_getLayerStats(LayerStats* stats) { memset(stats, 0, sizeof(*stats)); }
 
 int GFX_truncateText(TTF_Font *font, const char *in_name, char *out_name, int max_width, int padding)
 {
 	int text_width;
 	strncpy(out_name, in_name, MAX_PATH - 1);
 	out_name[MAX_PATH - 1] = '\0';
-	TTF_SizeUTF8(font, out_name, &text_width, NULL);
+	GFX_sizeUTF8(font, out_name, &text_width, NULL);
 	text_width += padding;
+	if (text_width <= max_width)
+		return text_width;
+
+	// one pass over the glyphs, keeping the longest prefix that still fits with
+	// the ellipsis. like the loop below the ellipsis replaces at least 4 bytes
+	GlyphAtlas *atlas = GlyphAtlas_get(font);
+	if (atlas)
+	{
+		Glyph *dot = GlyphAtlas_glyph(atlas, '.');
+		int len = strlen(out_name);
+		int cut = -1;
+		TextRun run = {0};
+		const char *str = out_name;
+		while (dot && (str == out_name || str - out_name <= len - 4))
+		{
+			TextRun ellipsis = run;
+			for (int i = 0; i < 3; i++)
+				TextRun_add(atlas, &ellipsis, '.', dot);
+			int width = ellipsis.maxx - ellipsis.minx + padding;
+			if (cut >= 0 && width > max_width)
+				break;
+			cut = str - out_name;
+			text_width = width;
+
+			uint32_t ch = GlyphAtlas_decode(&str);
+			Glyph *glyph = GlyphAtlas_glyph(atlas, ch);
+			if (!glyph)
+			{
+				cut = -1; // needs SDL_ttf after all
+				break;
+			}
+			TextRun_add(atlas, &run, ch, glyph);
+		}
+		SDL_UnlockMutex(atlas_lock);
+		if (cut >= 0)
+		{
+			strcpy(&out_name[cut], "...");
+			return text_width;
+		}
+	}
 
 	while (text_width > max_width)
 	{
@@ -776,7 +1198,7 @@ int GFX_getTextHeight(TTF_Font *font, const char *in_name, char *out_name, int m
 	int text_height;
 	strncpy(out_name, in_name, MAX_PATH - 1);
 	out_name[MAX_PATH - 1] = '\0';
-	TTF_SizeUTF8(font, out_name, NULL, &text_height);
+	GFX_sizeUTF8(font, out_name, NULL, &text_height);
 	text_height += padding;
 
 	return text_height;
@@ -786,7 +1208,7 @@ int GFX_getTextWidth(TTF_Font *font, const char *in_name, char *out_name, int ma
 	int text_width;
 	strncpy(out_name, in_name, MAX_PATH - 1);
 	out_name[MAX_PATH - 1] = '\0';
-	TTF_SizeUTF8(font, out_name, &text_width, NULL);
+	GFX_sizeUTF8(font, out_name, &text_width, NULL);
 	text_width += padding;
 
 	return text_width;
@@ -802,7 +1224,7 @@ int GFX_wrapText(TTF_Font *font, char *str, int max_width, int max_lines)
 	char *line = str;
 	char buffer[MAX_PATH];
 
-	TTF_SizeUTF8(font, line, &line_width, NULL);
+	GFX_sizeUTF8(font, line, &line_width, NULL);
 	if (line_width <= max_width)
 	{
 		line_width = GFX_truncateText(font, line, buffer, max_width, 0);
@@ -822,7 +1244,7 @@ int GFX_wrapText(TTF_Font *font, char *str, int max_width, int max_lines)
 		{
 			if (prev)
 			{
-				TTF_SizeUTF8(font, line, &line_width, NULL);
+				GFX_sizeUTF8(font, line, &line_width, NULL);
 				if (line_width >= max_width)
 				{
 					if (line_width > max_line_width)
@@ -835,7 +1257,7 @@ int GFX_wrapText(TTF_Font *font, char *str, int max_width, int max_lines)
 		}
 		tmp[0] = '\0';
 
-		TTF_SizeUTF8(font, line, &line_width, NULL);
+		GFX_sizeUTF8(font, line, &line_width, NULL);
 
 		if (line_width >= max_width)
 		{ // wrap
@@ -1652,12 +2074,12 @@ int GFX_getButtonWidth(const char *hint, const char *button)
 	else
 	{
 		button_width += SCALE1(BUTTON_SIZE) / 2;
-		TTF_SizeUTF8(special_case ? font.large : font.tiny, button, &width, NULL);
+		GFX_sizeUTF8(special_case ? font.large : font.tiny, button, &width, NULL);
 		button_width += width;
 	}
 	button_width += SCALE1(BUTTON_MARGIN);
 
-	TTF_SizeUTF8(font.small, hint, &width, NULL);
+	GFX_sizeUTF8(font.small, hint, &width, NULL);
 	button_width += width + SCALE1(BUTTON_MARGIN);
 	return button_width;
 }
@@ -1675,14 +2097,14 @@ void GFX_blitButton(const char *hint, const char *button, SDL_Surface *dst, SDL_
 		GFX_blitAssetColor(ASSET_BUTTON, NULL, dst, dst_rect, THEME_COLOR1);
 
 		// label
-		text = TTF_RenderUTF8_Blended(font.medium, button, ALT_BUTTON_TEXT_COLOR);
+		text = GFX_renderUTF8(font.medium, button, ALT_BUTTON_TEXT_COLOR);
 		SDL_BlitSurface(text, NULL, dst, &(SDL_Rect){dst_rect->x + (SCALE1(BUTTON_SIZE) - text->w) / 2, dst_rect->y + (SCALE1(BUTTON_SIZE) - text->h) / 2});
 		ox += SCALE1(BUTTON_SIZE);
 		SDL_FreeSurface(text);
 	}
 	else
 	{
-		text = TTF_RenderUTF8_Blended(special_case ? font.large : font.tiny, button, ALT_BUTTON_TEXT_COLOR);
+		text = GFX_renderUTF8(special_case ? font.large : font.tiny, button, ALT_BUTTON_TEXT_COLOR);
 		GFX_blitPillDark(ASSET_BUTTON, dst, &(SDL_Rect){dst_rect->x, dst_rect->y, SCALE1(BUTTON_SIZE) / 2 + text->w, SCALE1(BUTTON_SIZE)});
 		ox += SCALE1(BUTTON_SIZE) / 4;
 
@@ -1697,7 +2119,7 @@ void GFX_blitButton(const char *hint, const char *button, SDL_Surface *dst, SDL_
 
 	// hint text
 	SDL_Color text_color = uintToColour(THEME_COLOR6_255);
-	text = TTF_RenderUTF8_Blended(font.small, hint, text_color);
+	text = GFX_renderUTF8(font.small, hint, text_color);
 	SDL_BlitSurface(text, NULL, dst, &(SDL_Rect){ox + dst_rect->x, dst_rect->y + (SCALE1(BUTTON_SIZE) - text->h) / 2, text->w, text->h});
 	SDL_FreeSurface(text);
 }
@@ -1777,7 +2199,7 @@ void GFX_blitBatteryAtPosition(SDL_Surface *dst, int x, int y)
 		{
 			char percentage[16];
 			snprintf(percentage, sizeof(percentage), "%i", pwr.charge);
-			SDL_Surface *text = TTF_RenderUTF8_Blended(font.micro, percentage, uintToColour(THEME_COLOR6_255));
+			SDL_Surface *text = GFX_renderUTF8(font.micro, percentage, uintToColour(THEME_COLOR6_255));
 			SDL_Rect target = {
 				x + (battery_rect.w - text->w) / 2 + 1,
 				y + (battery_rect.h - text->h) / 2 - 1};
@@ -1915,7 +2337,7 @@ int GFX_blitHardwareGroup(SDL_Surface *dst, int show_setting)
 					strftime(timeString, 12, "%-I:%M %p", &tm);
 				char display_name[12];
 				clock_width = GFX_getTextWidth(font.small, timeString, display_name, SCALE1(PILL_SIZE), 0);
-				clock = TTF_RenderUTF8_Blended(font.small, display_name, uintToColour(THEME_COLOR6_255));
+				clock = GFX_renderUTF8(font.small, display_name, uintToColour(THEME_COLOR6_255));
 				ow += clock_width + SCALE1(BUTTON_MARGIN);
 			}
 
@@ -2069,7 +2491,7 @@ void GFX_sizeText(TTF_Font *font, const char *str, int leading, int *w, int *h)
 		if (len)
 		{
 			int lw;
-			TTF_SizeUTF8(font, line, &lw, NULL);
+			GFX_sizeUTF8(font, line, &lw, NULL);
 			if (lw > mw)
 				mw = lw;
 		}
@@ -2116,7 +2538,7 @@ void GFX_blitText(TTF_Font *font, const char *str, int leading, SDL_Color color,
 
 		if (len)
 		{
-			text = TTF_RenderUTF8_Blended(font, line, color);
+			text = GFX_renderUTF8(font, line, color);
 			SDL_BlitSurface(text, NULL, dst, &(SDL_Rect){x + ((dst_rect->w - text->w) / 2), y + (i * leading)});
 			SDL_FreeSurface(text);
 		}
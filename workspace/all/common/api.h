@@ -98,6 +98,10 @@ extern int currentshaderdstw;
 extern int currentshaderdsth;
 extern int currentshadertexw;
 extern int currentshadertexh;
+extern int currentglcalls; // per frame, 0 where the renderer doesn't count
+extern int currentgluniforms;
+extern int currentgldraws;
+extern char currentframetimings[128]; // slowest stages avg/p99 in ms, empty when not timing
 extern double currentcpuse;
 extern int currentcputemp;
 extern int should_rotate;
@@ -175,6 +179,7 @@ enum {
 	EFFECT_NONE,
 	EFFECT_LINE,
 	EFFECT_GRID,
+	EFFECT_LCD,
 	EFFECT_COUNT,
 };
 
@@ -248,6 +253,17 @@ enum {
 	LAYER_IDK2 = 5, // unused?
 };
 
+typedef struct LayerStats {
+	int draws;
+	int hits; // draws that reused an uploaded texture
+	int uploads;
+	int created; // textures allocated
+	int text_draws; // scrolling text, drawn from cached textures
+	int text_hits;
+	int text_rendered; // strings rasterized, stays flat while a title scrolls
+	int text_evictions;
+} LayerStats;
+
 SDL_Surface* GFX_init(int mode);
 #define GFX_resize PLAT_resizeVideo				// (int w, int h, int pitch);
 #define GFX_setSharpness PLAT_setSharpness // (int sharpness)
@@ -258,6 +274,8 @@ SDL_Surface* GFX_init(int mode);
 #define GFX_setOffsetY PLAT_setOffsetY// (int effect)
 #define GFX_drawOnLayer PLAT_drawOnLayer //(SDL_Surface *inputSurface,int x, int y)
 #define GFX_clearLayers PLAT_clearLayers //(SDL_Surface *inputSurface,int x, int y)
+#define GFX_surfaceChanged PLAT_surfaceChanged // (SDL_Surface* surface) after editing pixels of a surface already drawn on a layer
+#define GFX_getLayerStats PLAT_getLayerStats // (LayerStats* stats)
 #define GFX_captureRendererToSurface PLAT_captureRendererToSurface //(void)
 #define GFX_animateSurface PLAT_animateSurface //(SDL_Surface *inputSurface,int x, int y)
 #define GFX_animateSurfaceOpacity PLAT_animateSurfaceOpacity //(SDL_Surface *inputSurface,int x, int y)
@@ -292,6 +310,8 @@ enum {
 int GFX_getVsync(void);
 void GFX_setVsync(int vsync);
 
+int GFX_sizeUTF8(TTF_Font* font, const char* str, int* w, int* h); // TTF_SizeUTF8 from cached glyph metrics
+SDL_Surface* GFX_renderUTF8(TTF_Font* font, const char* str, SDL_Color color); // TTF_RenderUTF8_Blended composed from cached glyphs
 int GFX_truncateText(TTF_Font* font, const char* in_name, char* out_name, int max_width, int padding); // returns final width
 int PLAT_resetScrollText(TTF_Font* font, const char* in_name,int max_width);
 void GFX_scrollTextSurface(TTF_Font* font, const char* in_name, SDL_Surface** out_surface, int max_width, int height, int padding, SDL_Color color,float heightratio); // returns final width
@@ -306,6 +326,9 @@ int GFX_wrapText(TTF_Font* font, char* str, int max_width, int max_lines); // mo
 #define GFX_clearShaders PLAT_clearShaders	// void:(GFX_Renderer* renderer)
 #define GFX_updateShader PLAT_updateShader	// void:(GFX_Renderer* renderer)
 #define GFX_initShaders PLAT_initShaders	// void:(GFX_Renderer* renderer)
+#define GFX_warmShader PLAT_warmShader	// void:(const char* filename)
+#define GFX_setShaderPreset PLAT_setShaderPreset	// int:(const char* path)
+#define GFX_setFrameTimings PLAT_setFrameTimings	// void:(int enabled)
 
 scaler_t GFX_getAAScaler(GFX_Renderer* renderer);
 void GFX_freeAAScaler(void);
@@ -560,6 +583,8 @@ void PLAT_setOffsetX(int x);
 void PLAT_setOffsetY(int y);
 void PLAT_drawOnLayer(SDL_Surface *inputSurface, int x, int y, int w, int h, float brightness, bool maintainAspectRatio,int layer);
 void PLAT_clearLayers(int layer);
+void PLAT_surfaceChanged(SDL_Surface* surface);
+void PLAT_getLayerStats(LayerStats* stats);
 SDL_Surface* PLAT_captureRendererToSurface();
 void PLAT_animateSurface(
 	SDL_Surface *inputSurface,
@@ -614,6 +639,9 @@ void PLAT_setShader2(const char* filename);
 void PLAT_setShader3(const char* filename);
 void PLAT_updateShader(int i, const char *filename, int *scale, int *filter, int *scaletype, int *inputtype);
 void PLAT_initShaders();
+void PLAT_warmShader(const char* filename); // compile into the shader cache at idle, a .glslp path warms each of its passes. no-op where unsupported
+int PLAT_setShaderPreset(const char* path); // .glslp that replaces the per-pass chain, NULL to go back to it. -1 if it can't be used
+void PLAT_setFrameTimings(int enabled); // per stage cpu/gpu timing for the debug hud, no-op where unsupported
 ShaderParam* PLAT_getShaderPragmas(int i);
 int PLAT_supportsOverscan(void);
 
@@ -59,6 +59,7 @@ void CFG_defaults(NextUISettings *cfg)
         .saveFormat = CFG_DEFAULT_SAVEFORMAT,
         .stateFormat = CFG_DEFAULT_STATEFORMAT,
         .useExtractedFileName = CFG_DEFAULT_EXTRACTEDFILENAME,
+        .extractCacheSize = CFG_DEFAULT_EXTRACTCACHESIZE,
 
         .wifi = CFG_DEFAULT_WIFI,
         .wifiDiagnostics = CFG_DEFAULT_WIFI_DIAG,
@@ -224,6 +225,11 @@ void CFG_init(FontLoad_callback_t cb, ColorSet_callback_t ccb)
                 CFG_setUseExtractedFileName((bool)temp_value);
                 continue;
             }
+            if (sscanf(line, "extractCacheSize=%i", &temp_value) == 1)
+            {
+                CFG_setExtractCacheSize(temp_value);
+                continue;
+            }
             if (sscanf(line, "muteLeds=%i", &temp_value) == 1)
             {
                 CFG_setMuteLEDs(temp_value);
@@ -566,6 +572,17 @@ void CFG_setUseExtractedFileName(bool use)
     CFG_sync();
 }
 
+int CFG_getExtractCacheSize(void)
+{
+    return settings.extractCacheSize;
+}
+
+void CFG_setExtractCacheSize(int size)
+{
+    settings.extractCacheSize = size < 0 ? 0 : size;
+    CFG_sync();
+}
+
 bool CFG_getMuteLEDs(void)
 {
     return settings.muteLeds;
@@ -767,6 +784,10 @@ void CFG_get(const char *key, char *value)
     {
         snprintf(value, 256, "%i", CFG_getUseExtractedFileName());
     }
+    else if (strcmp(key, "extractCacheSize") == 0)
+    {
+        snprintf(value, 256, "%i", CFG_getExtractCacheSize());
+    }
     else if (strcmp(key, "muteLeds") == 0)
     {
         snprintf(value, 256, "%i", CFG_getMuteLEDs());
@@ -856,6 +877,7 @@ void CFG_sync(void)
     fprintf(file, "saveFormat=%i\n", settings.saveFormat);
     fprintf(file, "stateFormat=%i\n", settings.stateFormat);
     fprintf(file, "useExtractedFileName=%i\n", settings.useExtractedFileName);
+    fprintf(file, "extractCacheSize=%i\n", settings.extractCacheSize);
     fprintf(file, "muteLeds=%i\n", settings.muteLeds);
     fprintf(file, "artWidth=%i\n", (int)(settings.gameArtWidth * 100));
     fprintf(file, "wifi=%i\n", settings.wifi);
@@ -898,6 +920,7 @@ void CFG_print(void)
     printf("\t\"saveFormat\": %i,\n", settings.saveFormat);
     printf("\t\"stateFormat\": %i,\n", settings.stateFormat);
     printf("\t\"useExtractedFileName\": %i,\n", settings.useExtractedFileName);
+    printf("\t\"extractCacheSize\": %i,\n", settings.extractCacheSize);
     printf("\t\"muteLeds\": %i,\n", settings.muteLeds);
     printf("\t\"artWidth\": %i,\n", (int)(settings.gameArtWidth * 100));
     printf("\t\"wifi\": %i,\n", settings.wifi);
@@ -101,6 +101,7 @@ typedef struct
 	int saveFormat;
 	int stateFormat;
 	bool useExtractedFileName;
+	int extractCacheSize; // MB
 
 	// Haptic
 	bool haptics;
@@ -139,6 +140,7 @@ typedef struct
 #define CFG_DEFAULT_SAVEFORMAT SAVE_FORMAT_SAV
 #define CFG_DEFAULT_STATEFORMAT STATE_FORMAT_SAV
 #define CFG_DEFAULT_EXTRACTEDFILENAME false
+#define CFG_DEFAULT_EXTRACTCACHESIZE 256
 #define CFG_DEFAULT_MUTELEDS false
 #define CFG_DEFAULT_GAMEARTWIDTH 0.45
 #define CFG_DEFAULT_WIFI false
@@ -221,6 +223,9 @@ void CFG_setStateFormat(int);
 // use extracted file name instead of archive name (for cores that do not support archives natively)
 bool CFG_getUseExtractedFileName(void);
 void CFG_setUseExtractedFileName(bool);
+// RAM budget in MB for archives extracted to /tmp and kept around for the next launch
+int CFG_getExtractCacheSize(void);
+void CFG_setExtractCacheSize(int);
 // Enable/disable mute also shutting off LEDs.
 bool CFG_getMuteLEDs(void);
 void CFG_setMuteLEDs(bool);
@@ -0,0 +1,197 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "lz4.h"
+
+// a single probe hash of the next four bytes finds matches, skipping ahead
+// faster the longer nothing matches so incompressible data costs little.
+// the end of a block is always literals, as the format requires
+#define LZ4_HASH_LOG 12
+#define LZ4_MIN_MATCH 4
+#define LZ4_LAST_LITERALS 5
+#define LZ4_MF_LIMIT 12 // no match may start this close to the end
+#define LZ4_MAX_OFFSET 65535
+#define LZ4_SKIP_TRIGGER 6
+
+static inline uint32_t LZ4_read32(const uint8_t* p) {
+	uint32_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+static inline uint64_t LZ4_read64(const uint8_t* p) {
+	uint64_t value;
+	memcpy(&value, p, sizeof(value));
+	return value;
+}
+static inline uint32_t LZ4_hash(uint32_t sequence) {
+	return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+static inline uint8_t* LZ4_writeLength(uint8_t* op, uint8_t* oend, int length) { // what doesn't fit the token, NULL if out of room
+	for (; length>=255; length-=255) {
+		if (op>=oend) return NULL;
+		*op++ = 255;
+	}
+	if (op>=oend) return NULL;
+	*op++ = length;
+	return op;
+}
+static uint8_t* LZ4_writeSequence(uint8_t* op, uint8_t* oend, const uint8_t* literals, int literal_length, int offset, int match_length) { // match_length 0 for the final literals
+	if (op>=oend) return NULL;
+	uint8_t* token = op++;
+	*token = (literal_length<15 ? literal_length : 15) << 4;
+	if (literal_length>=15 && !(op = LZ4_writeLength(op, oend, literal_length - 15))) return NULL;
+	if (oend-op<literal_length) return NULL;
+	memcpy(op, literals, literal_length);
+	op += literal_length;
+	if (!match_length) return op;
+	
+	if (oend-op<2) return NULL;
+	*op++ = offset & 0xFF;
+	*op++ = offset >> 8;
+	int extra = match_length - LZ4_MIN_MATCH;
+	*token |= extra<15 ? extra : 15;
+	if (extra>=15 && !(op = LZ4_writeLength(op, oend, extra - 15))) return NULL;
+	return op;
+}
+
+int LZ4_compressBound(int src_size) {
+	if (src_size<0 || src_size>LZ4_MAX_INPUT_SIZE) return 0;
+	return src_size + src_size / 255 + 16;
+}
+
+int LZ4_compress_default(const char* src, char* dst, int src_size, int dst_capacity) {
+	if (src_size<0 || src_size>LZ4_MAX_INPUT_SIZE || dst_capacity<=0) return 0;
+	
+	const uint8_t* base = (const uint8_t*)src;
+	const uint8_t* ip = base;
+	const uint8_t* anchor = base; // start of the pending literals
+	const uint8_t* iend = base + src_size;
+	const uint8_t* match_limit = iend - LZ4_LAST_LITERALS;
+	uint8_t* op = (uint8_t*)dst;
+	uint8_t* oend = op + dst_capacity;
+	
+	if (src_size>=LZ4_MF_LIMIT) {
+		uint32_t table[1<<LZ4_HASH_LOG]; // offsets from base
+		memset(table, 0, sizeof(table));
+		const uint8_t* mf_limit = iend - LZ4_MF_LIMIT;
+		
+		ip += 1; // position 0 is already in the (zeroed) table
+		while (ip<=mf_limit) {
+			// find a match
+			const uint8_t* match;
+			int misses = 1 << LZ4_SKIP_TRIGGER;
+			for (;;) {
+				uint32_t sequence = LZ4_read32(ip);
+				uint32_t* entry = &table[LZ4_hash(sequence)];
+				match = base + *entry;
+				*entry = ip - base;
+				if (ip-match<=LZ4_MAX_OFFSET && match<ip && LZ4_read32(match)==sequence) break;
+				
+				ip += misses++ >> LZ4_SKIP_TRIGGER;
+				if (ip>mf_limit) goto last_literals;
+			}
+			
+			// extend it backwards over the literals and then forwards
+			while (ip>anchor && match>base && ip[-1]==match[-1]) {
+				ip--;
+				match--;
+			}
+			const uint8_t* start = ip;
+			ip += LZ4_MIN_MATCH;
+			match += LZ4_MIN_MATCH;
+			while (match_limit-ip>=8) { // little endian: the first differing byte is the lowest set bit
+				uint64_t diff = LZ4_read64(ip) ^ LZ4_read64(match);
+				if (diff) {
+					int same = __builtin_ctzll(diff) >> 3;
+					ip += same;
+					match += same;
+					break;
+				}
+				ip += 8;
+				match += 8;
+			}
+			while (ip<match_limit && *ip==*match) {
+				ip++;
+				match++;
+			}
+			
+			op = LZ4_writeSequence(op, oend, anchor, start - anchor, ip - match, ip - start);
+			if (!op) return 0;
+			anchor = ip;
+			
+			// seed the table with the end of the match so runs chain
+			if (ip<=mf_limit) table[LZ4_hash(LZ4_read32(ip - 2))] = ip - 2 - base;
+		}
+	}
+	
+last_literals:
+	op = LZ4_writeSequence(op, oend, anchor, iend - anchor, 0, 0);
+	if (!op) return 0;
+	return op - (uint8_t*)dst;
+}
+
+int LZ4_decompress_safe(const char* src, char* dst, int compressed_size, int dst_capacity) {
+	if (compressed_size<=0 || dst_capacity<0) return -1;
+	
+	const uint8_t* ip = (const uint8_t*)src;
+	const uint8_t* iend = ip + compressed_size;
+	uint8_t* base = (uint8_t*)dst;
+	uint8_t* op = base;
+	uint8_t* oend = base + dst_capacity;
+	
+	for (;;) {
+		int token = *ip++;
+		
+		size_t literal_length = token >> 4;
+		if (literal_length==15) {
+			int byte;
+			do {
+				if (ip>=iend) return -1;
+				byte = *ip++;
+				literal_length += byte;
+			} while (byte==255);
+		}
+		if ((size_t)(iend-ip)<literal_length || (size_t)(oend-op)<literal_length) return -1;
+		// most runs are short, a fixed size copy is much cheaper when there's room past them
+		if (literal_length<=16 && iend-ip>=16 && oend-op>=16) memcpy(op, ip, 16);
+		else memcpy(op, ip, literal_length);
+		ip += literal_length;
+		op += literal_length;
+		if (ip==iend) break; // the last sequence has no match
+		
+		if (iend-ip<2) return -1;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (!offset || offset>(size_t)(op-base)) return -1;
+		
+		size_t match_length = token & 15;
+		if (match_length==15) {
+			int byte;
+			do {
+				if (ip>=iend) return -1;
+				byte = *ip++;
+				match_length += byte;
+			} while (byte==255);
+		}
+		match_length += LZ4_MIN_MATCH;
+		if ((size_t)(oend-op)<match_length) return -1;
+		
+		// matches may overlap what they produce, copy what is already
+		// there, which doubles each time on a short repeating offset
+		const uint8_t* match = op - offset;
+		if (offset>=16 && match_length<=16 && oend-op>=16) {
+			memcpy(op, match, 16);
+			op += match_length;
+			match_length = 0;
+		}
+		while (match_length) {
+			size_t chunk = op - match;
+			if (chunk>match_length) chunk = match_length;
+			memcpy(op, match, chunk);
+			op += chunk;
+			match_length -= chunk;
+		}
+		if (ip>=iend) return -1;
+	}
+	return op - base;
+}
@@ -0,0 +1,16 @@
+#ifndef __LZ4_H__
+#define __LZ4_H__
+
+//
+//	lz4 block format (https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md)
+//	blocks are interchangeable with the reference library's LZ4_compress_default()
+//	and LZ4_decompress_safe(), which these mirror so it can be swapped in
+//
+
+#define LZ4_MAX_INPUT_SIZE 0x7E000000
+
+int LZ4_compressBound(int src_size); // 0 if src_size is too large
+int LZ4_compress_default(const char* src, char* dst, int src_size, int dst_capacity); // compressed size, 0 if dst is too small
+int LZ4_decompress_safe(const char* src, char* dst, int compressed_size, int dst_capacity); // decompressed size, negative if src is malformed or dst too small
+
+#endif
@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "slots.h"
+#include "lz4.h"
+
+void Slots_reset(SlotIndex* index) {
+	memset(index, 0, sizeof(*index));
+	memcpy(index->magic, SLOTS_MAGIC, sizeof(index->magic));
+	index->version = SLOTS_VERSION;
+	index->count = SLOTS_COUNT;
+}
+
+uint8_t* Slots_read(const char* path, SlotIndex* index) {
+	int fd = open(path, O_RDONLY);
+	if (fd<0) return NULL;
+	
+	struct stat st;
+	uint8_t* file = NULL;
+	if (!fstat(fd, &st) && st.st_size>=sizeof(SlotIndex)) file = malloc(st.st_size);
+	if (file && read(fd, file, st.st_size)!=st.st_size) {
+		free(file);
+		file = NULL;
+	}
+	close(fd);
+	if (!file) return NULL;
+	
+	SlotIndex header;
+	memcpy(&header, file, sizeof(header));
+	int valid = !memcmp(header.magic, SLOTS_MAGIC, sizeof(header.magic))
+		&& header.version==SLOTS_VERSION
+		&& header.count==SLOTS_COUNT;
+	
+	// the previews have to account for the rest of the file exactly
+	uint64_t size = sizeof(header);
+	for (int i=0; valid && i<SLOTS_COUNT; i++) {
+		SlotInfo* info = &header.slots[i];
+		valid = info->preview>=SLOT_PREVIEW_NONE && info->preview<=SLOT_PREVIEW_BMP
+			&& (info->preview==SLOT_PREVIEW_LZ4 || !info->preview_size);
+		size += info->preview_size;
+	}
+	if (!valid || size!=st.st_size) {
+		free(file);
+		return NULL;
+	}
+	
+	*index = header;
+	return file;
+}
+
+const uint8_t* Slots_getPreview(const SlotIndex* index, const uint8_t* file, int slot) {
+	if (slot<0 || slot>=SLOTS_COUNT || index->slots[slot].preview!=SLOT_PREVIEW_LZ4) return NULL;
+	
+	size_t offset = sizeof(SlotIndex);
+	for (int i=0; i<slot; i++) {
+		offset += index->slots[i].preview_size;
+	}
+	return file + offset;
+}
+
+int Slots_decodePreview(const SlotInfo* info, const uint8_t* data, uint32_t* pixels) {
+	if (info->preview!=SLOT_PREVIEW_LZ4 || !data) return 0;
+	
+	int size = info->preview_w * info->preview_h * 4;
+	return size && LZ4_decompress_safe((const char*)data, (char*)pixels, info->preview_size, size)==size;
+}
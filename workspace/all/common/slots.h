@@ -0,0 +1,48 @@
+#ifndef __SLOTS_H__
+#define __SLOTS_H__
+
+#include <stdint.h>
+
+#include "defines.h"
+
+// one small file per game describing every save slot, written by minarch
+// next to the slot's txt and bmp as .minui/<EMU>/<romname>.ext.slots and
+// read by its menu and by the game switcher. the fixed header below comes
+// first, then the lz4 compressed preview of each slot that has one, in slot
+// order, so a single read gets everything
+
+#define SLOTS_MAGIC "NXSLOTS"
+#define SLOTS_VERSION 3
+#define SLOTS_COUNT (AUTO_RESUME_SLOT+1)
+
+enum {
+	SLOT_PREVIEW_NONE,
+	SLOT_PREVIEW_LZ4, // RGBA_MASK_8888, packed, in the index
+	SLOT_PREVIEW_BMP, // only the bmp next to the slot
+};
+
+typedef struct SlotInfo {
+	int64_t timestamp; // 0 if empty
+	uint64_t size; // uncompressed
+	int32_t codec;
+	int32_t preview;
+	uint32_t generation; // bumped on every save, for caching the preview
+	uint16_t preview_w;
+	uint16_t preview_h;
+	uint32_t preview_size; // compressed, in the index
+	uint32_t reserved;
+} SlotInfo;
+
+typedef struct SlotIndex {
+	char magic[8];
+	uint32_t version;
+	uint32_t count;
+	SlotInfo slots[SLOTS_COUNT];
+} SlotIndex;
+
+void Slots_reset(SlotIndex* index);
+uint8_t* Slots_read(const char* path, SlotIndex* index); // the whole file, NULL if missing or invalid, caller must free
+const uint8_t* Slots_getPreview(const SlotIndex* index, const uint8_t* file, int slot); // into what Slots_read returned, NULL if not embedded
+int Slots_decodePreview(const SlotInfo* info, const uint8_t* data, uint32_t* pixels); // into preview_w * preview_h pixels, 1 on success
+
+#endif
@@ -7,6 +7,9 @@
 #include <math.h>
 #include <ctype.h>
 #include <sys/time.h>
+#include <libgen.h>
+#include <errno.h>
+#include <sys/stat.h>
 #include "defines.h"
 #include "utils.h"
 
@@ -515,6 +518,187 @@ void putInt(const char* path, int value) {
 	putFile(path, buffer);
 }
 
+void getTempPath(const char* path, char* tmp_path) {
+	snprintf(tmp_path, MAX_PATH, "%s.tmp", path);
+}
+int syncFile(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd<0) return 0;
+	int ok = fsync(fd)==0;
+	close(fd);
+	return ok;
+}
+int syncParentDir(const char* path) {
+	char dir_path[MAX_PATH];
+	snprintf(dir_path, sizeof(dir_path), "%s", path);
+	int fd = open(dirname(dir_path), O_RDONLY|O_DIRECTORY);
+	if (fd<0) return 0;
+	int ok = fsync(fd)==0;
+	close(fd);
+	return ok;
+}
+// on failure errno is whatever failed, not the cleanup
+static void discardTempFile(const char* tmp_path) {
+	int error = errno;
+	unlink(tmp_path);
+	errno = error;
+}
+int commitFile(const char* tmp_path, const char* path) {
+	if (!syncFile(tmp_path) || rename(tmp_path, path)) {
+		discardTempFile(tmp_path);
+		return 0;
+	}
+	// the rename itself isn't durable until the directory entry is
+	syncParentDir(path);
+	return 1;
+}
+int putFileDurable(const char* path, const void* data, size_t size) {
+	if (!path || (!data && size)) return 0;
+	
+	char tmp_path[MAX_PATH];
+	getTempPath(path, tmp_path);
+	
+	int fd = open(tmp_path, O_WRONLY|O_CREAT|O_TRUNC, 0666);
+	if (fd<0) return 0;
+	
+	const char* bytes = data;
+	size_t written = 0;
+	while (written<size) {
+		ssize_t count = write(fd, bytes+written, size-written);
+		if (count<0) {
+			if (errno==EINTR) continue;
+			break;
+		}
+		written += count;
+	}
+	int ok = written==size && fsync(fd)==0;
+	int error = errno;
+	if (close(fd)) {
+		if (!ok) errno = error; // report the first failure
+		ok = 0;
+	}
+	if (!ok || rename(tmp_path, path)) {
+		discardTempFile(tmp_path);
+		return 0;
+	}
+	syncParentDir(path);
+	return 1;
+}
+
+///////////////////////////////////////
+
+#define CORE_INFO_FORMAT "%255[^\t]\t%lld\t%lld\t%7[^\t]\t%i\t%i\t%127[^\t]\t%127[^\t]\t%127[^\n]"
+
+static int CoreInfo_parse(const char* line, CoreInfo* info) {
+	long long size, mtime;
+	memset(info, 0, sizeof(CoreInfo));
+	if (sscanf(line, CORE_INFO_FORMAT, info->path, &size, &mtime, info->tag, &info->need_fullpath, &info->block_extract, info->name, info->version, info->extensions)<8) return 0;
+	info->size = size;
+	info->mtime = mtime;
+	return 1;
+}
+static int CoreInfo_isFresh(const CoreInfo* info) {
+	struct stat st;
+	if (stat(info->path, &st)!=0) return 0;
+	return st.st_size==info->size && st.st_mtime==info->mtime;
+}
+static int CoreInfo_find(const char* core_path, const char* tag, CoreInfo* info) {
+	FILE* file = fopen(CORE_INFO_PATH, "r");
+	if (!file) return 0;
+	
+	int found = 0;
+	char line[1024];
+	while (fgets(line, sizeof(line), file)) {
+		if (!CoreInfo_parse(line, info)) continue;
+		if (core_path && !exactMatch(info->path, core_path)) continue;
+		if (tag && !exactMatch(info->tag, tag)) continue;
+		found = CoreInfo_isFresh(info);
+		break;
+	}
+	fclose(file);
+	return found;
+}
+int CoreInfo_get(const char* core_path, CoreInfo* info) {
+	if (!core_path || !info) return 0;
+	return CoreInfo_find(core_path, NULL, info);
+}
+int CoreInfo_getByTag(const char* tag, CoreInfo* info) {
+	if (!tag || !info) return 0;
+	return CoreInfo_find(NULL, tag, info);
+}
+int CoreInfo_put(CoreInfo* info) {
+	if (!info || !info->path[0]) return 0;
+	
+	struct stat st;
+	if (stat(info->path, &st)!=0) return 0;
+	info->size = st.st_size;
+	info->mtime = st.st_mtime;
+	
+	// tabs and newlines would break the line format
+	char* fields[] = {info->tag, info->name, info->version, info->extensions, NULL};
+	for (int i=0; fields[i]; i++) {
+		for (char* c=fields[i]; *c; c++) {
+			if (*c=='\t' || *c=='\n') *c = ' ';
+		}
+	}
+	
+	char* old = allocFile(CORE_INFO_PATH);
+	size_t capacity = (old ? strlen(old) : 0) + 1024;
+	char* contents = malloc(capacity);
+	if (!contents) {
+		free(old);
+		return 0;
+	}
+	
+	// our line first, then everything else that isn't this core
+	size_t len = snprintf(contents, capacity, "%s\t%lld\t%lld\t%s\t%i\t%i\t%s\t%s\t%s\n",
+		info->path, (long long)info->size, (long long)info->mtime, info->tag,
+		info->need_fullpath, info->block_extract,
+		info->name[0] ? info->name : "-", info->version[0] ? info->version : "-", info->extensions
+	);
+	if (old) {
+		CoreInfo other;
+		char* line = old;
+		while (line && *line) {
+			char* next = strchr(line, '\n');
+			if (next) *next++ = '\0';
+			if (CoreInfo_parse(line, &other) && !exactMatch(other.path, info->path) && len<capacity) {
+				len += snprintf(contents+len, capacity-len, "%s\n", line);
+			}
+			line = next;
+		}
+		free(old);
+	}
+	if (len>=capacity) len = capacity - 1;
+	
+	mkdir(USERDATA_PATH "/.minui", 0755);
+	int ok = putFileDurable(CORE_INFO_PATH, contents, len);
+	free(contents);
+	return ok;
+}
+int CoreInfo_readsRom(const CoreInfo* info, const char* rom_path) {
+	if (!info || !rom_path) return 0;
+	if (!info->need_fullpath) return 1; // loaded into memory
+	if (!suffixMatch(".zip", rom_path)) return 0;
+	
+	// extracted by the frontend unless the core takes zips itself
+	char exts[128];
+	strncpy(exts, info->extensions, sizeof(exts) - 1);
+	exts[sizeof(exts) - 1] = '\0';
+	char* ext;
+	int i = 0;
+	while ((ext=strtok(i++?NULL:exts,"|"))) {
+		if (!strcmp("zip", ext)) return 0;
+	}
+	return 1;
+}
+void prefetchFile(const char* path) {
+	int fd = open(path, O_RDONLY);
+	if (fd<0) return;
+	posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+	close(fd);
+}
+
 uint64_t getMicroseconds(void) {
     uint64_t ret;
     struct timeval tv;
@@ -42,6 +42,36 @@ void getFile(const char* path, char* buffer, size_t buffer_size);
 void putInt(const char* path, int value);
 int getInt(const char* path);
 
+// durable writes: data goes to path.tmp which is fsync'd, renamed over
+// path and then the parent directory is fsync'd, so after a crash either
+// the old or the new file is intact. cheaper than sync() which flushes
+// every dirty page on the card
+void getTempPath(const char* path, char* tmp_path); // tmp_path must be MAX_PATH
+int syncFile(const char* path);
+int syncParentDir(const char* path);
+int commitFile(const char* tmp_path, const char* path); // removes tmp_path on failure
+int putFileDurable(const char* path, const void* data, size_t size);
+
+// what retro_get_system_info() told us last time a core was opened,
+// keyed by .so path and invalidated when its size or mtime changes.
+// lets the launcher know a core's needs without dlopen'ing it
+typedef struct CoreInfo {
+	char path[256];
+	int64_t size;
+	int64_t mtime;
+	char tag[8];
+	char name[128];
+	char version[128];
+	char extensions[128];
+	int need_fullpath;
+	int block_extract;
+} CoreInfo;
+int CoreInfo_get(const char* core_path, CoreInfo* info); // returns 0 on miss or stale entry
+int CoreInfo_getByTag(const char* tag, CoreInfo* info);
+int CoreInfo_put(CoreInfo* info); // fills in size and mtime
+int CoreInfo_readsRom(const CoreInfo* info, const char* rom_path); // will the frontend read or inflate the rom itself?
+void prefetchFile(const char* path); // hint the kernel to start reading path into the page cache
+
 uint64_t getMicroseconds(void);
 
 int clamp(int x, int lower, int upper);
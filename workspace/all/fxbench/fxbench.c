@@ -0,0 +1,306 @@
+// checks and times the procedural screen effects (effect.glsl, lcd.glsl)
+// against the png overlay quad they replaced. renders offscreen through
+// EGL so it runs on a desktop (mesa surfaceless, eg. llvmpipe) as well as
+// on device:
+//   fxbench [path/to/shaders]   (defaults to skeleton/SYSTEM/tg5040/shaders)
+// exits non-zero if line or grid stop matching the old png patterns
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define TARGET_WIDTH 1024
+#define TARGET_HEIGHT 768
+#define OVERLAY_WIDTH 1280 // what the old path uploaded and scaled
+#define OVERLAY_HEIGHT 960
+#define FRAMES 300
+#define REPEATS 3 // best of
+
+enum {
+	FX_OVERLAY,
+	FX_LINE = 1, // matches EffectType
+	FX_GRID,
+	FX_LCD,
+	FX_FLAT,
+};
+
+// the cheapest full screen blend, for scale
+static const char* flat_source =
+	"#if defined(VERTEX)\n"
+	"attribute vec2 VertexCoord;\n"
+	"attribute vec2 TexCoord;\n"
+	"varying vec2 vTexCoord;\n"
+	"void main() { vTexCoord = TexCoord; gl_Position = vec4(VertexCoord, 0.0, 1.0); }\n"
+	"#endif\n"
+	"#if defined(FRAGMENT)\n"
+	"varying vec2 vTexCoord;\n"
+	"void main() { gl_FragColor = vec4(0.0, 0.0, 0.0, vTexCoord.x); }\n"
+	"#endif\n";
+
+static GLuint fx_line;
+static GLuint fx_lcd;
+static GLuint overlay;
+static GLuint flat;
+
+static double now(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+static char* readFile(const char* path) {
+	FILE* file = fopen(path, "rb");
+	if (!file) return NULL;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	rewind(file);
+	char* contents = malloc(size + 1);
+	if (contents) {
+		contents[fread(contents, 1, size, file)] = '\0';
+	}
+	fclose(file);
+	return contents;
+}
+
+static GLuint compileShader(GLenum type, const char* source) {
+	const char* parts[] = {
+		"#version 100\n",
+		type==GL_VERTEX_SHADER ? "#define VERTEX\n" : "#define FRAGMENT\nprecision highp float;\n",
+		source,
+	};
+	GLuint shader = glCreateShader(type);
+	glShaderSource(shader, 3, parts, NULL);
+	glCompileShader(shader);
+	
+	GLint success = 0;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+	if (!success) {
+		char log[2048];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		fprintf(stderr, "compile error: %s\n", log);
+		exit(EXIT_FAILURE);
+	}
+	return shader;
+}
+static GLuint linkProgram(const char* source, const char* label) {
+	if (!source) {
+		fprintf(stderr, "unable to read %s\n", label);
+		exit(EXIT_FAILURE);
+	}
+	GLuint program = glCreateProgram();
+	glAttachShader(program, compileShader(GL_VERTEX_SHADER, source));
+	glAttachShader(program, compileShader(GL_FRAGMENT_SHADER, source));
+	glBindAttribLocation(program, 0, "VertexCoord");
+	glBindAttribLocation(program, 1, "TexCoord");
+	glLinkProgram(program);
+	
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) {
+		fprintf(stderr, "unable to link %s\n", label);
+		exit(EXIT_FAILURE);
+	}
+	return program;
+}
+static GLuint loadProgram(const char* dir, const char* name) {
+	char path[512];
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	char* source = readFile(path);
+	GLuint program = linkProgram(source, path);
+	free(source);
+	return program;
+}
+
+static void drawQuad(void) {
+	static const float vertices[] = {
+		// x, y, u, v
+		-1,-1, 0,0,
+		 1,-1, 1,0,
+		-1, 1, 0,1,
+		 1, 1, 1,1,
+	};
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 16, vertices);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 16, vertices+2);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+}
+
+// same uniforms PLAT_GL_Swap submits for the effect
+static void setupEffect(int type, float scale, int width, int height) {
+	GLuint program = type==FX_LCD ? fx_lcd : fx_line;
+	glUseProgram(program);
+	
+	float band_x = (int)(scale * 0.25f + 0.5f);
+	float band_y = band_x;
+	if (band_x<1) band_x = band_y = 1;
+	if (type==FX_LINE) band_x = 0, band_y = scale * 0.5f;
+	else if (type==FX_LCD) band_x = scale / 3.0f;
+	
+	glUniform2f(glGetUniformLocation(program, "OutputSize"), width, height);
+	glUniform2f(glGetUniformLocation(program, "EffectScale"), scale, scale);
+	glUniform2f(glGetUniformLocation(program, "EffectBand"), band_x, band_y);
+	glUniform1f(glGetUniformLocation(program, "EffectType"), type);
+	glUniform1f(glGetUniformLocation(program, "EffectIntensity"), 1.0f);
+	glUniform3f(glGetUniformLocation(program, "EffectColor"), 0, 0, 0);
+	glUniform1f(glGetUniformLocation(program, "EffectLayout"), 0);
+	if (type==FX_LCD) glBlendFunc(GL_DST_COLOR, GL_ZERO);
+	else glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+// draws line and grid over white at every integer scale the old pngs came
+// in and compares against the rules they were drawn with, returns mismatches
+static int checkPatterns(void) {
+	int mismatches = 0;
+	unsigned char* pixels = malloc(TARGET_WIDTH * TARGET_HEIGHT * 4);
+	glEnable(GL_BLEND);
+	for (int type=FX_LINE; type<=FX_GRID; type++) {
+		for (int scale=2; scale<=11; scale++) {
+			glViewport(0, 0, TARGET_WIDTH, TARGET_HEIGHT);
+			glClearColor(1, 1, 1, 1);
+			glClear(GL_COLOR_BUFFER_BIT);
+			setupEffect(type, scale, TARGET_WIDTH, TARGET_HEIGHT);
+			drawQuad();
+			glReadPixels(0, 0, TARGET_WIDTH, TARGET_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+			
+			int thickness = scale / 4.0 + 0.5;
+			if (thickness<1) thickness = 1;
+			for (int y=0; y<TARGET_HEIGHT; y++) {
+				int row = TARGET_HEIGHT - 1 - y; // read back bottom up, the patterns start top left
+				int ry = row % scale;
+				for (int x=0; x<TARGET_WIDTH; x++) {
+					int rx = x % scale;
+					int expected;
+					if (type==FX_LINE) expected = 2*ry+1<scale ? 0 : (2*ry+1==scale ? 128 : 255);
+					else expected = (rx<thickness || ry<thickness) ? 0 : 255;
+					
+					int actual = pixels[(y * TARGET_WIDTH + x) * 4];
+					if (abs(actual - expected)<=1) continue;
+					if (mismatches<5) printf("%s at %ix: %i,%i is %i, expected %i\n", type==FX_LINE ? "line" : "grid", scale, x, row, actual, expected);
+					mismatches += 1;
+				}
+			}
+		}
+	}
+	free(pixels);
+	return mismatches;
+}
+
+static void timeDraws(void) {
+	// a 1-in-3 scanline overlay the size the old path scaled down from
+	unsigned char* image = calloc(OVERLAY_WIDTH * OVERLAY_HEIGHT, 4);
+	for (int i=0; i<OVERLAY_WIDTH * OVERLAY_HEIGHT; i++) {
+		image[i*4+3] = (i / OVERLAY_WIDTH) % 3==0 ? 255 : 0;
+	}
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, OVERLAY_WIDTH, OVERLAY_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+	free(image);
+	
+	struct {
+		const char* name;
+		int type;
+		int width;
+		int height;
+	} cases[] = {
+		{"png overlay 1280x960 (old path)", FX_OVERLAY, OVERLAY_WIDTH, OVERLAY_HEIGHT},
+		{"png overlay 1024x768", FX_OVERLAY, 1024, 768},
+		{"flat color 1024x768", FX_FLAT, 1024, 768},
+		{"line 1024x768", FX_LINE, 1024, 768},
+		{"grid 1024x768", FX_GRID, 1024, 768},
+		{"lcd 1024x768", FX_LCD, 1024, 768},
+		{"grid 960x640 (gba at 4x)", FX_GRID, 960, 640},
+	};
+	
+	glEnable(GL_BLEND);
+	for (int i=0; i<sizeof(cases) / sizeof(cases[0]); i++) {
+		double best = 0;
+		for (int repeat=0; repeat<REPEATS; repeat++) {
+			glFinish();
+			double start = now();
+			for (int frame=0; frame<FRAMES; frame++) {
+				glViewport(0, 0, cases[i].width, cases[i].height);
+				if (cases[i].type==FX_FLAT) {
+					glUseProgram(flat);
+					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				}
+				else if (cases[i].type==FX_OVERLAY) {
+					glUseProgram(overlay);
+					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+					glBindTexture(GL_TEXTURE_2D, texture);
+					glUniform1i(glGetUniformLocation(overlay, "Texture"), 0);
+				}
+				else setupEffect(cases[i].type, 4.0f, cases[i].width, cases[i].height);
+				drawQuad();
+			}
+			glFinish();
+			double elapsed = (now() - start) / FRAMES;
+			if (!repeat || elapsed<best) best = elapsed;
+		}
+		printf("%-32s %6.3fms/draw %6.0f Mpx/s\n", cases[i].name, best, cases[i].width * cases[i].height / best / 1000.0);
+	}
+	glDeleteTextures(1, &texture);
+}
+
+int main(int argc, char* argv[]) {
+	const char* dir = argc>1 ? argv[1] : "../../../skeleton/SYSTEM/tg5040/shaders";
+	
+	EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	if (!eglInitialize(display, NULL, NULL)) {
+		// no window system, try mesa's surfaceless platform
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (void*)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		display = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL) : EGL_NO_DISPLAY;
+		if (!eglInitialize(display, NULL, NULL)) {
+			fprintf(stderr, "unable to initialize EGL\n");
+			return EXIT_FAILURE;
+		}
+	}
+	
+	EGLint config_attribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_ES2_BIT, EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_NONE};
+	EGLint context_attribs[] = {EGL_CONTEXT_CLIENT_VERSION, 2, EGL_NONE};
+	EGLint surface_attribs[] = {EGL_WIDTH, TARGET_WIDTH, EGL_HEIGHT, TARGET_HEIGHT, EGL_NONE};
+	EGLConfig config;
+	EGLint count = 0;
+	eglBindAPI(EGL_OPENGL_ES_API);
+	if (!eglChooseConfig(display, config_attribs, &config, 1, &count) || !count) {
+		fprintf(stderr, "no GLES2 pbuffer config\n");
+		return EXIT_FAILURE;
+	}
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attribs);
+	EGLSurface surface = eglCreatePbufferSurface(display, config, surface_attribs);
+	if (!eglMakeCurrent(display, surface, surface, context)) {
+		fprintf(stderr, "unable to make a context current\n");
+		return EXIT_FAILURE;
+	}
+	printf("renderer: %s\n", glGetString(GL_RENDERER));
+	
+	// draw into a texture like the effect pass does
+	GLuint target;
+	GLuint fbo;
+	glGenTextures(1, &target);
+	glBindTexture(GL_TEXTURE_2D, target);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, TARGET_WIDTH, TARGET_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glGenFramebuffers(1, &fbo);
+	glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+	
+	fx_line = loadProgram(dir, "effect.glsl");
+	fx_lcd = loadProgram(dir, "lcd.glsl");
+	overlay = loadProgram(dir, "overlay.glsl");
+	flat = linkProgram(flat_source, "flat");
+	
+	int mismatches = checkPatterns();
+	printf("patterns: %s\n", mismatches ? "line or grid differ from the pngs" : "line and grid match the pngs at 2-11x");
+	timeDraws();
+	
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglTerminate(display);
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
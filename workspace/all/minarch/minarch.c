@@ -10,6 +10,10 @@
 #include <libgen.h>
 #include <time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/statvfs.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <errno.h>
 #include <zip.h> 
 #include <pthread.h>
@@ -26,6 +30,8 @@
 #include "api.h"
 #include "utils.h"
 #include "scaler.h"
+#include "lz4.h"
+#include "slots.h"
 #include <dirent.h>
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL.h>
@@ -71,6 +77,11 @@ static int show_debug = 0;
 static int max_ff_speed = 3; // 4x
 static int ff_audio = 0;
 static int fast_forward = 0;
+static int rewind_enable = 0;
+static int rewind_buffer = 1; // 32MB
+static int rewind_granularity = 1; // every 2nd frame
+static int rewinding = 0;
+static int state_codec = 0; // system default
 static int overclock = 3; // auto
 static int has_custom_controllers = 0;
 static int gamepad_type = 0; // index in gamepad_labels/gamepad_values
@@ -87,6 +98,7 @@ GFX_Renderer renderer;
 static struct Core {
 	int initialized;
 	int need_fullpath;
+	int vfs; // asked for our vfs interface from retro_set_environment
 	
 	const char tag[8]; // eg. GBC
 	const char name[128]; // eg. gambatte
@@ -128,9 +140,205 @@ static struct Core {
 	
 	retro_core_options_update_display_callback_t update_visibility_callback;
 	// retro_audio_buffer_status_callback_t audio_buffer_status;
+	uint64_t serialization_quirks;
 } core;
 
+///////////////////////////////////////
+// extraction cache
+
+// zips the core can't open are extracted to /tmp (so RAM) and kept for the
+// next launch. cache.txt tracks what's there so a relaunch can skip libzip
+// entirely, and least recently used files are evicted to stay within
+// CFG_getExtractCacheSize(). recency is a counter kept in the index, the
+// clock can't be trusted on devices without an rtc
+
+#define EXTRACT_CACHE_DIR "/tmp/nextarch"
+#define EXTRACT_CACHE_INDEX EXTRACT_CACHE_DIR "/cache.txt"
+#define EXTRACT_CACHE_MAX 64
+
+typedef struct CacheEntry {
+	char src_path[MAX_PATH]; // the zip
+	char path[MAX_PATH]; // extracted file
+	long long src_mtime;
+	unsigned long long src_size;
+	unsigned long long size;
+	uint32_t crc;
+	unsigned long long last_used; // extract_cache.uses when it was last used
+} CacheEntry;
+
+static struct {
+	CacheEntry entries[EXTRACT_CACHE_MAX];
+	int count;
+	int loaded;
+	unsigned long long uses; // bumped on every add or hit, never goes back
+	char swept[MAX_PATH]; // tag dir last cleared of untracked files
+} extract_cache;
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t* data, size_t size) { // matches zip's crc
+	static uint32_t table[256];
+	if (!table[1]) {
+		for (uint32_t i=0; i<256; i++) {
+			uint32_t c = i;
+			for (int k=0; k<8; k++) c = c & 1 ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+			table[i] = c;
+		}
+	}
+	crc = ~crc;
+	for (size_t i=0; i<size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+static int ExtractCache_verify(const CacheEntry* entry) { // the whole file against the crc it was extracted with
+	int fd = open(entry->path, O_RDONLY);
+	if (fd<0) return 0;
+	
+	static uint8_t buf[64*1024];
+	uint32_t crc = 0;
+	unsigned long long size = 0;
+	ssize_t len;
+	while ((len = read(fd, buf, sizeof(buf)))>0) {
+		crc = crc32_update(crc, buf, len);
+		size += len;
+	}
+	close(fd);
+	return len==0 && size==entry->size && crc==entry->crc;
+}
+
+static void ExtractCache_save(void) {
+	FILE* file = fopen(EXTRACT_CACHE_INDEX ".tmp", "w");
+	if (!file) return;
+	for (int i=0; i<extract_cache.count; i++) {
+		CacheEntry* entry = &extract_cache.entries[i];
+		fprintf(file, "%lld\t%llu\t%llu\t%08x\t%llu\t%s\t%s\n", entry->src_mtime, entry->src_size, entry->size, entry->crc, entry->last_used, entry->src_path, entry->path);
+	}
+	fclose(file);
+	rename(EXTRACT_CACHE_INDEX ".tmp", EXTRACT_CACHE_INDEX);
+}
+static void ExtractCache_remove(int i) {
+	LOG_info("ExtractCache_remove: %s\n", extract_cache.entries[i].path);
+	unlink(extract_cache.entries[i].path);
+	extract_cache.count -= 1;
+	memmove(&extract_cache.entries[i], &extract_cache.entries[i+1], (extract_cache.count - i) * sizeof(CacheEntry));
+}
+static int ExtractCache_indexOf(const char* path) { // extracted path
+	for (int i=0; i<extract_cache.count; i++) {
+		if (exactMatch(extract_cache.entries[i].path, path)) return i;
+	}
+	return -1;
+}
+static void ExtractCache_load(const char* dir_path) { // also removes files in dir_path the index doesn't know about
+	FILE* file = extract_cache.loaded ? NULL : fopen(EXTRACT_CACHE_INDEX, "r");
+	extract_cache.loaded = 1;
+	if (file) {
+		char line[MAX_PATH*2+128];
+		while (fgets(line, sizeof(line), file) && extract_cache.count<EXTRACT_CACHE_MAX) {
+			normalizeNewline(line);
+			trimTrailingNewlines(line);
+			CacheEntry* entry = &extract_cache.entries[extract_cache.count];
+			if (sscanf(line, "%lld\t%llu\t%llu\t%x\t%llu\t%511[^\t]\t%511[^\n]", &entry->src_mtime, &entry->src_size, &entry->size, &entry->crc, &entry->last_used, entry->src_path, entry->path)!=7) continue;
+			
+			// drop anything that went missing or was only partially written
+			struct stat st;
+			if (stat(entry->path, &st) || st.st_size!=entry->size) {
+				unlink(entry->path);
+				continue;
+			}
+			if (entry->last_used>extract_cache.uses) extract_cache.uses = entry->last_used;
+			extract_cache.count += 1;
+		}
+		fclose(file);
+	}
+	
+	// every tag has its own dir, sweep each the first time it's used
+	if (exactMatch(extract_cache.swept, dir_path)) return;
+	snprintf(extract_cache.swept, sizeof(extract_cache.swept), "%s", dir_path);
+	DIR* dir = opendir(dir_path);
+	if (dir) {
+		struct dirent* dp;
+		while ((dp = readdir(dir))) {
+			if (dp->d_name[0]=='.') continue;
+			char path[MAX_PATH];
+			snprintf(path, sizeof(path), "%s/%s", dir_path, dp->d_name);
+			if (ExtractCache_indexOf(path)!=-1) continue;
+			LOG_info("ExtractCache_load: removing untracked %s\n", path);
+			unlink(path);
+		}
+		closedir(dir);
+	}
+}
+static CacheEntry* ExtractCache_find(const char* src_path) {
+	struct stat st;
+	if (stat(src_path, &st)) return NULL;
+	
+	for (int i=0; i<extract_cache.count; i++) {
+		CacheEntry* entry = &extract_cache.entries[i];
+		if (!exactMatch(entry->src_path, src_path)) continue;
+		if (entry->src_mtime!=st.st_mtime || entry->src_size!=st.st_size) {
+			LOG_info("ExtractCache_find: %s changed since it was extracted\n", src_path);
+			ExtractCache_remove(i);
+			ExtractCache_save();
+			return NULL;
+		}
+		// a core may have written to it, or tmp may have been tampered with
+		uint64_t start = getMicroseconds();
+		if (!ExtractCache_verify(entry)) {
+			LOG_info("ExtractCache_find: %s doesn't match its crc, extracting again\n", entry->path);
+			ExtractCache_remove(i);
+			ExtractCache_save();
+			return NULL;
+		}
+		LOG_info("ExtractCache_find: verified %lluKB in %ims\n", entry->size / 1024, (int)((getMicroseconds() - start) / 1000));
+		entry->last_used = ++extract_cache.uses;
+		ExtractCache_save();
+		return entry;
+	}
+	return NULL;
+}
+static int ExtractCache_oldest(void) {
+	int oldest = 0;
+	for (int i=1; i<extract_cache.count; i++) {
+		if (extract_cache.entries[i].last_used<extract_cache.entries[oldest].last_used) oldest = i;
+	}
+	return oldest;
+}
+static void ExtractCache_reserve(unsigned long long size) { // evict until size fits the budget and the disk
+	unsigned long long budget = (unsigned long long)CFG_getExtractCacheSize() * 1024 * 1024;
+	while (extract_cache.count) {
+		unsigned long long total = 0;
+		for (int i=0; i<extract_cache.count; i++) {
+			total += extract_cache.entries[i].size;
+		}
+		
+		struct statvfs vfs;
+		int fits_disk = statvfs(EXTRACT_CACHE_DIR, &vfs) || size<(unsigned long long)vfs.f_bavail * vfs.f_frsize;
+		if (total+size<=budget && fits_disk) break;
+		
+		ExtractCache_remove(ExtractCache_oldest());
+	}
+	ExtractCache_save();
+}
+static void ExtractCache_add(const char* src_path, const char* path, unsigned long long size, uint32_t crc) {
+	struct stat st;
+	if (stat(src_path, &st)) return;
+	
+	int i = ExtractCache_indexOf(path);
+	if (i==-1) {
+		if (extract_cache.count==EXTRACT_CACHE_MAX) ExtractCache_remove(ExtractCache_oldest());
+		i = extract_cache.count++;
+	}
+	CacheEntry* entry = &extract_cache.entries[i];
+	snprintf(entry->src_path, sizeof(entry->src_path), "%s", src_path);
+	snprintf(entry->path, sizeof(entry->path), "%s", path);
+	entry->src_mtime = st.st_mtime;
+	entry->src_size = st.st_size;
+	entry->size = size;
+	entry->crc = crc;
+	entry->last_used = ++extract_cache.uses;
+	ExtractCache_save();
+}
+
 int extract_zip(char** extensions);
+static int Extractor_wait(void);
+static void Extractor_quit(void);
 static bool getAlias(char* path, char* alias);
 
 static struct Game {
@@ -141,8 +349,81 @@ static struct Game {
 	char tmp_path[MAX_PATH]; // location of unzipped file
 	void* data;
 	size_t size;
+	int is_mapped; // data is mmap'd rather than malloc'd
 	int is_open;
 } game;
+static size_t Game_getRSS(void) { // in KB
+	long pages = 0;
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (file) {
+		if (fscanf(file, "%*ld %ld", &pages)!=1) pages = 0;
+		fclose(file);
+	}
+	return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+static int Game_loadData(const char* path) {
+	uint64_t start = getMicroseconds();
+	size_t rss = Game_getRSS();
+	
+	int fd = open(path, O_RDONLY);
+	if (fd<0) {
+		LOG_error("Error opening game: %s\n\t%s\n", path, strerror(errno));
+		return 0;
+	}
+	
+	struct stat st;
+	if (fstat(fd, &st)) {
+		LOG_error("Error reading game: %s\n\t%s\n", path, strerror(errno));
+		close(fd);
+		return 0;
+	}
+	game.size = st.st_size;
+	
+	// map the rom instead of copying it, pages are shared with the page
+	// cache and only faulted in as the core touches them. private and
+	// writable since some cores patch their rom in place
+	if (game.size) {
+		void* data = mmap(NULL, game.size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if (data!=MAP_FAILED) {
+			madvise(data, game.size, MADV_WILLNEED);
+			madvise(data, game.size, MADV_SEQUENTIAL);
+			game.data = data;
+			game.is_mapped = 1;
+		}
+		else LOG_info("Couldn't map game, reading instead: %s\n", strerror(errno));
+	}
+	
+	if (!game.is_mapped) {
+		game.data = malloc(game.size ? game.size : 1);
+		if (game.data==NULL) {
+			LOG_error("Couldn't allocate memory for file: %s\n", path);
+			close(fd);
+			return 0;
+		}
+		
+		size_t total = 0;
+		while (total<game.size) {
+			ssize_t count = read(fd, (uint8_t*)game.data + total, game.size - total);
+			if (count<0 && errno==EINTR) continue;
+			if (count<=0) break;
+			total += count;
+		}
+		if (total!=game.size) {
+			LOG_error("Error reading game: %s (%u of %u bytes)\n", path, (unsigned)total, (unsigned)game.size);
+			free(game.data);
+			game.data = NULL;
+			close(fd);
+			return 0;
+		}
+	}
+	close(fd);
+	
+	LOG_info("Game_loadData: %s %uKB in %ims, rss %uKB -> %uKB\n", game.is_mapped ? "mapped" : "read",
+		(unsigned)(game.size / 1024), (int)((getMicroseconds() - start) / 1000),
+		(unsigned)rss, (unsigned)Game_getRSS()
+	);
+	return 1;
+}
 static void Game_open(char* path) {
 	LOG_info("Game_open\n");
 	int skipzip = 0;
@@ -165,14 +446,14 @@ static void Game_open(char* path) {
 
 	// check first if the rom already is alive in tmp folder if so skip unzipping shit
 	char tmpfldr[255];
-	snprintf(tmpfldr, sizeof(tmpfldr), "/tmp/nextarch/%s", core.tag);
-	char *tmppath = PLAT_findFileInDir(tmpfldr, game.name);
-	if (tmppath) {
-		printf("File exists skipping unzipping and setting game.tmp_path: %s\n", tmppath);
-		strncpy((char*)game.tmp_path, tmppath, sizeof(game.tmp_path) - 1);
+	snprintf(tmpfldr, sizeof(tmpfldr), EXTRACT_CACHE_DIR "/%s", core.tag);
+	ExtractCache_load(tmpfldr);
+	CacheEntry* cached = suffixMatch(".zip", game.path) ? ExtractCache_find(game.path) : NULL;
+	if (cached) {
+		printf("File exists skipping unzipping and setting game.tmp_path: %s\n", cached->path);
+		strncpy((char*)game.tmp_path, cached->path, sizeof(game.tmp_path) - 1);
 		game.tmp_path[sizeof(game.tmp_path) - 1] = '\0';
 		skipzip = 1;
-		free(tmppath);
 		// Update the game name to the extracted file name instead of the zip name
 		if (CFG_getUseExtractedFileName()) {
 			char* slash = strrchr(game.tmp_path, '/');
@@ -214,6 +495,8 @@ static void Game_open(char* path) {
 			// Update the game name to the extracted file name instead of the zip name
 			if (CFG_getUseExtractedFileName()) {
 				char* tmp = strrchr(game.tmp_path, '/');
+				char* hash = strrchr(game.tmp_path, '#'); // streamed as archive.zip#member
+				if (hash && hash>tmp) tmp = hash;
 				if (tmp) {
 					strncpy((char*)game.alt_name, tmp + 1, sizeof(game.alt_name) - 1);
 					((char*)game.alt_name)[sizeof(game.alt_name) - 1] = '\0';
@@ -227,28 +510,9 @@ static void Game_open(char* path) {
 		
 	// some cores handle opening files themselves, eg. pcsx_rearmed
 	// if the frontend tries to load a 500MB file itself bad things happen
-	if (!core.need_fullpath) {
+	if (!core.need_fullpath && !game.data) { // unless extract_zip is already inflating into it
 		path = game.tmp_path[0]=='\0'?game.path:game.tmp_path;
-
-		FILE *file = fopen(path, "r");
-		if (file==NULL) {
-			LOG_error("Error opening game: %s\n\t%s\n", path, strerror(errno));
-			return;
-		}
-	
-		fseek(file, 0, SEEK_END);
-		game.size = ftell(file);
-	
-		rewind(file);
-		game.data = malloc(game.size);
-		if (game.data==NULL) {
-			LOG_error("Couldn't allocate memory for file: %s\n", path);
-			return;
-		}
-	
-		fread(game.data, sizeof(uint8_t), game.size, file);
-	
-		fclose(file);
+		if (!Game_loadData(path)) return;
 	}
 	
 	// m3u-based?
@@ -297,7 +561,13 @@ static void Game_open(char* path) {
 	game.is_open = 1;
 }
 static void Game_close(void) {
-	if (game.data) free(game.data);
+	Extractor_quit();
+	if (game.data) {
+		if (game.is_mapped) munmap(game.data, game.size);
+		else free(game.data);
+	}
+	game.data = NULL;
+	game.is_mapped = 0;
 	game.is_open = 0;
 	VIB_setStrength(0); // just in case
 }
@@ -309,6 +579,7 @@ static void Game_changeDisc(char* path) {
 	
 	Game_close();
 	Game_open(path);
+	if (!Extractor_wait()) return;
 	
 	struct retro_game_info game_info = {};
 	game_info.path = game.path;
@@ -319,9 +590,183 @@ static void Game_changeDisc(char* path) {
 	putFile(CHANGE_DISC_PATH, path); // NextUI still needs to know this to update recents.txt
 }
 
+// extract_zip only picks the entry and its destination, inflating happens
+// on a worker so the core can init while it runs. cores that take data get
+// it inflated straight into game.data. the cache file is written as it goes
+// and is finished before the data is handed over
+static struct {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int running;
+	
+	struct zip* za;
+	zip_uint64_t index;
+	struct zip_stat sb;
+	char src_path[MAX_PATH];
+	char path[MAX_PATH];
+	uint8_t* data; // NULL if the core wants a path
+	
+	uint64_t done; // bytes inflated
+	int ready; // data or file is usable
+	int failed;
+	uint64_t start;
+} extractor = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static int Extractor_write(int fd, const uint8_t* data, size_t size) {
+	while (size) {
+		ssize_t count = write(fd, data, size);
+		if (count<0 && errno==EINTR) continue;
+		if (count<=0) return 0;
+		data += count;
+		size -= count;
+	}
+	return 1;
+}
+static void Extractor_signal(int ready, int failed) {
+	pthread_mutex_lock(&extractor.mutex);
+	extractor.ready = ready;
+	extractor.failed = failed;
+	pthread_cond_broadcast(&extractor.cond);
+	pthread_mutex_unlock(&extractor.mutex);
+}
+static void* Extractor_thread(void* arg) {
+	struct zip_stat* sb = &extractor.sb;
+	struct zip_file* zf = zip_fopen_index(extractor.za, extractor.index, 0);
+	int fd = -1;
+	char part_path[MAX_PATH];
+	// extract next to the final name so an interrupted extraction is never mistaken for a cached one
+	getTempPath(extractor.path, part_path);
+	
+	if (!zf) {
+		LOG_error("zip_fopen_index failed\n");
+		goto error;
+	}
+	fd = open(part_path, O_RDWR | O_TRUNC | O_CREAT, 0644);
+	if (fd < 0) {
+		LOG_error("open failed\n");
+		goto error;
+	}
+	
+	static uint8_t buf[64*1024];
+	uint32_t crc = 0;
+	uint64_t sum = 0;
+	while (sum != sb->size) {
+		uint8_t* dst = extractor.data ? extractor.data + sum : buf;
+		uint64_t chunk = sb->size - sum;
+		if (chunk>sizeof(buf)) chunk = sizeof(buf);
+		
+		zip_int64_t len = zip_fread(zf, dst, chunk);
+		if (len <= 0) {
+			LOG_error("zip_fread failed\n");
+			goto error;
+		}
+		if (fd>=0 && !Extractor_write(fd, dst, len)) {
+			LOG_error("write failed: %s\n", strerror(errno));
+			if (!extractor.data) goto error;
+			
+			// the core still gets its data, there just won't be a cache copy
+			close(fd);
+			fd = -1;
+			unlink(part_path);
+		}
+		crc = crc32_update(crc, dst, len);
+		sum += len;
+		__atomic_store_n(&extractor.done, sum, __ATOMIC_RELAXED);
+	}
+	zip_fclose(zf);
+	zf = NULL;
+	
+	if ((sb->valid & ZIP_STAT_CRC) && crc != sb->crc) {
+		LOG_error("extracted file is corrupt: %s\n", extractor.path);
+		goto error;
+	}
+	LOG_info("Extractor_thread: inflated %lluKB in %ims\n", (unsigned long long)sb->size / 1024, (int)((getMicroseconds() - extractor.start) / 1000));
+	
+	// the cache copy is complete before the core sees the data, it may patch it
+	if (fd>=0) {
+		close(fd);
+		fd = -1;
+		if (rename(part_path, extractor.path)) {
+			unlink(part_path);
+			if (!extractor.data) goto error;
+		}
+		else ExtractCache_add(extractor.src_path, extractor.path, sb->size, crc);
+	}
+	Extractor_signal(1, 0);
+	return NULL;
+	
+error:
+	if (zf) zip_fclose(zf);
+	if (fd>=0) {
+		close(fd);
+		unlink(part_path);
+	}
+	Extractor_signal(0, 1);
+	return NULL;
+}
+static int Extractor_wait(void) { // blocks until the game is usable, with progress on screen
+	if (!extractor.za) return 1;
+	
+	uint64_t start = getMicroseconds();
+	uint32_t last_draw = 0;
+	pthread_mutex_lock(&extractor.mutex);
+	while (!extractor.ready && !extractor.failed) {
+		uint32_t now = SDL_GetTicks();
+		if (now-last_draw>=50) {
+			pthread_mutex_unlock(&extractor.mutex);
+			last_draw = now;
+			uint64_t done = __atomic_load_n(&extractor.done, __ATOMIC_RELAXED);
+			char msg[64];
+			snprintf(msg, sizeof(msg), "Extracting %i%%", extractor.sb.size ? (int)(done * 100 / extractor.sb.size) : 0);
+			GFX_clear(screen);
+			GFX_blitMessage(font.large, msg, screen, &(SDL_Rect){0,0,screen->w,screen->h});
+			GFX_flip(screen);
+			pthread_mutex_lock(&extractor.mutex);
+			continue;
+		}
+		struct timespec timeout;
+		clock_gettime(CLOCK_REALTIME, &timeout);
+		timeout.tv_nsec += 10 * 1000000;
+		if (timeout.tv_nsec>=1000000000) {
+			timeout.tv_sec += 1;
+			timeout.tv_nsec -= 1000000000;
+		}
+		pthread_cond_timedwait(&extractor.cond, &extractor.mutex, &timeout);
+	}
+	int ok = extractor.ready;
+	pthread_mutex_unlock(&extractor.mutex);
+	
+	LOG_info("Extractor_wait: waited %ims\n", (int)((getMicroseconds() - start) / 1000));
+	return ok;
+}
+static void Extractor_quit(void) {
+	if (extractor.running) {
+		pthread_join(extractor.thread, NULL);
+		extractor.running = 0;
+	}
+	if (extractor.za) {
+		if (zip_close(extractor.za) == -1) zip_discard(extractor.za);
+		extractor.za = NULL;
+	}
+	extractor.data = NULL; // owned by game
+	extractor.ready = 0;
+	extractor.failed = 0;
+	extractor.done = 0;
+}
+
+static int isMultiFileImage(const char* name) {
+	char* exts[] = {".cue",".gdi",".m3u",".ccd",".toc",".mds",NULL};
+	for (int i=0; exts[i]; i++) {
+		if (suffixMatch(exts[i], name)) return 1;
+	}
+	return 0;
+}
 int extract_zip(char** extensions)
 {
-	char buf[100];
 	struct zip *za;
 	int ze;
 	if ((za = zip_open(game.path, 0, &ze)) == NULL) {
@@ -334,16 +779,13 @@ int extract_zip(char** extensions)
 	// char tmp_template[MAX_PATH];
 	// strcpy(tmp_template, "/tmp/minarch-XXXXXX");
 	
-	mkdir("/tmp/nextarch",0777);
+	mkdir(EXTRACT_CACHE_DIR,0777);
 	char tmp_dirname[255];
-	snprintf(tmp_dirname, sizeof(tmp_dirname), "%s/%s", "/tmp/nextarch",core.tag);
+	snprintf(tmp_dirname, sizeof(tmp_dirname), "%s/%s", EXTRACT_CACHE_DIR,core.tag);
 	mkdir(tmp_dirname,0777);
 
 	int i, len;
-	int fd;
-	struct zip_file *zf;
 	struct zip_stat sb;
-	long long sum;
 	for (i = 0; i < zip_get_num_entries(za, 0); i++) {
 		if (zip_stat_index(za, i, 0, &sb) == 0) {
 			len = strlen(sb.name);
@@ -363,36 +805,43 @@ int extract_zip(char** extensions)
 					}
 				}
 				if (!found) continue;
-
-				zf = zip_fopen_index(za, i, 0);
-				if (!zf) {
-					LOG_error( "zip_fopen_index failed\n");
-					return 0;
+				
+				// cores that read the game through our vfs can stream a stored
+				// member straight out of the archive. deflated ones would have to
+				// inflate from the start on every backward seek, and formats that
+				// name other files by relative path need them next to each other
+				int stored = (sb.valid & ZIP_STAT_COMP_METHOD) && sb.comp_method==ZIP_CM_STORE
+					&& (!(sb.valid & ZIP_STAT_ENCRYPTION_METHOD) || sb.encryption_method==ZIP_EM_NONE);
+				if (core.need_fullpath && core.vfs && stored && !isMultiFileImage(sb.name)
+					&& snprintf(game.tmp_path, sizeof(game.tmp_path), "%s#%s", game.path, sb.name)<sizeof(game.tmp_path)) {
+					LOG_info("Streaming %s out of %s\n", sb.name, game.path);
+					zip_close(za);
+					return 1;
 				}
 
+				ExtractCache_reserve(sb.size);
 				snprintf(game.tmp_path, sizeof(game.tmp_path), "%s/%s", tmp_dirname, basename((char*)sb.name));
-				fd = open(game.tmp_path, O_RDWR | O_TRUNC | O_CREAT, 0644);
-				if (fd < 0) {
-					LOG_error( "open failed\n");
-					zip_fclose(zf);
-					return 0;
-				}
-				//LOG_info("Writing: %s\n", game.tmp_path);
-
-				sum = 0;
-				while (sum != sb.size) {
-					len = zip_fread(zf, buf, 100);
-					if (len < 0) {
-						LOG_error( "zip_fread failed\n");
-						close(fd);
-						zip_fclose(zf);
+				
+				extractor.za = za;
+				extractor.index = i;
+				extractor.sb = sb;
+				extractor.start = getMicroseconds();
+				strcpy(extractor.src_path, game.path);
+				strcpy(extractor.path, game.tmp_path);
+				
+				if (!core.need_fullpath) {
+					extractor.data = malloc(sb.size ? sb.size : 1);
+					if (!extractor.data) {
+						LOG_error("Couldn't allocate memory for file: %s\n", game.tmp_path);
+						Extractor_quit();
 						return 0;
 					}
-					write(fd, buf, len);
-					sum += len;
+					game.data = extractor.data;
+					game.size = sb.size;
 				}
-				close(fd);
-				zip_fclose(zf);
+				
+				extractor.running = pthread_create(&extractor.thread, NULL, Extractor_thread, NULL) == 0;
+				if (!extractor.running) Extractor_thread(NULL);
 				return 1;
 			}
 		}
@@ -400,7 +849,7 @@ int extract_zip(char** extensions)
 	
 	if (zip_close(za) == -1) {
 		LOG_error("can't close zip archive `%s'\n", game.path);
-		return 0;
+		zip_discard(za);
 	}
 
 	return 0;
@@ -768,6 +1217,205 @@ static void SRAM_getPath(char* filename) {
 	LOG_info("SRAM_getPath %s\n", filename);
 }
 
+static int SRAM_writeFile(const char* filename, const void* sram, size_t sram_size) {
+	char tmp_path[MAX_PATH];
+	getTempPath(filename, tmp_path);
+
+#ifdef HAS_SRM
+	// srm, compressed
+	if (CFG_getSaveFormat() == SAVE_FORMAT_SRM) {
+		if(!rzipstream_write_file(tmp_path, sram, sram_size)) {
+			LOG_error("rzipstream: Error writing SRAM data to file\n");
+			unlink(tmp_path);
+			return 0;
+		}
+	}
+	else {
+		if(!filestream_write_file(tmp_path, sram, sram_size)) {
+			LOG_error("filestream: Error writing SRAM data to file\n");
+			unlink(tmp_path);
+			return 0;
+		}
+	}
+	if (!commitFile(tmp_path, filename)) {
+		LOG_error("Error replacing SRAM file: %s\n", strerror(errno));
+		return 0;
+	}
+#else
+	if (!putFileDurable(filename, sram, sram_size)) {
+		LOG_error("Error writing SRAM data to file: %s\n", strerror(errno));
+		return 0;
+	}
+#endif
+	return 1;
+}
+
+// sram is hashed every SRAM_CHECK_FRAMES and only written once it has
+// stopped changing for SRAM_SETTLE_FRAMES, by a worker thread, so in-game
+// saves survive a crash or dead battery without hammering the sd card
+#define SRAM_CHECK_FRAMES 30
+#define SRAM_SETTLE_FRAMES 120
+
+static struct {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int running;
+	int quit;
+	
+	void* buffer;
+	size_t capacity;
+	size_t size;
+	uint32_t queued_hash; // hash of the queued buffer
+	char path[MAX_PATH];
+	int pending;
+	int writing;
+	
+	uint32_t saved_hash; // of what's on disk
+	int has_saved;
+	uint32_t last_hash; // at the previous check
+	int frame;
+	int settled;
+	
+	int writes;
+	uint64_t bytes;
+	uint64_t start;
+} sram_writer = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+};
+
+static uint32_t SRAM_hash(const void* data, size_t size) { // fnv-1a
+	const uint8_t* bytes = data;
+	uint32_t hash = 2166136261u;
+	for (size_t i=0; i<size; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+static void SRAM_logStats(const char* reason) {
+	double hours = (getMicroseconds() - sram_writer.start) / 3600000000.0;
+	if (hours<=0) return;
+	LOG_info("SRAM %s: %i writes, %lluKB (%.1f writes/hr, %.1fKB/hr)\n", reason,
+		sram_writer.writes, (unsigned long long)(sram_writer.bytes / 1024),
+		sram_writer.writes / hours, sram_writer.bytes / 1024.0 / hours
+	);
+}
+static void SRAM_saved(uint32_t hash, size_t size) { // call with mutex held
+	sram_writer.saved_hash = hash;
+	sram_writer.has_saved = 1;
+	sram_writer.writes += 1;
+	sram_writer.bytes += size;
+}
+static void* SRAM_writerThread(void* arg) {
+	pthread_mutex_lock(&sram_writer.mutex);
+	while (1) {
+		while (!sram_writer.pending && !sram_writer.quit) {
+			pthread_cond_wait(&sram_writer.cond, &sram_writer.mutex);
+		}
+		if (!sram_writer.pending) break;
+		
+		char path[MAX_PATH];
+		strcpy(path, sram_writer.path);
+		size_t size = sram_writer.size;
+		uint32_t hash = sram_writer.queued_hash;
+		sram_writer.pending = 0;
+		sram_writer.writing = 1;
+		pthread_mutex_unlock(&sram_writer.mutex);
+		
+		uint64_t start = getMicroseconds();
+		int ok = SRAM_writeFile(path, sram_writer.buffer, size);
+		
+		pthread_mutex_lock(&sram_writer.mutex);
+		sram_writer.writing = 0;
+		if (ok) {
+			SRAM_saved(hash, size);
+			LOG_info("SRAM_writerThread: %ims\n", (int)((getMicroseconds() - start) / 1000));
+			SRAM_logStats("autosave");
+		}
+		pthread_cond_broadcast(&sram_writer.cond);
+	}
+	pthread_mutex_unlock(&sram_writer.mutex);
+	return NULL;
+}
+static void SRAM_flush(void) {
+	pthread_mutex_lock(&sram_writer.mutex);
+	while (sram_writer.pending || sram_writer.writing) {
+		pthread_cond_wait(&sram_writer.cond, &sram_writer.mutex);
+	}
+	pthread_mutex_unlock(&sram_writer.mutex);
+}
+static void SRAM_writerQuit(void) {
+	if (sram_writer.running) {
+		pthread_mutex_lock(&sram_writer.mutex);
+		sram_writer.quit = 1;
+		pthread_cond_broadcast(&sram_writer.cond);
+		pthread_mutex_unlock(&sram_writer.mutex);
+		pthread_join(sram_writer.thread, NULL);
+		sram_writer.running = 0;
+		sram_writer.quit = 0;
+	}
+	if (sram_writer.buffer) free(sram_writer.buffer);
+	sram_writer.buffer = NULL;
+	sram_writer.capacity = 0;
+}
+static void SRAM_monitor(void) { // call once per frame
+	if (++sram_writer.frame<SRAM_CHECK_FRAMES) return;
+	sram_writer.frame = 0;
+	
+	size_t sram_size = core.get_memory_size(RETRO_MEMORY_SAVE_RAM);
+	void* sram = core.get_memory_data(RETRO_MEMORY_SAVE_RAM);
+	if (!sram_size || !sram) return;
+	
+	if (!sram_writer.start) sram_writer.start = getMicroseconds();
+	
+	pthread_mutex_lock(&sram_writer.mutex);
+	int busy = sram_writer.pending || sram_writer.writing;
+	uint32_t saved_hash = sram_writer.saved_hash;
+	int has_saved = sram_writer.has_saved;
+	pthread_mutex_unlock(&sram_writer.mutex);
+	if (busy) return;
+	
+	uint32_t hash = SRAM_hash(sram, sram_size);
+	if (has_saved && hash==saved_hash) {
+		sram_writer.last_hash = hash;
+		sram_writer.settled = 0;
+		return;
+	}
+	if (hash!=sram_writer.last_hash) { // still being written by the game
+		sram_writer.last_hash = hash;
+		sram_writer.settled = 0;
+		return;
+	}
+	
+	sram_writer.settled += SRAM_CHECK_FRAMES;
+	if (sram_writer.settled<SRAM_SETTLE_FRAMES) return;
+	sram_writer.settled = 0;
+	
+	if (!sram_writer.running) {
+		sram_writer.running = pthread_create(&sram_writer.thread, NULL, SRAM_writerThread, NULL) == 0;
+		if (!sram_writer.running) return; // still written on menu and quit
+	}
+	if (sram_writer.capacity<sram_size) {
+		void* buffer = realloc(sram_writer.buffer, sram_size);
+		if (!buffer) return;
+		sram_writer.buffer = buffer;
+		sram_writer.capacity = sram_size;
+	}
+	
+	// the worker is idle so the buffer is ours
+	memcpy(sram_writer.buffer, sram, sram_size);
+	
+	pthread_mutex_lock(&sram_writer.mutex);
+	SRAM_getPath(sram_writer.path);
+	sram_writer.size = sram_size;
+	sram_writer.queued_hash = hash;
+	sram_writer.pending = 1;
+	pthread_cond_signal(&sram_writer.cond);
+	pthread_mutex_unlock(&sram_writer.mutex);
+}
+
 static void SRAM_read(void) {
 	size_t sram_size = core.get_memory_size(RETRO_MEMORY_SAVE_RAM);
 	if (!sram_size) return;
@@ -777,6 +1425,7 @@ static void SRAM_read(void) {
 	printf("sav path (read): %s\n", filename);
 
 	void* sram = core.get_memory_data(RETRO_MEMORY_SAVE_RAM);
+	sram_writer.has_saved = 0;
 
 #ifdef HAS_SRM
 	// rzipstream handles both compressed and uncompressed formats
@@ -807,40 +1456,42 @@ static void SRAM_read(void) {
 	}
 	fclose(sram_file);
 #endif
+
+	// what we just loaded doesn't need writing back
+	if (sram) {
+		sram_writer.saved_hash = SRAM_hash(sram, sram_size);
+		sram_writer.has_saved = 1;
+		sram_writer.last_hash = sram_writer.saved_hash;
+	}
 }
 
 static void SRAM_write(void) {
 	size_t sram_size = core.get_memory_size(RETRO_MEMORY_SAVE_RAM);
 	if (!sram_size) return;
 	
+	void *sram = core.get_memory_data(RETRO_MEMORY_SAVE_RAM);
+	if (!sram) return;
+	
+	SRAM_flush();
+	
+	uint32_t hash = SRAM_hash(sram, sram_size);
+	if (sram_writer.has_saved && hash==sram_writer.saved_hash) {
+		LOG_info("SRAM_write: unchanged, skipping\n");
+		return;
+	}
+	
 	char filename[MAX_PATH];
 	SRAM_getPath(filename);
 	printf("sav path (write): %s\n", filename);
 	
-	void *sram = core.get_memory_data(RETRO_MEMORY_SAVE_RAM);
-
-#ifdef HAS_SRM
-	// srm, compressed
-	if (CFG_getSaveFormat() == SAVE_FORMAT_SRM) {
-		if(!rzipstream_write_file(filename, sram, sram_size))
-			LOG_error("rzipstream: Error writing SRAM data to file\n");
-	}
-	else {
-		if(!filestream_write_file(filename, sram, sram_size))
-			LOG_error("filestream: Error writing SRAM data to file\n");
-	}
-#else
-	FILE *sram_file = fopen(filename, "w");
-	if (!sram_file) {
-		LOG_error("Error opening SRAM file: %s\n", strerror(errno));
-		return;
-	}
-	if (!sram || sram_size != fwrite(sram, 1, sram_size, sram_file)) {
-		LOG_error("Error writing SRAM data to file\n");
-	}
-	fclose(sram_file);
-#endif
-	sync();
+	uint64_t start = getMicroseconds();
+	if (!SRAM_writeFile(filename, sram, sram_size)) return;
+	
+	pthread_mutex_lock(&sram_writer.mutex);
+	SRAM_saved(hash, sram_size);
+	pthread_mutex_unlock(&sram_writer.mutex);
+	LOG_info("SRAM_write: %ims\n", (int)((getMicroseconds() - start) / 1000));
+	SRAM_logStats("session");
 }
 
 ///////////////////////////////////////
@@ -875,21 +1526,273 @@ static void RTC_write(void) {
 	RTC_getPath(filename);
 	printf("rtc path (write) size(%u): %s\n", rtc_size, filename);
 		
-	FILE *rtc_file = fopen(filename, "w");
-	if (!rtc_file) {
-		LOG_error("Error opening RTC file: %s\n", strerror(errno));
+	void *rtc = core.get_memory_data(RETRO_MEMORY_RTC);
+	if (!rtc) return;
+	
+	uint64_t start = getMicroseconds();
+	if (!putFileDurable(filename, rtc, rtc_size)) {
+		LOG_error("Error writing RTC data to file: %s\n", strerror(errno));
 		return;
 	}
+	LOG_info("RTC_write: %ims\n", (int)((getMicroseconds() - start) / 1000));
+}
 
-	void *rtc = core.get_memory_data(RETRO_MEMORY_RTC);
+///////////////////////////////////////
+// state buffers
+
+// serialize_size() is cached per game and state buffers are only ever
+// grown, so saving, loading and rewinding don't hit the allocator (and
+// fault in fresh pages) for multi-megabyte states every time
+
+typedef struct StateBuffer {
+	void* data;
+	size_t capacity;
+} StateBuffer;
 
-	if (!rtc || rtc_size != fwrite(rtc, 1, rtc_size, rtc_file)) {
-		LOG_error("Error writing RTC data to file\n");
+static struct {
+	size_t size;
+	int size_valid;
+	
+	StateBuffer read;
+	StateBuffer packed; // compressed read
+	
+	size_t allocated;
+	size_t peak;
+} state_buffers;
+
+static void State_invalidateSize(void) {
+	state_buffers.size_valid = 0;
+}
+static size_t State_getSize(void) {
+	if (!state_buffers.size_valid || (core.serialization_quirks & RETRO_SERIALIZATION_QUIRK_CORE_VARIABLE_SIZE)) {
+		size_t size = core.serialize_size();
+		if (size!=state_buffers.size) LOG_info("State_getSize: %u bytes\n", (unsigned)size);
+		state_buffers.size = size;
+		state_buffers.size_valid = 1;
 	}
+	return state_buffers.size;
+}
+static void* StateBuffer_reserve(StateBuffer* buffer, size_t size) { // contents are not preserved
+	if (buffer->capacity>=size) return buffer->data;
+	
+	void* data = realloc(buffer->data, size);
+	if (!data) {
+		LOG_error("Couldn't allocate memory for state\n");
+		return NULL;
+	}
+	// the state writer grows its buffers on another thread
+	size_t allocated = __sync_add_and_fetch(&state_buffers.allocated, size - buffer->capacity);
+	if (allocated>state_buffers.peak) state_buffers.peak = allocated;
+	buffer->data = data;
+	buffer->capacity = size;
+	return data;
+}
+static void StateBuffer_free(StateBuffer* buffer) {
+	if (buffer->data) free(buffer->data);
+	__sync_sub_and_fetch(&state_buffers.allocated, buffer->capacity);
+	buffer->data = NULL;
+	buffer->capacity = 0;
+}
 
-	fclose(rtc_file);
+///////////////////////////////////////
+// state codecs
 
-	sync();
+// states saved with an explicit codec start with a StateHeader, anything
+// else is a legacy rzip or raw state and is loaded exactly as before.
+// lz4 is built in (common/lz4.c) and trades size for the fastest saves and
+// loads, zstd is resolved at runtime from the libzstd we already ship for libzip
+
+enum {
+	STATE_CODEC_SYSTEM = -1, // rzip or raw, per CFG_getStateFormat()
+	STATE_CODEC_RAW,
+	STATE_CODEC_ZSTD,
+	STATE_CODEC_LZ4,
+};
+static struct {
+	int codec;
+	int level;
+} state_codec_modes[] = { // indexed by state_codec
+	{STATE_CODEC_SYSTEM, 0},
+	{STATE_CODEC_RAW, 0},
+	{STATE_CODEC_LZ4, 0},
+	{STATE_CODEC_ZSTD, 1},
+	{STATE_CODEC_ZSTD, 3},
+	{STATE_CODEC_ZSTD, 9},
+};
+
+#define STATE_MAGIC "NXSTATE"
+#define STATE_VERSION 1
+
+typedef struct StateHeader {
+	char magic[8];
+	uint8_t version;
+	uint8_t codec;
+	uint8_t level;
+	uint8_t reserved[5];
+	uint64_t size; // uncompressed
+	uint64_t data_size; // follows the header
+} StateHeader;
+
+static struct {
+	int tried;
+	void* handle;
+	size_t (*compressBound)(size_t src_size);
+	size_t (*compress)(void* dst, size_t dst_capacity, const void* src, size_t src_size, int level);
+	size_t (*decompress)(void* dst, size_t dst_capacity, const void* src, size_t src_size);
+	unsigned (*isError)(size_t code);
+} zstd;
+
+static int Zstd_load(void) { // call from the main thread only
+	if (zstd.tried) return zstd.handle!=NULL;
+	zstd.tried = 1;
+	
+	void* handle = dlopen("libzstd.so.1", RTLD_NOW|RTLD_LOCAL);
+	if (!handle) {
+		LOG_info("Zstd_load: %s\n", dlerror());
+		return 0;
+	}
+	zstd.compressBound = dlsym(handle, "ZSTD_compressBound");
+	zstd.compress = dlsym(handle, "ZSTD_compress");
+	zstd.decompress = dlsym(handle, "ZSTD_decompress");
+	zstd.isError = dlsym(handle, "ZSTD_isError");
+	if (!zstd.compressBound || !zstd.compress || !zstd.decompress || !zstd.isError) {
+		LOG_error("Zstd_load: missing symbols\n");
+		dlclose(handle);
+		return 0;
+	}
+	zstd.handle = handle;
+	return 1;
+}
+static void Zstd_unload(void) {
+	if (zstd.handle) dlclose(zstd.handle);
+	memset(&zstd, 0, sizeof(zstd));
+}
+
+static int State_getCodec(int* level) { // resolves state_codec to something we can actually write
+	int codec = state_codec_modes[state_codec].codec;
+	*level = state_codec_modes[state_codec].level;
+	if (codec==STATE_CODEC_ZSTD && !Zstd_load()) codec = STATE_CODEC_SYSTEM;
+	return codec;
+}
+static char* State_codecName(int codec) {
+	switch (codec) {
+		case STATE_CODEC_RAW: return "raw";
+		case STATE_CODEC_ZSTD: return "zstd";
+		case STATE_CODEC_LZ4: return "lz4";
+		default: return "unknown";
+	}
+}
+
+static int State_encodeFile(const char* filename, const void* state, size_t state_size, int codec, int level, StateBuffer* scratch) {
+	uint64_t start = getMicroseconds();
+	
+	size_t bound = state_size;
+	if (codec==STATE_CODEC_ZSTD) bound = zstd.compressBound(state_size);
+	else if (codec==STATE_CODEC_LZ4) bound = LZ4_compressBound(state_size);
+	if (!bound) return 0;
+	uint8_t* data = StateBuffer_reserve(scratch, sizeof(StateHeader) + bound);
+	if (!data) return 0;
+	
+	size_t data_size = state_size;
+	if (codec==STATE_CODEC_ZSTD) {
+		data_size = zstd.compress(data + sizeof(StateHeader), bound, state, state_size, level);
+		if (zstd.isError(data_size)) {
+			LOG_error("Error compressing state data\n");
+			return 0;
+		}
+	}
+	else if (codec==STATE_CODEC_LZ4) {
+		data_size = LZ4_compress_default(state, (char*)data + sizeof(StateHeader), state_size, bound);
+		if (!data_size) {
+			LOG_error("Error compressing state data\n");
+			return 0;
+		}
+	}
+	else {
+		memcpy(data + sizeof(StateHeader), state, state_size);
+	}
+	
+	StateHeader header = {
+		.magic = STATE_MAGIC,
+		.version = STATE_VERSION,
+		.codec = codec,
+		.level = level,
+		.size = state_size,
+		.data_size = data_size,
+	};
+	memcpy(data, &header, sizeof(header));
+	
+	uint64_t encoded = getMicroseconds();
+	if (!putFileDurable(filename, data, sizeof(StateHeader) + data_size)) {
+		LOG_error("Error writing state data to file: %s (%s)\n", filename, strerror(errno));
+		return 0;
+	}
+	
+	double ms = (encoded - start) / 1000.0;
+	LOG_info("State_encodeFile: %s %i, %uKB -> %uKB (%.1f%%) in %.1fms (%.1fMB/s), written in %ims\n",
+		State_codecName(codec), level, (unsigned)(state_size / 1024), (unsigned)(data_size / 1024),
+		100.0 * data_size / state_size, ms, ms>0 ? state_size / 1024.0 / 1024.0 / (ms / 1000.0) : 0,
+		(int)((getMicroseconds() - encoded) / 1000)
+	);
+	return 1;
+}
+static int State_decodeFile(const char* filename, void* state, size_t state_size) { // -1 if filename isn't one of ours
+	FILE* file = fopen(filename, "r");
+	if (!file) return -1;
+	
+	int result = 0;
+	StateHeader header;
+	if (fread(&header, 1, sizeof(header), file)!=sizeof(header) || memcmp(header.magic, STATE_MAGIC, sizeof(header.magic))) {
+		result = -1; // legacy state
+		goto finish;
+	}
+	
+	uint64_t start = getMicroseconds();
+	if (header.version>STATE_VERSION || header.size>state_size) {
+		LOG_error("Unsupported state file: %s (v%i, %u bytes)\n", filename, header.version, (unsigned)header.size);
+		goto finish;
+	}
+	if (header.codec==STATE_CODEC_ZSTD && !Zstd_load()) {
+		LOG_error("Can't load zstd state without libzstd: %s\n", filename);
+		goto finish;
+	}
+	
+	// some cores report a larger size than they actually use, the rest stays zeroed
+	if (header.codec==STATE_CODEC_RAW) {
+		if (header.data_size!=header.size || fread(state, 1, header.size, file)!=header.size) goto read_error;
+	}
+	else if (header.codec==STATE_CODEC_ZSTD) {
+		void* data = StateBuffer_reserve(&state_buffers.packed, header.data_size);
+		if (!data || fread(data, 1, header.data_size, file)!=header.data_size) goto read_error;
+		size_t size = zstd.decompress(state, state_size, data, header.data_size);
+		if (zstd.isError(size) || size!=header.size) {
+			LOG_error("Error decompressing state data: %s\n", filename);
+			goto finish;
+		}
+	}
+	else if (header.codec==STATE_CODEC_LZ4) {
+		void* data = StateBuffer_reserve(&state_buffers.packed, header.data_size);
+		if (!data || fread(data, 1, header.data_size, file)!=header.data_size) goto read_error;
+		int size = LZ4_decompress_safe(data, state, header.data_size, state_size);
+		if (size<0 || size!=header.size) {
+			LOG_error("Error decompressing state data: %s\n", filename);
+			goto finish;
+		}
+	}
+	else {
+		LOG_error("Unknown state codec %i: %s\n", header.codec, filename);
+		goto finish;
+	}
+	
+	LOG_info("State_decodeFile: %s, %uKB in %ims\n", State_codecName(header.codec), (unsigned)(header.size / 1024), (int)((getMicroseconds() - start) / 1000));
+	result = 1;
+	goto finish;
+	
+read_error:
+	LOG_error("Error reading state data from file: %s (%s)\n", filename, strerror(errno));
+finish:
+	fclose(file);
+	return result;
 }
 
 ///////////////////////////////////////
@@ -944,21 +1847,31 @@ static void State_getPath(char* filename) {
 	}
 }
 
+static void State_flush(void);
 static void State_read(void) { // from picoarch
-	size_t state_size = core.serialize_size();
+	size_t state_size = State_getSize();
 	if (!state_size) return;
+	
+	State_flush(); // the slot may still be queued for writing
 
 	int was_ff = fast_forward;
 	fast_forward = 0;
 
-	void *state = calloc(1, state_size);
-	if (!state) {
-		LOG_error("Couldn't allocate memory for state\n");
-		goto error;
-	}
+	void *state = StateBuffer_reserve(&state_buffers.read, state_size);
+	if (!state) goto error;
+	memset(state, 0, state_size);
 
 	char filename[MAX_PATH];
 	State_getPath(filename);
+	
+	int decoded = State_decodeFile(filename, state, state_size);
+	if (decoded!=-1) {
+		if (decoded && !core.unserialize(state, state_size)) {
+			LOG_error("Error restoring save state: %s (%s)\n", filename, strerror(errno));
+		}
+		fast_forward = was_ff;
+		return;
+	}
 
 #ifdef HAS_SRM
 	RFILE *state_rfile = NULL;
@@ -1009,7 +1922,6 @@ static void State_read(void) { // from picoarch
 	}
 
 error:
-	if (state) free(state);
 	if (state_rfile) filestream_close(state_rfile);
 	if (state_rzfile) rzipstream_close(state_rzfile);
 #else
@@ -1034,66 +1946,264 @@ error:
 	}
 
 error:
-	if (state) free(state);
 	if (state_file) fclose(state_file);
 #endif
 	fast_forward = was_ff;
 }
 
-static void State_write(void) { // from picoarch
-	size_t state_size = core.serialize_size();
-	if (!state_size) return;
-	
-	int was_ff = fast_forward;
-	fast_forward = 0;
+// State_write only serializes on the emulation thread, compressing and
+// writing happen on a worker. Two buffers let the next save serialize while
+// the previous one is still being written.
+typedef struct StatePreview {
+	uint32_t* pixels; // RGBA8888, packed
+	int w;
+	int h;
+} StatePreview;
+static void SlotIndex_commit(int slot, size_t size, int codec, const StatePreview* preview);
 
-	void *state = calloc(1, state_size);
-	if (!state) {
-		LOG_error("Couldn't allocate memory for state\n");
-		goto error;
-	}
+enum {
+	STATE_WRITER_IDLE,
+	STATE_WRITER_BUSY,
+	STATE_WRITER_DONE,
+	STATE_WRITER_FAILED,
+};
+static struct {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	int running;
+	int quit;
+	
+	StateBuffer buffers[2];
+	StatePreview previews[2]; // for the slot index, follows the buffer
+	int writing; // buffer owned by the worker, -1 if none
+	
+	int pending; // a job is waiting to be picked up
+	int buffer;
+	size_t size;
+	int format;
+	int codec;
+	int level;
+	int slot; // to update in the slot index once written, -1 for none
+	char path[MAX_PATH];
+	
+	StateBuffer packed; // owned by whoever is writing
+	
+	int status;
+} state_writer = {
+	.mutex = PTHREAD_MUTEX_INITIALIZER,
+	.cond = PTHREAD_COND_INITIALIZER,
+	.writing = -1,
+};
 
-	if (!core.serialize(state, state_size)) {
-		LOG_error("Error serializing save state\n");
-		goto error;
-	}
+static int State_writeFile(const char* filename, const void* state, size_t state_size, int format, int codec, int level) {
+	if (codec!=STATE_CODEC_SYSTEM) return State_encodeFile(filename, state, state_size, codec, level, &state_writer.packed);
+	
+	// write next to the real file and swap it in once complete so a crash
+	// or power loss never leaves a truncated state behind
+	char tmp_path[MAX_PATH];
+	getTempPath(filename, tmp_path);
 	
-	char filename[MAX_PATH];
-	State_getPath(filename);
 #ifdef HAS_SRM
-	if (CFG_getStateFormat() == STATE_FORMAT_SRM || CFG_getStateFormat() == STATE_FORMAT_SRM_EXTRADOT) {
-		if(!rzipstream_write_file(filename, state, state_size)) {
-			LOG_error("rzipstream: Error writing state data to file: %s\n", filename);
+	if (format == STATE_FORMAT_SRM || format == STATE_FORMAT_SRM_EXTRADOT) {
+		if(!rzipstream_write_file(tmp_path, state, state_size)) {
+			LOG_error("rzipstream: Error writing state data to file: %s\n", tmp_path);
 			goto error;
 		}
 	}
 	else {
-		if(!filestream_write_file(filename, state, state_size)) {
-			LOG_error("filestream: Error writing state data to file: %s\n", filename);
+		if(!filestream_write_file(tmp_path, state, state_size)) {
+			LOG_error("filestream: Error writing state data to file: %s\n", tmp_path);
 			goto error;
 		}
 	}
-
-error:
-	if (state) free(state);
 #else
-	FILE *state_file = fopen(filename, "w");
+	FILE *state_file = fopen(tmp_path, "w");
 	if (!state_file) {
-		LOG_error("Error opening state file: %s (%s)\n", filename, strerror(errno));
+		LOG_error("Error opening state file: %s (%s)\n", tmp_path, strerror(errno));
 		goto error;
 	}
 	if (state_size != fwrite(state, 1, state_size, state_file)) {
-		LOG_error("Error writing state data to file: %s (%s)\n", filename, strerror(errno));
+		LOG_error("Error writing state data to file: %s (%s)\n", tmp_path, strerror(errno));
+		fclose(state_file);
 		goto error;
 	}
-	error:
-	if (state) free(state);
-	if (state_file) fclose(state_file);
+	fclose(state_file);
 #endif
+	
+	if (!commitFile(tmp_path, filename)) {
+		LOG_error("Error replacing state file: %s (%s)\n", filename, strerror(errno));
+		return 0;
+	}
+	return 1;
+	
+error:
+	unlink(tmp_path);
+	return 0;
+}
+static void* State_writerThread(void* arg) {
+	pthread_mutex_lock(&state_writer.mutex);
+	while (1) {
+		while (!state_writer.pending && !state_writer.quit) {
+			pthread_cond_wait(&state_writer.cond, &state_writer.mutex);
+		}
+		if (!state_writer.pending && state_writer.quit) break;
+		
+		int buffer = state_writer.buffer;
+		size_t size = state_writer.size;
+		int format = state_writer.format;
+		int codec = state_writer.codec;
+		int level = state_writer.level;
+		int slot = state_writer.slot;
+		char path[MAX_PATH];
+		strcpy(path, state_writer.path);
+		
+		state_writer.writing = buffer;
+		state_writer.pending = 0;
+		pthread_mutex_unlock(&state_writer.mutex);
+		
+		uint64_t start = getMicroseconds();
+		int ok = State_writeFile(path, state_writer.buffers[buffer].data, size, format, codec, level);
+		LOG_info("State_writerThread: %s %s in %ims\n", ok ? "wrote" : "failed to write", path, (int)((getMicroseconds() - start) / 1000));
+		if (ok) SlotIndex_commit(slot, size, codec, &state_writer.previews[buffer]);
+		
+		pthread_mutex_lock(&state_writer.mutex);
+		state_writer.writing = -1;
+		if (!state_writer.pending) state_writer.status = ok ? STATE_WRITER_DONE : STATE_WRITER_FAILED;
+		pthread_cond_broadcast(&state_writer.cond);
+	}
+	pthread_mutex_unlock(&state_writer.mutex);
+	return NULL;
+}
+static void State_writerInit(void) {
+	if (state_writer.running) return;
+	state_writer.quit = 0;
+	state_writer.running = pthread_create(&state_writer.thread, NULL, State_writerThread, NULL) == 0;
+	if (!state_writer.running) LOG_error("Couldn't start state writer thread, saving synchronously\n");
+}
+static void State_flush(void) { // blocks until all queued states are on disk
+	pthread_mutex_lock(&state_writer.mutex);
+	while (state_writer.pending || state_writer.writing!=-1) {
+		pthread_cond_wait(&state_writer.cond, &state_writer.mutex);
+	}
+	pthread_mutex_unlock(&state_writer.mutex);
+}
+static void State_writerQuit(void) {
+	if (state_writer.running) {
+		pthread_mutex_lock(&state_writer.mutex);
+		state_writer.quit = 1;
+		pthread_cond_broadcast(&state_writer.cond);
+		pthread_mutex_unlock(&state_writer.mutex);
+		pthread_join(state_writer.thread, NULL);
+		state_writer.running = 0;
+	}
+	for (int i=0; i<2; i++) {
+		StateBuffer_free(&state_writer.buffers[i]);
+		free(state_writer.previews[i].pixels);
+		state_writer.previews[i] = (StatePreview){0};
+	}
+	StateBuffer_free(&state_writer.packed);
+}
+static void State_freeBuffers(void) {
+	StateBuffer_free(&state_buffers.read);
+	StateBuffer_free(&state_buffers.packed);
+	Zstd_unload();
+	if (state_buffers.peak) LOG_info("State buffers: %uKB peak\n", (unsigned)(state_buffers.peak / 1024));
+	state_buffers.peak = 0;
+	State_invalidateSize();
+}
+static int State_writerBusy(void) {
+	pthread_mutex_lock(&state_writer.mutex);
+	int busy = state_writer.pending || state_writer.writing!=-1;
+	pthread_mutex_unlock(&state_writer.mutex);
+	return busy;
+}
+static char* State_writerStatus(const char* filename) { // for the most recent save only
+	pthread_mutex_lock(&state_writer.mutex);
+	int status = STATE_WRITER_IDLE;
+	if (exactMatch(state_writer.path, (char*)filename)) {
+		status = state_writer.pending || state_writer.writing!=-1 ? STATE_WRITER_BUSY : state_writer.status;
+	}
+	pthread_mutex_unlock(&state_writer.mutex);
+	switch (status) {
+		case STATE_WRITER_BUSY: return "Saving...";
+		case STATE_WRITER_FAILED: return "Save Failed";
+		default: return NULL;
+	}
+}
+
+static void State_queue(int slot, SDL_Surface* thumbnail) { // from picoarch, slot is for the slot index (-1 for none) and thumbnail its RGBA8888 preview
+	size_t state_size = State_getSize();
+	if (!state_size) return;
+	
+	int was_ff = fast_forward;
+	fast_forward = 0;
+	
+	State_writerInit();
+	
+	// wait for the worker to pick up any previous job so one buffer is free
+	pthread_mutex_lock(&state_writer.mutex);
+	while (state_writer.pending) {
+		pthread_cond_wait(&state_writer.cond, &state_writer.mutex);
+	}
+	int buffer = state_writer.writing==0 ? 1 : 0;
+	pthread_mutex_unlock(&state_writer.mutex);
+	
+	void* state = StateBuffer_reserve(&state_writer.buffers[buffer], state_size);
+	if (!state) goto error;
+	memset(state, 0, state_size);
 
-	sync();
+	if (!core.serialize(state, state_size)) {
+		LOG_error("Error serializing save state\n");
+		State_invalidateSize(); // maybe it changed under us
+		goto error;
+	}
+	
+	char filename[MAX_PATH];
+	State_getPath(filename);
+	
+	int level;
+	int codec = State_getCodec(&level);
+	
+	// the worker only reads the preview of the buffer it owns
+	StatePreview* preview = &state_writer.previews[buffer];
+	preview->w = preview->h = 0;
+	if (thumbnail && thumbnail->format->BytesPerPixel==4) {
+		uint32_t* pixels = realloc(preview->pixels, thumbnail->w * thumbnail->h * 4);
+		if (pixels) {
+			for (int y=0; y<thumbnail->h; y++) {
+				memcpy(pixels + y * thumbnail->w, (uint8_t*)thumbnail->pixels + y * thumbnail->pitch, thumbnail->w * 4);
+			}
+			preview->pixels = pixels;
+			preview->w = thumbnail->w;
+			preview->h = thumbnail->h;
+		}
+	}
+	
+	if (!state_writer.running) {
+		if (State_writeFile(filename, state, state_size, CFG_getStateFormat(), codec, level)) SlotIndex_commit(slot, state_size, codec, preview);
+		goto error;
+	}
+	
+	pthread_mutex_lock(&state_writer.mutex);
+	state_writer.buffer = buffer;
+	state_writer.size = state_size;
+	state_writer.format = CFG_getStateFormat();
+	state_writer.codec = codec;
+	state_writer.level = level;
+	state_writer.slot = slot;
+	strcpy(state_writer.path, filename);
+	state_writer.pending = 1;
+	state_writer.status = STATE_WRITER_BUSY;
+	pthread_cond_broadcast(&state_writer.cond);
+	pthread_mutex_unlock(&state_writer.mutex);
+
+error:
 	fast_forward = was_ff;
 }
+static void State_write(void) {
+	State_queue(-1, NULL);
+}
 
 static void State_autosave(void) {
 	int last_state_slot = state_slot;
@@ -1143,6 +2253,12 @@ typedef struct OptionList {
 
 	OptionCategory *categories;
 	// OptionList_callback_t on_set;
+	
+	// key lookup, rebuilt whenever options or count change under it
+	int* index; // open addressed, holds option index + 1
+	int index_size; // power of two
+	Option* indexed_options;
+	int indexed_count;
 } OptionList;
 
 static char* onoff_labels[] = {
@@ -1179,6 +2295,7 @@ static char* effect_labels[] = {
 	"None",
 	"Line",
 	"Grid",
+	"LCD",
 	NULL
 };
 static char* overlay_labels[] = {
@@ -1214,6 +2331,47 @@ static char* max_ff_labels[] = {
 	"8x",
 	NULL,
 };
+static char* rewind_buffer_labels[] = {
+	"16MB",
+	"32MB",
+	"64MB",
+	"128MB",
+	NULL,
+};
+static char* rewind_buffer_values[] = {
+	"16",
+	"32",
+	"64",
+	"128",
+	NULL,
+};
+static char* rewind_granularity_labels[] = {
+	"1",
+	"2",
+	"3",
+	"4",
+	"6",
+	"8",
+	NULL,
+};
+static char* state_codec_labels[] = {
+	"Default",
+	"None",
+	"LZ4",
+	"Zstd 1",
+	"Zstd 3",
+	"Zstd 9",
+	NULL,
+};
+static char* state_codec_values[] = {
+	"default",
+	"none",
+	"lz4",
+	"zstd1",
+	"zstd3",
+	"zstd9",
+	NULL,
+};
 static char* offset_labels[] = {
 	"-64",
 	"-63",
@@ -1393,6 +2551,10 @@ enum {
 	FE_OPT_DEBUG,
 	FE_OPT_MAXFF,
 	FE_OPT_FF_AUDIO,
+	FE_OPT_REWIND,
+	FE_OPT_REWIND_BUFFER,
+	FE_OPT_REWIND_GRANULARITY,
+	FE_OPT_STATE_CODEC,
 	FE_OPT_COUNT,
 };
 
@@ -1407,6 +2569,7 @@ enum {
 	SHORTCUT_HOLD_FF,
 	SHORTCUT_GAMESWITCHER,
 	SHORTCUT_SCREENSHOT,
+	SHORTCUT_HOLD_REWIND,
 	// Trimui only
 	SHORTCUT_TOGGLE_TURBO_A,
 	SHORTCUT_TOGGLE_TURBO_B,
@@ -1647,10 +2810,10 @@ static struct Config {
 			[FE_OPT_EFFECT] = {
 				.key	= "minarch_screen_effect",
 				.name	= "Screen Effect",
-				.desc	= "Grid simulates an LCD grid.\nLine simulates CRT scanlines.\nEffects usually look best at native scaling.",
+				.desc	= "Grid simulates an LCD grid.\nLine simulates CRT scanlines.\nLCD simulates LCD subpixels.\nEffects usually look best at native scaling.",
 				.default_value = 0,
 				.value = 0,
-				.count = 3,
+				.count = 4,
 				.values = effect_labels,
 				.labels = effect_labels,
 			},
@@ -1755,6 +2918,46 @@ static struct Config {
 				.values = onoff_labels,
 				.labels = onoff_labels,
 			},
+			[FE_OPT_REWIND] = {
+				.key	= "minarch_rewind",
+				.name	= "Rewind",
+				.desc	= "Keep a history of recent frames\nthat can be played back with\nthe Hold Rewind shortcut.",
+				.default_value = 0,
+				.value = 0,
+				.count = 2,
+				.values = onoff_labels,
+				.labels = onoff_labels,
+			},
+			[FE_OPT_REWIND_BUFFER] = {
+				.key	= "minarch_rewind_buffer",
+				.name	= "Rewind Buffer",
+				.desc	= "Memory reserved for rewind history.\nLarger buffers rewind further back.",
+				.default_value = 1,
+				.value = 1,
+				.count = 4,
+				.values = rewind_buffer_values,
+				.labels = rewind_buffer_labels,
+			},
+			[FE_OPT_REWIND_GRANULARITY] = {
+				.key	= "minarch_rewind_granularity",
+				.name	= "Rewind Granularity",
+				.desc	= "Capture a snapshot every n frames.\nHigher values rewind further and\ncost less but play back choppier.",
+				.default_value = 1,
+				.value = 1,
+				.count = 6,
+				.values = rewind_granularity_labels,
+				.labels = rewind_granularity_labels,
+			},
+			[FE_OPT_STATE_CODEC] = {
+				.key	= "minarch_state_codec",
+				.name	= "State Compression",
+				.desc	= "Compression for new save states.\nDefault follows the system setting.\nLZ4 is fastest, Zstd is smaller,\nhigher levels are smaller but slower.",
+				.default_value = 0,
+				.value = 0,
+				.count = 6,
+				.values = state_codec_values,
+				.labels = state_codec_labels,
+			},
 			[FE_OPT_COUNT] = {NULL}
 		}
 	},
@@ -1969,6 +3172,7 @@ static struct Config {
 		[SHORTCUT_HOLD_FF]				= {"Hold FF",			-1, BTN_ID_NONE, 0},
 		[SHORTCUT_GAMESWITCHER]			= {"Game Switcher",		-1, BTN_ID_NONE, 0},
 		[SHORTCUT_SCREENSHOT]           = {"Screenshot",        -1, BTN_ID_NONE, 0},
+		[SHORTCUT_HOLD_REWIND]			= {"Hold Rewind",		-1, BTN_ID_NONE, 0},
 		// Trimui only
 		[SHORTCUT_TOGGLE_TURBO_A]		= {"Toggle Turbo A",	-1, BTN_ID_NONE, 0},
 		[SHORTCUT_TOGGLE_TURBO_B]		= {"Toggle Turbo B",	-1, BTN_ID_NONE, 0},
@@ -2033,6 +3237,7 @@ static void setOverclock(int i) {
 }
 static int toggle_thread = 0;
 static int shadersreload = 0;
+static int shaders_preset_chosen = 0; // picked in the menu or saved, not just the default
 static void Config_syncFrontend(char* key, int value) {
 	int i = -1;
 	if (exactMatch(key,config.frontend.options[FE_OPT_SCALING].key)) {
@@ -2103,6 +3308,7 @@ static void Config_syncFrontend(char* key, int value) {
 	}
 	else if (exactMatch(key,config.frontend.options[FE_OPT_DEBUG].key)) {
 		show_debug = value;
+		GFX_setFrameTimings(value);
 		i = FE_OPT_DEBUG;
 	}
 	else if (exactMatch(key,config.frontend.options[FE_OPT_MAXFF].key)) {
@@ -2113,6 +3319,22 @@ static void Config_syncFrontend(char* key, int value) {
 		ff_audio = value;
 		i = FE_OPT_FF_AUDIO;
 	}
+	else if (exactMatch(key,config.frontend.options[FE_OPT_REWIND].key)) {
+		rewind_enable = value;
+		i = FE_OPT_REWIND;
+	}
+	else if (exactMatch(key,config.frontend.options[FE_OPT_REWIND_BUFFER].key)) {
+		rewind_buffer = value;
+		i = FE_OPT_REWIND_BUFFER;
+	}
+	else if (exactMatch(key,config.frontend.options[FE_OPT_REWIND_GRANULARITY].key)) {
+		rewind_granularity = value;
+		i = FE_OPT_REWIND_GRANULARITY;
+	}
+	else if (exactMatch(key,config.frontend.options[FE_OPT_STATE_CODEC].key)) {
+		state_codec = value;
+		i = FE_OPT_STATE_CODEC;
+	}
 	if (i==-1) return;
 	Option* option = &config.frontend.options[i];
 	option->value = value;
@@ -2136,8 +3358,16 @@ char** list_files_in_folder(const char* folderPath, int* fileCount, const char*
 
         if (stat(fullPath, &fileStat) == 0 && S_ISREG(fileStat.st_mode)) {
             if (extensionFilter) {
+                // space separated, eg. ".cfg .glslp"
                 const char* ext = strrchr(entry->d_name, '.');
-                if (!ext || strcmp(ext, extensionFilter) != 0) {
+                int matched = 0;
+                for (const char* filter = extensionFilter; ext && *filter && !matched; ) {
+                    int len = strcspn(filter, " ");
+                    matched = len == strlen(ext) && strncmp(filter, ext, len) == 0;
+                    filter += len;
+                    while (*filter == ' ') filter++;
+                }
+                if (!matched) {
                     continue;
                 }
             }
@@ -2262,7 +3492,7 @@ static void Config_init(void) {
 	int filecount;
 	char** filelist = list_files_in_folder(SHADERS_FOLDER "/glsl", &filecount,NULL);
 	int preset_filecount;
-	char** preset_filelist = list_files_in_folder(SHADERS_FOLDER, &preset_filecount,".cfg");
+	char** preset_filelist = list_files_in_folder(SHADERS_FOLDER, &preset_filecount,".cfg .glslp");
 	
 	config.shaders.options[SH_SHADER1].values = filelist;
 	config.shaders.options[SH_SHADER2].values = filelist;
@@ -2347,6 +3577,7 @@ static void Config_readOptionsString(char* cfg) {
 		Option* option = &config.shaders.options[i];
 		if (!Config_getValue(cfg, option->key, value, &option->lock)) continue;
 		OptionList_setOptionValue(&config.shaders, option->key, value);
+		if (i==SH_SHADERS_PRESET) shaders_preset_chosen = 1;
 	}
 	for (int y=0; y < config.shaders.options[SH_NROFSHADERS].value; y++) {
 		if(config.shaderpragmas[y].count > 0) {
@@ -2628,7 +3859,12 @@ void readShadersPreset(int i) {
 		char shaderspath[MAX_PATH] = {0};
 		snprintf(shaderspath, MAX_PATH, SHADERS_FOLDER "/%s", config.shaders.options[SH_SHADERS_PRESET].values[i]);
 		LOG_info("read shaders preset %s\n",shaderspath);
-		if (exists(shaderspath)) {
+		shaders_preset_chosen = 1;
+		if (suffixMatch(".glslp", shaderspath)) {
+			// not settings, initShaders hands it to the platform as is
+			config.shaders_preset = NULL;
+		}
+		else if (exists(shaderspath)) {
 			config.shaders_preset = allocFile(shaderspath);
 			Config_readOptionsString(config.shaders_preset);
 		}
@@ -2829,6 +4065,58 @@ void applyShaderSettings() {
 		}
 	}
 }
+// queue every shader the presets and this core's saved configs use, so
+// switching to one later only has to load its cached binary
+#define WARM_SHADERS_MAX 32
+static void warmShadersIn(const char* path, char** warmed, int* count) {
+	char* cfg = allocFile(path);
+	if (!cfg) return;
+	
+	int passes[] = {SH_SHADER1, SH_SHADER2, SH_SHADER3};
+	for (int i=0; i<3 && *count<WARM_SHADERS_MAX; i++) {
+		char value[256];
+		if (!Config_getValue(cfg, config.shaders.options[passes[i]].key, value, NULL)) continue;
+		
+		int seen = 0;
+		for (int j=0; j<*count && !seen; j++) seen = exactMatch(warmed[j], value);
+		if (seen) continue;
+		
+		warmed[(*count)++] = strdup(value);
+		GFX_warmShader(value);
+	}
+	free(cfg);
+}
+static void warmShaders(void) {
+	char* warmed[WARM_SHADERS_MAX];
+	int count = 0;
+	char path[MAX_PATH];
+	
+	int glslp_count = 0;
+	char** presets = config.shaders.options[SH_SHADERS_PRESET].values;
+	for (int i=0; presets && presets[i]; i++) {
+		snprintf(path, sizeof(path), SHADERS_FOLDER "/%s", presets[i]);
+		if (suffixMatch(".glslp", path)) {
+			GFX_warmShader(path); // queues each of its passes, from its own folder
+			glslp_count += 1;
+		}
+		else warmShadersIn(path, warmed, &count);
+	}
+	
+	DIR* dir = opendir(core.config_dir);
+	if (dir) {
+		struct dirent* entry;
+		while ((entry = readdir(dir))) {
+			if (!suffixMatch(".cfg", entry->d_name)) continue;
+			snprintf(path, sizeof(path), "%s/%s", core.config_dir, entry->d_name);
+			warmShadersIn(path, warmed, &count);
+		}
+		closedir(dir);
+	}
+	
+	LOG_info("warmShaders: queued %i and %i .glslp presets\n", count, glslp_count);
+	for (int i=0; i<count; i++) free(warmed[i]);
+}
+
 void initShaders() {
 	for (int i=0; config.shaders.options[i].key; i++) {
 		if(i!=SH_SHADERS_PRESET) {
@@ -2836,6 +4124,16 @@ void initShaders() {
 			Config_syncShaders(option->key, option->value);
 		}
 	}
+	
+	// a .glslp preset runs instead of the passes above until a .cfg one is picked
+	Option* option = &config.shaders.options[SH_SHADERS_PRESET];
+	char path[MAX_PATH] = {0};
+	if (shaders_preset_chosen && option->values && option->value < option->count && suffixMatch(".glslp", option->values[option->value])) {
+		snprintf(path, sizeof(path), SHADERS_FOLDER "/%s", option->values[option->value]);
+	}
+	if (GFX_setShaderPreset(path[0] ? path : NULL) < 0) {
+		LOG_error("initShaders: can't run preset %s\n", path);
+	}
 	shadersreload = 0;
 }
 
@@ -3145,31 +4443,117 @@ static void OptionList_reset(void) {
 	if (config.core.enabled_options) free(config.core.enabled_options);
 	config.core.enabled_count = 0;
 	free(config.core.options);
+	
+	free(config.core.index);
+	config.core.index = NULL;
+	config.core.index_size = 0;
+	config.core.indexed_options = NULL;
+	config.core.indexed_count = 0;
 }
 
-static Option* OptionList_getOption(OptionList* list, const char* key) {
+static uint32_t OptionList_hash(const char* key) { // fnv-1a
+	uint32_t hash = 2166136261u;
+	while (*key) {
+		hash ^= (uint8_t)*key++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+static void OptionList_index(OptionList* list) {
+	int size = 16;
+	while (size < list->count * 2) size <<= 1; // keep it at most half full
+	
+	if (size!=list->index_size) {
+		free(list->index);
+		list->index = malloc(size * sizeof(int));
+		list->index_size = list->index ? size : 0;
+	}
+	list->indexed_options = list->options;
+	list->indexed_count = list->count;
+	if (!list->index) return;
+	
+	memset(list->index, 0, size * sizeof(int));
+	int mask = size - 1;
 	for (int i=0; i<list->count; i++) {
-		Option* item = &list->options[i];
+		const char* key = list->options[i].key;
+		if (!key) continue;
+		int slot = OptionList_hash(key) & mask;
+		while (list->index[slot]) {
+			if (!strcmp(list->options[list->index[slot]-1].key, key)) break; // first one wins, like the old scan
+			slot = (slot + 1) & mask;
+		}
+		if (!list->index[slot]) list->index[slot] = i + 1;
+	}
+}
+static Option* OptionList_getOption(OptionList* list, const char* key) {
+	if (!key || !list->count) return NULL;
+	if (list->indexed_options!=list->options || list->indexed_count!=list->count) OptionList_index(list);
+	
+	if (!list->index) { // couldn't allocate, scan instead
+		for (int i=0; i<list->count; i++) {
+			Option* item = &list->options[i];
+			if (!strcmp(item->key, key)) return item;
+		}
+		return NULL;
+	}
+	
+	int mask = list->index_size - 1;
+	int slot = OptionList_hash(key) & mask;
+	while (list->index[slot]) {
+		Option* item = &list->options[list->index[slot]-1];
 		if (!strcmp(item->key, key)) return item;
+		slot = (slot + 1) & mask;
 	}
 	return NULL;
 }
+
+// GET_VARIABLE traffic, some cores poll dozens of keys every frame.
+// only every OPTION_SAMPLE_RATE-th call is timed, the clock costs more than the lookup
+#define OPTION_SAMPLE_RATE 256
+
+static struct {
+	uint64_t calls;
+	uint64_t misses;
+	uint64_t samples;
+	uint64_t ns; // across samples
+} option_stats;
+
+static uint64_t OptionList_now(void) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+static void OptionList_logStats(void) {
+	if (!option_stats.calls) return;
+	LOG_info("GET_VARIABLE: %llu calls (%llu misses) avg %lluns (%llu sampled) across %i options\n",
+		(unsigned long long)option_stats.calls, (unsigned long long)option_stats.misses,
+		(unsigned long long)(option_stats.samples ? option_stats.ns / option_stats.samples : 0),
+		(unsigned long long)option_stats.samples, config.core.count
+	);
+}
 static char* OptionList_getOptionValue(OptionList* list, const char* key) {
+	int sampled = option_stats.calls % OPTION_SAMPLE_RATE==0;
+	uint64_t start = sampled ? OptionList_now() : 0;
+	
+	char* value = NULL;
 	Option* item = OptionList_getOption(list, key);
-	if (item) {
-		int count = 0;
-		while ( item->values && item->values[count]) count++;
-		if (item->value >= 0 && item->value < count) {
-			return item->values[item->value];
-		}
+	if (item && item->values && item->value >= 0 && item->value < item->count) {
+		value = item->values[item->value];
 	}
-	return NULL;
+	
+	option_stats.calls += 1;
+	if (!item) option_stats.misses += 1;
+	if (sampled) {
+		option_stats.samples += 1;
+		option_stats.ns += OptionList_now() - start;
+	}
+	return value;
 }
 static void OptionList_setOptionRawValue(OptionList* list, const char* key, int value) {
 	Option* item = OptionList_getOption(list, key);
 	if (item) {
+		if (item->value!=value) list->changed = 1; // only bother the core with real changes
 		item->value = value;
-		list->changed = 1;
 		// LOG_info("\tRAW SET %s (%s) TO %s (%s)\n", item->name, item->key, item->labels[item->value], item->values[item->value]);
 		// if (list->on_set) list->on_set(list, key);
 
@@ -3180,8 +4564,9 @@ static void OptionList_setOptionRawValue(OptionList* list, const char* key, int
 static void OptionList_setOptionValue(OptionList* list, const char* key, const char* value) {
 	Option* item = OptionList_getOption(list, key);
 	if (item) {
+		int previous = item->value;
 		Option_setValue(item, value);
-		list->changed = 1;
+		if (item->value!=previous) list->changed = 1;
 		// LOG_info("\tSET %s (%s) TO %s (%s)\n", item->name, item->key, item->labels[item->value], item->values[item->value]);
 		// if (list->on_set) list->on_set(list, key);
 		
@@ -3195,6 +4580,249 @@ static void OptionList_setOptionVisibility(OptionList* list, const char* key, in
 	else printf("unknown option %s \n", key); fflush(stdout);
 }
 
+///////////////////////////////
+// rewind
+
+// Snapshots are stored as the xor of each state against the one before it.
+// Consecutive states are mostly identical so the xor is mostly zero words,
+// which are run-length encoded as (zero words, literal words, literals...).
+// Restoring xors the newest delta back into the current state, walking the
+// history backwards one snapshot per frame.
+
+typedef struct RewindEntry {
+	uint32_t offset; // in words
+	uint32_t size; // in words
+} RewindEntry;
+
+static struct Rewind {
+	int initialized;
+	size_t state_size; // as reported by the core
+	size_t state_words; // state_size rounded up to whole words
+	uint32_t* current; // most recently captured (or restored) state
+	uint32_t* next; // scratch for the incoming state
+	uint32_t* delta; // scratch for the encoded delta
+	uint32_t* ring;
+	size_t ring_words;
+	size_t head; // next write offset, in words
+	RewindEntry* entries;
+	int entry_capacity;
+	int entry_first; // oldest entry
+	int entry_count;
+	int has_current;
+	int frame;
+	int buffer; // rewind_buffer used for the current allocation
+
+	// stats
+	uint64_t captures;
+	uint64_t capture_bytes;
+	uint64_t capture_us;
+	uint64_t capture_max_us;
+	uint64_t restores;
+	uint64_t restore_us;
+	uint64_t restore_max_us;
+	uint64_t overflows; // deltas too big for the whole ring
+} rewind_state;
+
+static size_t Rewind_deltaBound(size_t words) {
+	// every run but the first and last covers at least 2 zero words and 1 literal
+	return words + 2 * (words / 3 + 2);
+}
+static size_t Rewind_encodeDelta(const uint32_t* prev, const uint32_t* next, size_t words, uint32_t* out) {
+	uint32_t* dst = out;
+	size_t i = 0;
+	while (i<words) {
+		size_t start = i;
+		while (i<words && prev[i]==next[i]) i++;
+		uint32_t zeros = i - start;
+		
+		start = i;
+		// a lone matching word is cheaper to store as a literal than to start a new run
+		while (i<words && (prev[i]!=next[i] || (i+1<words && prev[i+1]!=next[i+1]))) i++;
+		uint32_t literals = i - start;
+		
+		*dst++ = zeros;
+		*dst++ = literals;
+		for (size_t j=start; j<i; j++) {
+			*dst++ = prev[j] ^ next[j];
+		}
+	}
+	return dst - out;
+}
+static void Rewind_applyDelta(uint32_t* state, const uint32_t* delta, size_t size) {
+	const uint32_t* end = delta + size;
+	while (delta<end) {
+		state += delta[0];
+		uint32_t literals = delta[1];
+		delta += 2;
+		for (uint32_t i=0; i<literals; i++) {
+			state[i] ^= delta[i];
+		}
+		state += literals;
+		delta += literals;
+	}
+}
+
+static void Rewind_logStats(void) {
+	if (!rewind_state.captures) return;
+	LOG_info("rewind stats (%s): %llu snapshots, %llu bytes/snapshot (state %u bytes), capture avg %lluus max %lluus, restore avg %lluus max %lluus, %llu overflows\n",
+		core.name,
+		(unsigned long long)rewind_state.captures,
+		(unsigned long long)(rewind_state.capture_bytes / rewind_state.captures),
+		(unsigned)rewind_state.state_size,
+		(unsigned long long)(rewind_state.capture_us / rewind_state.captures),
+		(unsigned long long)rewind_state.capture_max_us,
+		(unsigned long long)(rewind_state.restores ? rewind_state.restore_us / rewind_state.restores : 0),
+		(unsigned long long)rewind_state.restore_max_us,
+		(unsigned long long)rewind_state.overflows
+	);
+}
+static void Rewind_free(void) {
+	if (!rewind_state.initialized) return;
+	Rewind_logStats();
+	if (rewind_state.current) free(rewind_state.current);
+	if (rewind_state.next) free(rewind_state.next);
+	if (rewind_state.delta) free(rewind_state.delta);
+	if (rewind_state.ring) free(rewind_state.ring);
+	if (rewind_state.entries) free(rewind_state.entries);
+	memset(&rewind_state, 0, sizeof(rewind_state));
+}
+static int Rewind_init(size_t state_size) {
+	Rewind_free();
+	if (!state_size) return 0;
+	
+	size_t buffer_size = (size_t)strtol(rewind_buffer_values[rewind_buffer], NULL, 10) * 1024 * 1024;
+	
+	rewind_state.buffer = rewind_buffer;
+	rewind_state.state_size = state_size;
+	rewind_state.state_words = (state_size + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+	rewind_state.ring_words = buffer_size / sizeof(uint32_t);
+	rewind_state.entry_capacity = buffer_size / 1024;
+	
+	// padding words past state_size stay zero in both buffers
+	rewind_state.current = calloc(rewind_state.state_words, sizeof(uint32_t));
+	rewind_state.next = calloc(rewind_state.state_words, sizeof(uint32_t));
+	rewind_state.delta = malloc(Rewind_deltaBound(rewind_state.state_words) * sizeof(uint32_t));
+	rewind_state.ring = malloc(rewind_state.ring_words * sizeof(uint32_t));
+	rewind_state.entries = malloc(rewind_state.entry_capacity * sizeof(RewindEntry));
+	rewind_state.initialized = 1;
+	
+	if (!rewind_state.current || !rewind_state.next || !rewind_state.delta || !rewind_state.ring || !rewind_state.entries) {
+		LOG_error("Couldn't allocate memory for rewind buffer\n");
+		Rewind_free();
+		return 0;
+	}
+	
+	LOG_info("Rewind_init: %uMB buffer, %u byte state\n", (unsigned)(buffer_size / 1024 / 1024), (unsigned)state_size);
+	return 1;
+}
+static void Rewind_quit(void) {
+	Rewind_free();
+	rewinding = 0;
+}
+
+static void Rewind_dropOldest(void) {
+	rewind_state.entry_first = (rewind_state.entry_first + 1) % rewind_state.entry_capacity;
+	rewind_state.entry_count -= 1;
+}
+static void Rewind_store(const uint32_t* delta, size_t size) {
+	if (size>rewind_state.ring_words) {
+		// never going to fit, the chain can't skip a step so start over from the current state
+		if (!rewind_state.overflows++) LOG_info("Rewind_store: %u byte delta doesn't fit the %uMB buffer, dropping history\n", (unsigned)(size * sizeof(uint32_t)), (unsigned)(rewind_state.ring_words * sizeof(uint32_t) / 1024 / 1024));
+		rewind_state.entry_count = 0;
+		rewind_state.head = 0;
+		return;
+	}
+	
+	if (rewind_state.entry_count==rewind_state.entry_capacity) Rewind_dropOldest();
+	
+	size_t offset = rewind_state.head;
+	if (offset+size>rewind_state.ring_words) {
+		// wrap, anything between head and the end of the ring is older than everything before head
+		while (rewind_state.entry_count && rewind_state.entries[rewind_state.entry_first].offset>=offset) Rewind_dropOldest();
+		offset = 0;
+	}
+	// the oldest entry is always the next one in the way
+	while (rewind_state.entry_count) {
+		RewindEntry* oldest = &rewind_state.entries[rewind_state.entry_first];
+		if (oldest->offset<offset || oldest->offset>=offset+size) break;
+		Rewind_dropOldest();
+	}
+	
+	memcpy(rewind_state.ring + offset, delta, size * sizeof(uint32_t));
+	
+	int i = (rewind_state.entry_first + rewind_state.entry_count) % rewind_state.entry_capacity;
+	rewind_state.entries[i].offset = offset;
+	rewind_state.entries[i].size = size;
+	rewind_state.entry_count += 1;
+	rewind_state.head = offset + size;
+}
+
+static void Rewind_push(void) {
+	if (!rewind_enable) {
+		if (rewind_state.initialized) Rewind_free();
+		return;
+	}
+	
+	int granularity = strtol(rewind_granularity_labels[rewind_granularity], NULL, 10);
+	if (++rewind_state.frame<granularity) return;
+	rewind_state.frame = 0;
+	
+	uint64_t start = getMicroseconds();
+	
+	size_t state_size = State_getSize();
+	if (!rewind_state.initialized || rewind_state.state_size!=state_size || rewind_state.buffer!=rewind_buffer) {
+		if (!Rewind_init(state_size)) {
+			rewind_enable = 0; // don't retry every frame
+			return;
+		}
+	}
+	
+	if (!core.serialize(rewind_state.next, state_size)) {
+		State_invalidateSize();
+		return;
+	}
+	
+	if (rewind_state.has_current) {
+		size_t size = Rewind_encodeDelta(rewind_state.current, rewind_state.next, rewind_state.state_words, rewind_state.delta);
+		Rewind_store(rewind_state.delta, size);
+		rewind_state.capture_bytes += size * sizeof(uint32_t);
+	}
+	
+	uint32_t* tmp = rewind_state.current;
+	rewind_state.current = rewind_state.next;
+	rewind_state.next = tmp;
+	rewind_state.has_current = 1;
+	
+	uint64_t elapsed = getMicroseconds() - start;
+	rewind_state.captures += 1;
+	rewind_state.capture_us += elapsed;
+	if (elapsed>rewind_state.capture_max_us) rewind_state.capture_max_us = elapsed;
+}
+static int Rewind_step(void) {
+	if (!rewind_state.initialized || !rewind_state.has_current) return 0;
+	
+	uint64_t start = getMicroseconds();
+	
+	// once history runs out hold on the oldest state
+	if (rewind_state.entry_count) {
+		int i = (rewind_state.entry_first + rewind_state.entry_count - 1) % rewind_state.entry_capacity;
+		RewindEntry* entry = &rewind_state.entries[i];
+		Rewind_applyDelta(rewind_state.current, rewind_state.ring + entry->offset, entry->size);
+		rewind_state.entry_count -= 1;
+		rewind_state.head = entry->offset;
+	}
+	
+	int restored = core.unserialize(rewind_state.current, rewind_state.state_size);
+	rewind_state.frame = 0;
+	
+	uint64_t elapsed = getMicroseconds() - start;
+	rewind_state.restores += 1;
+	rewind_state.restore_us += elapsed;
+	if (elapsed>rewind_state.restore_max_us) rewind_state.restore_max_us = elapsed;
+	
+	return restored;
+}
+
 ///////////////////////////////
 
 static void Menu_beforeSleep();
@@ -3267,6 +4895,12 @@ static void input_poll_callback(void) {
 					if (mapping->mod) ignore_menu = 1; // very unlikely but just in case
 				}
 			}
+			else if (i==SHORTCUT_HOLD_REWIND) {
+				if (PAD_justPressed(btn) || PAD_justReleased(btn)) {
+					rewinding = rewind_enable && PAD_isPressed(btn);
+					if (mapping->mod) ignore_menu = 1;
+				}
+			}
 			// Trimui only
 			else if (PLAT_canTurbo() && i>=SHORTCUT_TOGGLE_TURBO_A && i<=SHORTCUT_TOGGLE_TURBO_R2) {
 				if (PAD_justPressed(btn)) {
@@ -3408,37 +5042,461 @@ static void Input_init(const struct retro_input_descriptor *vars) {
 		}
 	}
 	
-	puts("---------------------------------");
-
-	for (int i=0;default_button_mapping[i].name; i++) {
-		ButtonMapping* mapping = &default_button_mapping[i];
-		//LOG_info("DEFAULT %s (%s): <%s>\n", core_button_names[mapping->retro], mapping->name, (mapping->platform_button_id==BTN_ID_NONE ? "NONE" : device_button_names[mapping->platform_button_id]));
-		if (core_button_names[mapping->retro]) mapping->name = (char*)core_button_names[mapping->retro];
-	}
+	puts("---------------------------------");
+
+	for (int i=0;default_button_mapping[i].name; i++) {
+		ButtonMapping* mapping = &default_button_mapping[i];
+		//LOG_info("DEFAULT %s (%s): <%s>\n", core_button_names[mapping->retro], mapping->name, (mapping->platform_button_id==BTN_ID_NONE ? "NONE" : device_button_names[mapping->platform_button_id]));
+		if (core_button_names[mapping->retro]) mapping->name = (char*)core_button_names[mapping->retro];
+	}
+	
+	puts("---------------------------------");
+
+	for (int i=0; config.controls[i].name; i++) {
+		ButtonMapping* mapping = &config.controls[i];
+		mapping->default_ = mapping->platform_button_id;
+
+		// ignore mappings that aren't available in this core
+		if (core_mapped && !present[mapping->retro]) {
+			mapping->ignore = 1;
+			continue;
+		}
+		//LOG_info("%s: <%s> (%i:%i)\n", mapping->name, (mapping->platform_button_id==BTN_ID_NONE ? "NONE" : device_button_names[mapping->platform_button_id]), mapping->platform_button_id, mapping->retro);
+	}
+	
+	puts("---------------------------------");
+	input_initialized = 1;
+}
+
+static bool set_rumble_state(unsigned port, enum retro_rumble_effect effect, uint16_t strength) {
+	// TODO: handle other args? not sure I can
+	VIB_setStrength(strength);
+	return 1;
+}
+
+///////////////////////////////
+// vfs
+
+#define VFS_BUFFER_SIZE (128 * 1024) // one read-ahead window
+#define VFS_BUFFER_ALIGN 4096
+
+struct retro_vfs_file_handle {
+	int fd;
+	char path[MAX_PATH];
+	unsigned mode;
+	
+	uint8_t* buffer;
+	int64_t buffer_offset; // file offset of buffer[0]
+	int64_t buffer_len;
+	int64_t pos;
+	int64_t size; // cached for read-only handles, -1 otherwise
+	
+	// "archive.zip#member" paths are read-only and decompressed sequentially
+	struct zip* za;
+	struct zip_file* zf;
+	zip_uint64_t zip_index;
+	int64_t zip_pos; // decompressed offset zf is sitting at
+	
+	uint32_t reads;
+	uint32_t syscalls;
+	uint32_t seeks;
+	uint64_t bytes_read;
+	uint64_t bytes_written;
+	uint64_t start;
+};
+
+struct retro_vfs_dir_handle {
+	DIR* dir;
+	struct dirent* entry;
+	char path[MAX_PATH];
+	bool include_hidden;
+};
+
+static int VFS_splitZipPath(const char* path, char* zip_path, char* member) {
+	const char* hash = strstr(path, ".zip#");
+	if (!hash) return 0;
+	
+	int len = hash - path + 4;
+	if (len>=MAX_PATH || strlen(hash+5)>=MAX_PATH) return 0;
+	memcpy(zip_path, path, len);
+	zip_path[len] = '\0';
+	strcpy(member, hash+5);
+	return 1;
+}
+static int VFS_openZip(struct retro_vfs_file_handle* stream, const char* path) {
+	char zip_path[MAX_PATH];
+	char member[MAX_PATH];
+	if (!VFS_splitZipPath(path, zip_path, member)) return 0;
+	
+	int err;
+	stream->za = zip_open(zip_path, ZIP_RDONLY, &err);
+	if (!stream->za) {
+		LOG_error("VFS_openZip: unable to open %s (%i)\n", zip_path, err);
+		return -1;
+	}
+	
+	struct zip_stat sb;
+	zip_int64_t index = zip_name_locate(stream->za, member, 0);
+	if (index<0 || zip_stat_index(stream->za, index, 0, &sb)!=0) {
+		LOG_error("VFS_openZip: %s not found in %s\n", member, zip_path);
+		zip_close(stream->za);
+		stream->za = NULL;
+		return -1;
+	}
+	
+	stream->zip_index = index;
+	stream->size = sb.size;
+	stream->zf = zip_fopen_index(stream->za, index, 0);
+	if (!stream->zf) {
+		zip_close(stream->za);
+		stream->za = NULL;
+		return -1;
+	}
+	return 1;
+}
+static int VFS_seekZip(struct retro_vfs_file_handle* stream, int64_t offset) {
+	if (offset==stream->zip_pos) return 0;
+	
+	if (offset<stream->zip_pos) {
+		// stored entries can seek, deflated ones have to start over
+		if (zip_fseek(stream->zf, offset, SEEK_SET)==0) {
+			stream->zip_pos = offset;
+			return 0;
+		}
+		zip_fclose(stream->zf);
+		stream->zf = zip_fopen_index(stream->za, stream->zip_index, 0);
+		stream->zip_pos = 0;
+		if (!stream->zf) return -1;
+	}
+	
+	// skip forward by decompressing into the buffer
+	while (stream->zip_pos<offset) {
+		int64_t chunk = offset - stream->zip_pos;
+		if (chunk>VFS_BUFFER_SIZE) chunk = VFS_BUFFER_SIZE;
+		zip_int64_t count = zip_fread(stream->zf, stream->buffer, chunk);
+		if (count<=0) return -1;
+		stream->zip_pos += count;
+	}
+	stream->buffer_len = 0;
+	return 0;
+}
+static int64_t VFS_readAt(struct retro_vfs_file_handle* stream, void* dst, int64_t offset, int64_t len) {
+	stream->syscalls += 1;
+	if (stream->zf) {
+		if (VFS_seekZip(stream, offset)!=0) return -1;
+		zip_int64_t count = zip_fread(stream->zf, dst, len);
+		if (count>0) stream->zip_pos += count;
+		return count;
+	}
+	
+	int64_t total = 0;
+	while (total<len) {
+		ssize_t count = pread(stream->fd, (uint8_t*)dst + total, len - total, offset + total);
+		if (count<0) {
+			if (errno==EINTR) continue;
+			return total ? total : -1;
+		}
+		if (count==0) break;
+		total += count;
+	}
+	return total;
+}
+static int VFS_fillBuffer(struct retro_vfs_file_handle* stream, int64_t offset) {
+	// keep the window aligned so consecutive refills hit whole pages
+	int64_t aligned = stream->zf ? offset : offset & ~(int64_t)(VFS_BUFFER_ALIGN - 1);
+	int64_t count = VFS_readAt(stream, stream->buffer, aligned, VFS_BUFFER_SIZE);
+	if (count<0) {
+		stream->buffer_len = 0;
+		return -1;
+	}
+	stream->buffer_offset = aligned;
+	stream->buffer_len = count;
+	
+	// ask the kernel to start on the next window while the core chews on this one
+	if (stream->fd>=0 && count==VFS_BUFFER_SIZE) {
+		posix_fadvise(stream->fd, aligned + VFS_BUFFER_SIZE, VFS_BUFFER_SIZE, POSIX_FADV_WILLNEED);
+	}
+	return 0;
+}
+
+static const char* VFS_getPath(struct retro_vfs_file_handle* stream) {
+	return stream ? stream->path : NULL;
+}
+static struct retro_vfs_file_handle* VFS_open(const char* path, unsigned mode, unsigned hints) {
+	if (!path || !*path) return NULL;
+	
+	struct retro_vfs_file_handle* stream = calloc(1, sizeof(struct retro_vfs_file_handle));
+	if (!stream) return NULL;
+	
+	stream->fd = -1;
+	stream->size = -1;
+	stream->mode = mode;
+	stream->start = getMicroseconds();
+	strncpy(stream->path, path, MAX_PATH - 1);
+	
+	if (posix_memalign((void**)&stream->buffer, VFS_BUFFER_ALIGN, VFS_BUFFER_SIZE)!=0) {
+		free(stream);
+		return NULL;
+	}
+	
+	if ((mode & RETRO_VFS_FILE_ACCESS_READ_WRITE)==RETRO_VFS_FILE_ACCESS_READ) {
+		int zipped = VFS_openZip(stream, path);
+		if (zipped<0) goto fail;
+		if (zipped) return stream;
+	}
+	
+	int flags;
+	switch (mode & RETRO_VFS_FILE_ACCESS_READ_WRITE) {
+		case RETRO_VFS_FILE_ACCESS_READ:		flags = O_RDONLY; break;
+		case RETRO_VFS_FILE_ACCESS_WRITE:		flags = O_WRONLY | O_CREAT | O_TRUNC; break;
+		case RETRO_VFS_FILE_ACCESS_READ_WRITE:	flags = O_RDWR | O_CREAT | O_TRUNC; break; // "w+", like the reference vfs
+		default: goto fail;
+	}
+	if ((mode & RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING) && (mode & RETRO_VFS_FILE_ACCESS_WRITE)) {
+		flags = O_RDWR; // "r+", the file has to exist already
+	}
+	
+	stream->fd = open(path, flags | O_CLOEXEC, 0644);
+	if (stream->fd<0) goto fail;
+	
+	if (flags==O_RDONLY) {
+		struct stat st;
+		if (fstat(stream->fd, &st)==0) stream->size = st.st_size;
+		posix_fadvise(stream->fd, 0, 0, (hints & RETRO_VFS_FILE_ACCESS_HINT_FREQUENT_ACCESS) ? POSIX_FADV_RANDOM : POSIX_FADV_SEQUENTIAL);
+	}
+	return stream;
+	
+fail:
+	free(stream->buffer);
+	free(stream);
+	return NULL;
+}
+static int VFS_close(struct retro_vfs_file_handle* stream) {
+	if (!stream) return -1;
+	
+	if (stream->reads || stream->bytes_written) {
+		LOG_info("VFS_close: %s reads:%u syscalls:%u seeks:%u read:%lluKB written:%lluKB open:%ims\n",
+			basename(stream->path), stream->reads, stream->syscalls, stream->seeks,
+			(unsigned long long)stream->bytes_read / 1024, (unsigned long long)stream->bytes_written / 1024,
+			(int)((getMicroseconds() - stream->start) / 1000)
+		);
+	}
+	
+	int result = 0;
+	if (stream->zf) zip_fclose(stream->zf);
+	if (stream->za) zip_close(stream->za);
+	if (stream->fd>=0 && close(stream->fd)!=0) result = -1;
+	free(stream->buffer);
+	free(stream);
+	return result;
+}
+static int64_t VFS_size(struct retro_vfs_file_handle* stream) {
+	if (!stream) return -1;
+	if (stream->size>=0) return stream->size;
+	
+	struct stat st;
+	if (fstat(stream->fd, &st)!=0) return -1;
+	return st.st_size;
+}
+static int64_t VFS_truncate(struct retro_vfs_file_handle* stream, int64_t length) {
+	if (!stream || stream->fd<0 || stream->size>=0) return -1;
+	if (ftruncate(stream->fd, length)!=0) return -1;
+	stream->buffer_len = 0;
+	return 0;
+}
+static int64_t VFS_tell(struct retro_vfs_file_handle* stream) {
+	return stream ? stream->pos : -1;
+}
+static int64_t VFS_seek(struct retro_vfs_file_handle* stream, int64_t offset, int seek_position) {
+	if (!stream) return -1;
+	
+	int64_t pos;
+	switch (seek_position) {
+		case RETRO_VFS_SEEK_POSITION_START:		pos = offset; break;
+		case RETRO_VFS_SEEK_POSITION_CURRENT:	pos = stream->pos + offset; break;
+		case RETRO_VFS_SEEK_POSITION_END: {
+			int64_t size = VFS_size(stream);
+			if (size<0) return -1;
+			pos = size + offset;
+		} break;
+		default: return -1;
+	}
+	if (pos<0) return -1;
+	
+	if (pos!=stream->pos) stream->seeks += 1;
+	stream->pos = pos;
+	return pos;
+}
+static int64_t VFS_read(struct retro_vfs_file_handle* stream, void* s, uint64_t len) {
+	if (!stream || !s || !(stream->mode & RETRO_VFS_FILE_ACCESS_READ)) return -1;
+	stream->reads += 1;
+	
+	uint8_t* dst = s;
+	int64_t total = 0;
+	while (total<(int64_t)len) {
+		int64_t remaining = len - total;
+		int64_t offset = stream->pos - stream->buffer_offset;
+		
+		if (stream->buffer_len && offset>=0 && offset<stream->buffer_len) {
+			int64_t count = stream->buffer_len - offset;
+			if (count>remaining) count = remaining;
+			memcpy(dst + total, stream->buffer + offset, count);
+			stream->pos += count;
+			total += count;
+			continue;
+		}
+		
+		// big reads skip the buffer entirely
+		if (remaining>=VFS_BUFFER_SIZE) {
+			int64_t count = VFS_readAt(stream, dst + total, stream->pos, remaining);
+			if (count<0) return total ? total : -1;
+			stream->pos += count;
+			total += count;
+			break;
+		}
+		
+		if (VFS_fillBuffer(stream, stream->pos)!=0) return total ? total : -1;
+		if (stream->pos - stream->buffer_offset>=stream->buffer_len) break; // eof
+	}
+	
+	stream->bytes_read += total;
+	return total;
+}
+static int64_t VFS_write(struct retro_vfs_file_handle* stream, const void* s, uint64_t len) {
+	if (!stream || !s || stream->fd<0 || !(stream->mode & RETRO_VFS_FILE_ACCESS_WRITE)) return -1;
+	
+	const uint8_t* src = s;
+	int64_t total = 0;
+	while (total<(int64_t)len) {
+		ssize_t count = pwrite(stream->fd, src + total, len - total, stream->pos + total);
+		if (count<0) {
+			if (errno==EINTR) continue;
+			break;
+		}
+		total += count;
+	}
+	
+	// anything we buffered may be stale now
+	stream->buffer_len = 0;
+	stream->pos += total;
+	stream->bytes_written += total;
+	stream->syscalls += 1;
+	return total ? total : (len ? -1 : 0);
+}
+static int VFS_flush(struct retro_vfs_file_handle* stream) {
+	if (!stream) return -1;
+	return 0; // writes go straight to the fd
+}
+static int VFS_remove(const char* path) {
+	return (path && unlink(path)==0) ? 0 : -1;
+}
+static int VFS_rename(const char* old_path, const char* new_path) {
+	return (old_path && new_path && rename(old_path, new_path)==0) ? 0 : -1;
+}
+static int VFS_stat(const char* path, int32_t* size) {
+	if (!path || !*path) return 0;
+	
+	char zip_path[MAX_PATH];
+	char member[MAX_PATH];
+	if (VFS_splitZipPath(path, zip_path, member)) {
+		struct zip* za = zip_open(zip_path, ZIP_RDONLY, NULL);
+		if (!za) return 0;
+		
+		struct zip_stat sb;
+		int flags = 0;
+		if (zip_stat(za, member, 0, &sb)==0) {
+			if (size) *size = (int32_t)sb.size;
+			flags = RETRO_VFS_STAT_IS_VALID;
+		}
+		zip_close(za);
+		return flags;
+	}
+	
+	struct stat st;
+	if (stat(path, &st)!=0) return 0;
+	if (size) *size = (int32_t)st.st_size;
 	
-	puts("---------------------------------");
-
-	for (int i=0; config.controls[i].name; i++) {
-		ButtonMapping* mapping = &config.controls[i];
-		mapping->default_ = mapping->platform_button_id;
-
-		// ignore mappings that aren't available in this core
-		if (core_mapped && !present[mapping->retro]) {
-			mapping->ignore = 1;
-			continue;
-		}
-		//LOG_info("%s: <%s> (%i:%i)\n", mapping->name, (mapping->platform_button_id==BTN_ID_NONE ? "NONE" : device_button_names[mapping->platform_button_id]), mapping->platform_button_id, mapping->retro);
+	int flags = RETRO_VFS_STAT_IS_VALID;
+	if (S_ISDIR(st.st_mode)) flags |= RETRO_VFS_STAT_IS_DIRECTORY;
+	if (S_ISCHR(st.st_mode)) flags |= RETRO_VFS_STAT_IS_CHARACTER_SPECIAL;
+	return flags;
+}
+static int VFS_mkdir(const char* dir) {
+	if (!dir || !*dir) return -1;
+	if (mkdir(dir, 0755)==0) return 0;
+	return errno==EEXIST ? -2 : -1;
+}
+static struct retro_vfs_dir_handle* VFS_opendir(const char* dir, bool include_hidden) {
+	if (!dir || !*dir) return NULL;
+	
+	struct retro_vfs_dir_handle* dirstream = calloc(1, sizeof(struct retro_vfs_dir_handle));
+	if (!dirstream) return NULL;
+	
+	dirstream->dir = opendir(dir);
+	if (!dirstream->dir) {
+		free(dirstream);
+		return NULL;
 	}
+	strncpy(dirstream->path, dir, MAX_PATH - 1);
+	dirstream->include_hidden = include_hidden;
+	return dirstream;
+}
+static bool VFS_readdir(struct retro_vfs_dir_handle* dirstream) {
+	if (!dirstream) return false;
 	
-	puts("---------------------------------");
-	input_initialized = 1;
+	while ((dirstream->entry = readdir(dirstream->dir))) {
+		const char* name = dirstream->entry->d_name;
+		if (!strcmp(name, ".") || !strcmp(name, "..")) continue;
+		if (!dirstream->include_hidden && name[0]=='.') continue;
+		return true;
+	}
+	return false;
 }
-
-static bool set_rumble_state(unsigned port, enum retro_rumble_effect effect, uint16_t strength) {
-	// TODO: handle other args? not sure I can
-	VIB_setStrength(strength);
-	return 1;
+static const char* VFS_direntGetName(struct retro_vfs_dir_handle* dirstream) {
+	return (dirstream && dirstream->entry) ? dirstream->entry->d_name : NULL;
 }
+static bool VFS_direntIsDir(struct retro_vfs_dir_handle* dirstream) {
+	if (!dirstream || !dirstream->entry) return false;
+	if (dirstream->entry->d_type!=DT_UNKNOWN) return dirstream->entry->d_type==DT_DIR;
+	
+	// some filesystems (looking at you exfat) don't fill in d_type
+	char path[MAX_PATH];
+	struct stat st;
+	snprintf(path, MAX_PATH, "%s/%s", dirstream->path, dirstream->entry->d_name);
+	return stat(path, &st)==0 && S_ISDIR(st.st_mode);
+}
+static int VFS_closedir(struct retro_vfs_dir_handle* dirstream) {
+	if (!dirstream) return -1;
+	int result = closedir(dirstream->dir);
+	free(dirstream);
+	return result;
+}
+
+static struct retro_vfs_interface vfs_interface = {
+	// v1
+	.get_path			= VFS_getPath,
+	.open				= VFS_open,
+	.close				= VFS_close,
+	.size				= VFS_size,
+	.tell				= VFS_tell,
+	.seek				= VFS_seek,
+	.read				= VFS_read,
+	.write				= VFS_write,
+	.flush				= VFS_flush,
+	.remove				= VFS_remove,
+	.rename				= VFS_rename,
+	// v2
+	.truncate			= VFS_truncate,
+	// v3
+	.stat				= VFS_stat,
+	.mkdir				= VFS_mkdir,
+	.opendir			= VFS_opendir,
+	.readdir			= VFS_readdir,
+	.dirent_get_name	= VFS_direntGetName,
+	.dirent_is_dir		= VFS_direntIsDir,
+	.closedir			= VFS_closedir,
+};
+
 static bool environment_callback(unsigned cmd, void *data) { // copied from picoarch initially
 	// LOG_info("environment_callback: %i\n", cmd);
 	
@@ -3541,6 +5599,7 @@ static bool environment_callback(unsigned cmd, void *data) { // copied from pico
 		bool *out = (bool *)data;
 		if (out) {
 			*out = config.core.changed;
+			if (config.core.changed) State_invalidateSize(); // some options change the state layout
 			config.core.changed = 0;
 		}
 		break;
@@ -3622,7 +5681,22 @@ static bool environment_callback(unsigned cmd, void *data) { // copied from pico
 	}
 	
 	// RETRO_ENVIRONMENT_SET_SUPPORT_ACHIEVEMENTS (42 | RETRO_ENVIRONMENT_EXPERIMENTAL)
-	// RETRO_ENVIRONMENT_GET_VFS_INTERFACE (45 | RETRO_ENVIRONMENT_EXPERIMENTAL)
+	case RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS: { /* 44 */
+		uint64_t *quirks = (uint64_t *)data;
+		if (quirks) {
+			core.serialization_quirks = *quirks;
+			*quirks |= RETRO_SERIALIZATION_QUIRK_FRONT_VARIABLE_SIZE; // we tolerate size changes
+		}
+		break;
+	}
+	case RETRO_ENVIRONMENT_GET_VFS_INTERFACE: { /* 45 | RETRO_ENVIRONMENT_EXPERIMENTAL */
+		struct retro_vfs_interface_info *info = (struct retro_vfs_interface_info *)data;
+		if (!info || info->required_interface_version>3) return false;
+		info->required_interface_version = 3;
+		info->iface = &vfs_interface;
+		core.vfs = 1;
+		break;
+	}
 	// RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE (47 | RETRO_ENVIRONMENT_EXPERIMENTAL)
 	// RETRO_ENVIRONMENT_GET_INPUT_BITMASKS (51 | RETRO_ENVIRONMENT_EXPERIMENTAL)
 	case RETRO_ENVIRONMENT_GET_INPUT_BITMASKS: { /* 51 | RETRO_ENVIRONMENT_EXPERIMENTAL */
@@ -3815,7 +5889,7 @@ static void MSG_init(void) {
 	char* c;
 	int i = 0;
 	while ((c = chars[i])) {
-		digit = TTF_RenderUTF8_Blended(font.tiny, c, COLOR_WHITE);
+		digit = GFX_renderUTF8(font.tiny, c, COLOR_WHITE);
 		SDL_BlitSurface(digit, NULL, digits, &(SDL_Rect){ (i * SCALE1(DIGIT_WIDTH)) + (SCALE1(DIGIT_WIDTH) - digit->w)/2, (SCALE1(DIGIT_HEIGHT) - digit->h)/2});
 		SDL_FreeSurface(digit);
 		i += 1;
@@ -4107,6 +6181,86 @@ static const char* bitmap_font[] = {
         "1   1"
         "1   1"
         "1   1",
+	['u'] =
+		"     "
+		"     "
+		"1   1"
+		"1   1"
+		"1   1"
+		"1   1"
+		"1   1"
+		"1  11"
+		" 11 1",
+	['p'] =
+		"     "
+		"     "
+		"1111 "
+		"1   1"
+		"1   1"
+		"1   1"
+		"1111 "
+		"1    "
+		"1    ",
+	['s'] =
+		"     "
+		"     "
+		" 1111"
+		"1    "
+		"1    "
+		" 111 "
+		"    1"
+		"    1"
+		"1111 ",
+	['r'] =
+		"     "
+		"     "
+		"1 11 "
+		"11  1"
+		"1    "
+		"1    "
+		"1    "
+		"1    "
+		"1    ",
+	['f'] =
+		"     "
+		"  11 "
+		" 1  1"
+		" 1   "
+		"1111 "
+		" 1   "
+		" 1   "
+		" 1   "
+		" 1   ",
+	['o'] =
+		"     "
+		"     "
+		" 111 "
+		"1   1"
+		"1   1"
+		"1   1"
+		"1   1"
+		"1   1"
+		" 111 ",
+	['v'] =
+		"     "
+		"     "
+		"1   1"
+		"1   1"
+		"1   1"
+		"1   1"
+		" 1 1 "
+		" 1 1 "
+		"  1  ",
+	['w'] =
+		"     "
+		"     "
+		"1   1"
+		"1   1"
+		"1   1"
+		"1 1 1"
+		"1 1 1"
+		"1 1 1"
+		" 1 1 ",
 
 	};
 
@@ -4166,6 +6320,10 @@ static const char* bitmap_font[] = {
 			uint32_t* row = data + y * stride;
 			for (int i = 0; i < len; i++) {
 				const char* c = bitmap_font[(unsigned char)text[i]];
+				if (!c) { // no glyph, leave a gap
+					row += CHAR_WIDTH + LETTERSPACING;
+					continue;
+				}
 				for (int x = 0; x < CHAR_WIDTH; x++) {
 					if (c[y * CHAR_WIDTH + x] == '1') {
 						*row = 0xFFFFFFFF;  // white RGBA8888
@@ -4701,6 +6859,14 @@ static void video_refresh_callback_main(const void *data, unsigned width, unsign
 
 		snprintf(debug_text, sizeof(debug_text), "%i/%ix%i/%ix%i/%ix%i", currentshaderpass, currentshadersrcw,currentshadersrch,currentshadertexw,currentshadertexh,currentshaderdstw,currentshaderdsth);
 		blitBitmapText(debug_text,x,-y - 14,(uint32_t*)data,pitch / 4, width,height);
+
+		if (currentglcalls) {
+			snprintf(debug_text, sizeof(debug_text), "%i/%i/%i", currentgldraws, currentglcalls, currentgluniforms);
+			blitBitmapText(debug_text,x,-y - 28,(uint32_t*)data,pitch / 4, width,height);
+		}
+		if (currentframetimings[0]) {
+			blitBitmapText(currentframetimings,x,-y - 42,(uint32_t*)data,pitch / 4, width,height);
+		}
 	
 		double buffer_fill = (double) (currentbuffersize - currentbufferfree) / (double) currentbuffersize;
 		drawGauge(x, y + 30, buffer_fill, width / 2, 8, (uint32_t*)data, pitch / 4);
@@ -4805,6 +6971,7 @@ static void video_refresh_callback(const void* data, unsigned width, unsigned he
 ///////////////////////////////
 
 static void audio_sample_callback(int16_t left, int16_t right) {
+	if (rewinding) return;
 	if (!fast_forward || ff_audio) {
 		if (use_core_fps || fast_forward) {
 			SND_batchSamples_fixed_rate(&(const SND_Frame){left,right}, 1);
@@ -4815,6 +6982,7 @@ static void audio_sample_callback(int16_t left, int16_t right) {
 	}
 }
 static size_t audio_sample_batch_callback(const int16_t *data, size_t frames) { 
+	if (rewinding) return frames;
 	if (!fast_forward || ff_audio) {
 		if (use_core_fps || fast_forward) {
 			return SND_batchSamples_fixed_rate((const SND_Frame*)data, frames);
@@ -4836,6 +7004,7 @@ void Core_getName(char* in_name, char* out_name) {
 }
 void Core_open(const char* core_path, const char* tag_name) {
 	LOG_info("Core_open\n");
+	core.serialization_quirks = 0; // only ever set by the core, through the environment
 	core.handle = dlopen(core_path, RTLD_LAZY);
 	
 	if (!core.handle) LOG_error("%s\n", dlerror());
@@ -4873,22 +7042,40 @@ void Core_open(const char* core_path, const char* tag_name) {
 	set_input_poll_callback = dlsym(core.handle, "retro_set_input_poll");
 	set_input_state_callback = dlsym(core.handle, "retro_set_input_state");
 	
-	struct retro_system_info info = {};
-	core.get_system_info(&info);
+	Core_getName((char*)core_path, (char*)core.name);
+	strncpy((char*)core.tag, tag_name, 7);
+	((char*)core.tag)[7] = '\0';
 	
+	// skip retro_get_system_info() when we've seen this exact .so before
+	CoreInfo info;
+	if (CoreInfo_get(core_path, &info)) {
+		LOG_info("Core_open: using cached core info\n");
+	}
+	else {
+		struct retro_system_info system_info = {};
+		core.get_system_info(&system_info);
+		
+		memset(&info, 0, sizeof(info));
+		strncpy(info.path, core_path, sizeof(info.path) - 1);
+		strncpy(info.tag, core.tag, sizeof(info.tag) - 1);
+		strncpy(info.name, core.name, sizeof(info.name) - 1);
+		snprintf(info.version, sizeof(info.version), "%s (%s)", system_info.library_name, system_info.library_version);
+		if (system_info.valid_extensions) strncpy(info.extensions, system_info.valid_extensions, sizeof(info.extensions) - 1);
+		info.need_fullpath = system_info.need_fullpath;
+		info.block_extract = system_info.block_extract;
+		if (!CoreInfo_put(&info)) LOG_error("Core_open: unable to cache core info\n");
+	}
 
 	LOG_info("Block Extract: %d\n", info.block_extract);
 
-	Core_getName((char*)core_path, (char*)core.name);
-	snprintf((char*)core.version, sizeof(core.version), "%s (%s)", info.library_name, info.library_version);
-	strncpy((char*)core.tag, tag_name, 7);
-	((char*)core.tag)[7] = '\0';
-	strncpy((char*)core.extensions, info.valid_extensions, 127);
+	strncpy((char*)core.version, info.version, sizeof(core.version) - 1);
+	((char*)core.version)[sizeof(core.version) - 1] = '\0';
+	strncpy((char*)core.extensions, info.extensions, 127);
 	((char*)core.extensions)[127] = '\0';
 	
 	core.need_fullpath = info.need_fullpath;
 	
-	LOG_info("core: %s version: %s tag: %s (valid_extensions: %s need_fullpath: %i)\n", core.name, core.version, core.tag, info.valid_extensions, info.need_fullpath);
+	LOG_info("core: %s version: %s tag: %s (valid_extensions: %s need_fullpath: %i)\n", core.name, core.version, core.tag, core.extensions, core.need_fullpath);
 	
 	snprintf((char*)core.config_dir, sizeof(core.config_dir), USERDATA_PATH "/%s-%s", core.tag, core.name);
 	snprintf((char*)core.states_dir, sizeof(core.states_dir), SHARED_USERDATA_PATH "/%s-%s", core.tag, core.name);
@@ -4956,6 +7143,7 @@ void Core_load(void) {
 	game_info.size = game.size;
 	LOG_info("game path: %s (%i)\n", game_info.path, game.size);
 	core.load_game(&game_info);
+	State_invalidateSize();
 
 	if (Cheats_load())
 		Core_applyCheats(&cheatcodes);
@@ -4968,6 +7156,7 @@ void Core_load(void) {
 }
 void Core_reset(void) {
 	core.reset();
+	State_invalidateSize();
 }
 void Core_unload(void) {
 	// Disabling this is a dumb hack for bluetooth, we should really be using 
@@ -4976,6 +7165,7 @@ void Core_unload(void) {
 	//SND_quit();
 }
 void Core_quit(void) {
+	OptionList_logStats();
 	if (core.initialized) {
 		SRAM_write();
 		Cheats_free();
@@ -4987,6 +7177,8 @@ void Core_quit(void) {
 }
 void Core_close(void) {
 	if (core.handle) dlclose(core.handle);
+	core.handle = NULL;
+	core.serialization_quirks = 0;
 }
 
 ///////////////////////////////////////
@@ -5028,6 +7220,7 @@ static struct {
 	int slot;
 	int save_exists;
 	int preview_exists;
+	char* save_status;
 } menu = {
 	.bitmap = NULL,
 	.disc = -1,
@@ -5104,6 +7297,7 @@ void Menu_beforeSleep() {
 	SRAM_write();
 	RTC_write();
 	State_autosave();
+	State_flush(); // we might be about to lose power
 	putFile(AUTO_RESUME_PATH, game.path + strlen(SDCARD_PATH));
 	
 	PWR_setCPUSpeed(CPU_SPEED_MENU);
@@ -6070,7 +8264,7 @@ static int Menu_options(MenuList* list) {
 				for (int i=0; i<count; i++) {
 					MenuItem* item = &items[i];
 					int w = 0;
-					TTF_SizeUTF8(font.small, item->name, &w, NULL);
+					GFX_sizeUTF8(font.small, item->name, &w, NULL);
 					w += SCALE1(OPTION_PADDING*2);
 					if (w>mw) mw = w;
 				}
@@ -6088,7 +8282,7 @@ static int Menu_options(MenuList* list) {
 				if (j==selected_row) {
 					// move out of conditional if centering
 					int w = 0;
-					TTF_SizeUTF8(font.small, item->name, &w, NULL);
+					GFX_sizeUTF8(font.small, item->name, &w, NULL);
 					w += SCALE1(OPTION_PADDING*2);
 					
 					GFX_blitPillDark(ASSET_BUTTON, screen, &(SDL_Rect){
@@ -6101,7 +8295,7 @@ static int Menu_options(MenuList* list) {
 					
 					if (item->desc) desc = item->desc;
 				}
-				text = TTF_RenderUTF8_Blended(font.small, item->name, text_color);
+				text = GFX_renderUTF8(font.small, item->name, text_color);
 				SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){
 					ox+SCALE1(OPTION_PADDING),
 					oy+SCALE1((j*BUTTON_SIZE)+1)
@@ -6135,7 +8329,7 @@ static int Menu_options(MenuList* list) {
 				
 				if (item->values == NULL) {
 					// This is a navigation item, used to displayed a specific category
-					text = TTF_RenderUTF8_Blended(font.small, ">", COLOR_WHITE); // always white
+					text = GFX_renderUTF8(font.small, ">", COLOR_WHITE); // always white
 					SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){
 						ox + mw - text->w - SCALE1(OPTION_PADDING),
 						oy+SCALE1((j*BUTTON_SIZE)+3)
@@ -6148,7 +8342,7 @@ static int Menu_options(MenuList* list) {
 						while ( item->values && item->values[count]) count++;
 						if (item->value >= 0 && item->value < count) {
 							const char *str = item->values[item->value];
-							text = TTF_RenderUTF8_Blended(font.tiny, str ? str : "none", str ? COLOR_WHITE : COLOR_GRAY); // always white
+							text = GFX_renderUTF8(font.tiny, str ? str : "none", str ? COLOR_WHITE : COLOR_GRAY); // always white
 							if (text) {
 								SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){
 									ox + mw - text->w - SCALE1(OPTION_PADDING),
@@ -6164,7 +8358,7 @@ static int Menu_options(MenuList* list) {
 				if (j==selected_row) {
 					// white pill
 					int w = 0;
-					TTF_SizeUTF8(font.small, item->name, &w, NULL);
+					GFX_sizeUTF8(font.small, item->name, &w, NULL);
 					w += SCALE1(OPTION_PADDING*2);
 					GFX_blitPillDark(ASSET_BUTTON, screen, &(SDL_Rect){
 						ox,
@@ -6176,7 +8370,7 @@ static int Menu_options(MenuList* list) {
 					
 					if (item->desc) desc = item->desc;
 				}
-				text = TTF_RenderUTF8_Blended(font.small, item->name, text_color);
+				text = GFX_renderUTF8(font.small, item->name, text_color);
 				SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){
 					ox+SCALE1(OPTION_PADDING),
 					oy+SCALE1((j*BUTTON_SIZE)+1)
@@ -6194,13 +8388,13 @@ static int Menu_options(MenuList* list) {
 					int w = 0;
 					int lw = 0;
 					int rw = 0;
-					TTF_SizeUTF8(font.small, item->name, &lw, NULL);
+					GFX_sizeUTF8(font.small, item->name, &lw, NULL);
 					// every value list in an input table is the same
 					// so only calculate rw for the first item...
 					if (!mrw || type!=MENU_INPUT) {
 						if(item->values) {
 							for (int j=0; item->values[j]; j++) {
-								TTF_SizeUTF8(font.tiny, item->values[j], &rw, NULL);
+								GFX_sizeUTF8(font.tiny, item->values[j], &rw, NULL);
 								if (lw+rw>w) w = lw+rw;
 								if (rw>mrw) mrw = rw;
 							}
@@ -6235,7 +8429,7 @@ static int Menu_options(MenuList* list) {
 					
 					// white pill
 					int w = 0;
-					TTF_SizeUTF8(font.small, item->name, &w, NULL);
+					GFX_sizeUTF8(font.small, item->name, &w, NULL);
 					w += SCALE1(OPTION_PADDING*2);
 					GFX_blitPillDark(ASSET_BUTTON, screen, &(SDL_Rect){
 						ox,
@@ -6247,7 +8441,7 @@ static int Menu_options(MenuList* list) {
 					
 					if (item->desc) desc = item->desc;
 				}
-				text = TTF_RenderUTF8_Blended(font.small, item->name, text_color);
+				text = GFX_renderUTF8(font.small, item->name, text_color);
 				SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){
 					ox+SCALE1(OPTION_PADDING),
 					oy+SCALE1((j*BUTTON_SIZE)+1)
@@ -6261,7 +8455,7 @@ static int Menu_options(MenuList* list) {
 					int count = 0;
 					while ( item->values && item->values[count]) count++;
 					if (item->value >= 0 && item->value < count) {
-						text = TTF_RenderUTF8_Blended(font.tiny, item->values[item->value], COLOR_WHITE); // always white
+						text = GFX_renderUTF8(font.tiny, item->values[item->value], COLOR_WHITE); // always white
 						SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){
 							ox + mw - text->w - SCALE1(OPTION_PADDING),
 							oy+SCALE1((j*BUTTON_SIZE)+3)
@@ -6441,10 +8635,181 @@ static void Menu_scale(SDL_Surface* src, SDL_Surface* dst) {
 	// LOG_info("successful\n");
 }
 
+///////////////////////////////////////
+// slot index
+
+// the format lives in slots.h since the game switcher reads it too. the
+// previews are kept compressed in memory as well, browsing slots decodes
+// them from there without touching the sd card. the bmps are still written
+// for anything older that looks for them. the state writer updates a slot
+// once its state is safely on disk and the index is replaced whole through
+// commitFile, so a crash leaves the old one
+
+static SlotIndex slot_index;
+static uint8_t* slot_previews[SLOTS_COUNT]; // compressed, as in the index
+static pthread_mutex_t slot_index_mutex = PTHREAD_MUTEX_INITIALIZER; // the state writer commits slots
+
+static void SlotIndex_getPath(char* path) {
+	snprintf(path, MAX_PATH, "%s/%s.slots", menu.minui_dir, game.basename);
+}
+static void SlotIndex_getPreviewPath(char* path, int slot) {
+	snprintf(path, MAX_PATH, "%s/%s.%d.bmp", menu.minui_dir, game.basename, slot);
+}
+static void SlotIndex_reset(void) {
+	Slots_reset(&slot_index);
+	for (int i=0; i<SLOTS_COUNT; i++) {
+		free(slot_previews[i]);
+		slot_previews[i] = NULL;
+	}
+}
+static int SlotIndex_write(void) { // with slot_index_mutex held
+	char path[MAX_PATH];
+	SlotIndex_getPath(path);
+	
+	size_t size = sizeof(slot_index);
+	for (int i=0; i<SLOTS_COUNT; i++) {
+		size += slot_index.slots[i].preview_size;
+	}
+	uint8_t* file = malloc(size);
+	if (!file) return 0;
+	
+	memcpy(file, &slot_index, sizeof(slot_index));
+	size_t offset = sizeof(slot_index);
+	for (int i=0; i<SLOTS_COUNT; i++) {
+		if (!slot_index.slots[i].preview_size) continue;
+		memcpy(file + offset, slot_previews[i], slot_index.slots[i].preview_size);
+		offset += slot_index.slots[i].preview_size;
+	}
+	
+	int ok = putFileDurable(path, file, size);
+	if (!ok) LOG_error("Error writing slot index: %s (%s)\n", path, strerror(errno));
+	free(file);
+	return ok;
+}
+static SlotInfo SlotIndex_get(int slot) {
+	pthread_mutex_lock(&slot_index_mutex);
+	SlotInfo info = slot_index.slots[slot];
+	pthread_mutex_unlock(&slot_index_mutex);
+	return info;
+}
+static void SlotIndex_rebuild(void) { // one time probe of every slot, eg. for states saved before the index existed
+	uint64_t start = getMicroseconds();
+	SlotIndex_reset();
+	
+	int last_slot = state_slot;
+	for (int i=0; i<SLOTS_COUNT; i++) {
+		char path[MAX_PATH];
+		
+		// the previous version kept the index and raw previews with the states
+		snprintf(path, MAX_PATH, "%s/%s.slots.%d", core.states_dir, game.alt_name, i);
+		unlink(path);
+		
+		state_slot = i;
+		State_getPath(path);
+		
+		struct stat st;
+		if (stat(path, &st)) continue;
+		
+		SlotInfo* info = &slot_index.slots[i];
+		info->timestamp = st.st_mtime;
+		info->size = st.st_size;
+		info->codec = STATE_CODEC_SYSTEM;
+		info->generation = 1;
+		
+		SlotIndex_getPreviewPath(path, i);
+		if (exists(path)) info->preview = SLOT_PREVIEW_BMP;
+	}
+	state_slot = last_slot;
+	
+	char path[MAX_PATH];
+	snprintf(path, MAX_PATH, "%s/%s.slots", core.states_dir, game.alt_name);
+	unlink(path);
+	
+	SlotIndex_write();
+	LOG_info("SlotIndex_rebuild: %ims\n", (int)((getMicroseconds() - start) / 1000));
+}
+static void SlotIndex_load(void) {
+	char path[MAX_PATH];
+	SlotIndex_getPath(path);
+	
+	// a save still being written commits under the same lock, either before
+	// we read (and we see it) or after (and it updates what we read)
+	pthread_mutex_lock(&slot_index_mutex);
+	SlotIndex_reset();
+	uint8_t* file = Slots_read(path, &slot_index);
+	if (!file) {
+		SlotIndex_rebuild();
+		pthread_mutex_unlock(&slot_index_mutex);
+		return;
+	}
+	
+	for (int i=0; i<SLOTS_COUNT; i++) {
+		SlotInfo* info = &slot_index.slots[i];
+		const uint8_t* data = Slots_getPreview(&slot_index, file, i);
+		if (!data) continue;
+		
+		slot_previews[i] = malloc(info->preview_size);
+		if (slot_previews[i]) memcpy(slot_previews[i], data, info->preview_size);
+		else { // the bmp is still there
+			info->preview = SLOT_PREVIEW_BMP;
+			info->preview_size = 0;
+		}
+	}
+	free(file);
+	pthread_mutex_unlock(&slot_index_mutex);
+}
+static void SlotIndex_commit(int slot, size_t size, int codec, const StatePreview* preview) { // once the state itself is on disk, usually from the state writer
+	if (slot<0 || slot>=SLOTS_COUNT) return;
+	
+	uint8_t* packed = NULL;
+	int packed_size = 0;
+	if (preview && preview->pixels && preview->w && preview->h) {
+		int raw_size = preview->w * preview->h * 4;
+		int capacity = LZ4_compressBound(raw_size);
+		packed = malloc(capacity);
+		if (packed) packed_size = LZ4_compress_default((const char*)preview->pixels, (char*)packed, raw_size, capacity);
+		if (packed_size) {
+			uint8_t* fitted = realloc(packed, packed_size);
+			if (fitted) packed = fitted;
+		}
+		else {
+			LOG_error("Error compressing slot preview\n");
+			free(packed);
+			packed = NULL;
+		}
+	}
+	
+	pthread_mutex_lock(&slot_index_mutex);
+	SlotInfo* info = &slot_index.slots[slot];
+	info->timestamp = time(NULL);
+	info->size = size;
+	info->codec = codec;
+	info->generation += 1;
+	info->preview = packed ? SLOT_PREVIEW_LZ4 : SLOT_PREVIEW_BMP;
+	info->preview_w = packed ? preview->w : 0;
+	info->preview_h = packed ? preview->h : 0;
+	info->preview_size = packed_size;
+	free(slot_previews[slot]);
+	slot_previews[slot] = packed;
+	SlotIndex_write();
+	pthread_mutex_unlock(&slot_index_mutex);
+}
+static int SlotIndex_loadPreview(int slot, SDL_Surface* preview, uint32_t* generation) {
+	pthread_mutex_lock(&slot_index_mutex);
+	SlotInfo info = slot_index.slots[slot];
+	*generation = info.generation;
+	int ok = info.preview_w==preview->w && info.preview_h==preview->h && preview->pitch==preview->w*4
+		&& Slots_decodePreview(&info, slot_previews[slot], preview->pixels);
+	pthread_mutex_unlock(&slot_index_mutex);
+	return ok;
+}
+
 static void Menu_initState(void) {
 	if (exists(menu.slot_path)) menu.slot = getInt(menu.slot_path);
 	if (menu.slot==8) menu.slot = 0;
 	
+	SlotIndex_load();
+	
 	menu.save_exists = 0;
 	menu.preview_exists = 0;
 }
@@ -6463,8 +8828,10 @@ static void Menu_updateState(void) {
 	snprintf(menu.bmp_path, sizeof(menu.bmp_path), "%s/%s.%d.bmp", menu.minui_dir, game.basename, menu.slot);
 	snprintf(menu.txt_path, sizeof(menu.txt_path), "%s/%s.%d.txt", menu.minui_dir, game.basename, menu.slot);
 	
-	menu.save_exists = exists(save_path);
-	menu.preview_exists = menu.save_exists && exists(menu.bmp_path);
+	SlotInfo info = SlotIndex_get(menu.slot);
+	menu.save_status = State_writerStatus(save_path);
+	menu.save_exists = menu.save_status || info.timestamp;
+	menu.preview_exists = menu.save_exists && info.preview!=SLOT_PREVIEW_NONE;
 
 	// LOG_info("save_path: %s (%i)\n", save_path, menu.save_exists);
 	// LOG_info("bmp_path: %s txt_path: %s (%i)\n", menu.bmp_path, menu.txt_path, menu.preview_exists);
@@ -6538,10 +8905,19 @@ static void Menu_saveState(void) {
 		putFile(menu.txt_path, disc_path + strlen(menu.base_path));
 	}
 	
+	SDL_Surface* thumbnail = SDL_CreateRGBSurface(SDL_SWSURFACE,DEVICE_WIDTH/2,DEVICE_HEIGHT/2,32,RGBA_MASK_8888);
+	
 	// if already in menu use menu.bitmap instead for saving screenshots otherwise create new one on the fly
 	if (newScreenshot) {
 		int cw, ch;
 		unsigned char* pixels = GFX_GL_screenCapture(&cw, &ch);
+		if (thumbnail) {
+			SDL_Surface* capture = SDL_CreateRGBSurfaceWithFormatFrom(pixels, cw, ch, 32, cw * 4, SDL_PIXELFORMAT_ABGR8888);
+			if (capture) {
+				SDL_BlitScaled(capture, NULL, thumbnail, NULL);
+				SDL_FreeSurface(capture);
+			}
+		}
 		SaveImageArgs* args = malloc(sizeof(SaveImageArgs));
 		args->pixels = pixels;
 		args->w = cw;
@@ -6554,11 +8930,13 @@ static void Menu_saveState(void) {
 		SDL_RWops* rw = SDL_RWFromFile(menu.bmp_path, "wb");
 		IMG_SavePNG_RW(menu.bitmap, rw,1);
 		LOG_info("saved screenshot\n");
+		if (thumbnail) SDL_BlitScaled(menu.bitmap, NULL, thumbnail, NULL);
 	}
 	
 	state_slot = menu.slot;
 	putInt(menu.slot_path, menu.slot);
-	State_write();
+	State_queue(menu.slot, thumbnail);
+	if (thumbnail) SDL_FreeSurface(thumbnail);
 }
 static void Menu_loadState(void) {
 	Menu_updateState();
@@ -6654,7 +9032,10 @@ static void Menu_loop(void) {
 	int dirty = 1;
 	int ignore_menu = 0;
 	int menu_start = 0;
+	int saving = State_writerBusy();
 	SDL_Surface* preview = SDL_CreateRGBSurface(SDL_SWSURFACE,DEVICE_WIDTH/2,DEVICE_HEIGHT/2,32,RGBA_MASK_8888); // TODO: retain until changed?
+	int preview_slot = -1; // currently in preview
+	uint32_t preview_generation = 0;
 
 	//set vid.blit to null for menu drawing no need for blitrender drawing
 	GFX_clearShaders();
@@ -6702,6 +9083,11 @@ static void Menu_loop(void) {
 			}
 		}
 		
+		if (saving!=State_writerBusy()) {
+			saving = !saving;
+			dirty = 1; // a save finished in the background
+		}
+		
 		if (dirty && (selected==ITEM_SAVE || selected==ITEM_LOAD)) {
 			Menu_updateState();
 		}
@@ -6784,7 +9170,7 @@ static void Menu_loop(void) {
 			max_width = MIN(max_width, text_width);
 
 			SDL_Surface* text;
-			text = TTF_RenderUTF8_Blended(font.large, display_name, uintToColour(THEME_COLOR6_255));
+			text = GFX_renderUTF8(font.large, display_name, uintToColour(THEME_COLOR6_255));
 			GFX_blitPillLight(ASSET_WHITE_PILL, screen, &(SDL_Rect){
 				SCALE1(PADDING),
 				SCALE1(PADDING),
@@ -6823,7 +9209,7 @@ static void Menu_loop(void) {
 							screen->w - SCALE1(PADDING * 2),
 							SCALE1(PILL_SIZE)
 						});
-						text = TTF_RenderUTF8_Blended(font.large, disc_name, text_color);
+						text = GFX_renderUTF8(font.large, disc_name, text_color);
 						SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){
 							screen->w - SCALE1(PADDING + BUTTON_PADDING) - text->w,
 							SCALE1(oy + PADDING + 4)
@@ -6831,7 +9217,7 @@ static void Menu_loop(void) {
 						SDL_FreeSurface(text);
 					}
 					
-					TTF_SizeUTF8(font.large, item, &ow, NULL);
+					GFX_sizeUTF8(font.large, item, &ow, NULL);
 					ow += SCALE1(BUTTON_PADDING*2);
 					
 					// pill
@@ -6845,7 +9231,7 @@ static void Menu_loop(void) {
 			
 				
 				// text
-				text = TTF_RenderUTF8_Blended(font.large, item, text_color);
+				text = GFX_renderUTF8(font.large, item, text_color);
 				SDL_BlitSurface(text, NULL, screen, &(SDL_Rect){
 					SCALE1(PADDING + BUTTON_PADDING),
 					SCALE1(oy + PADDING + (i * PILL_SIZE) + 4)
@@ -6870,7 +9256,19 @@ static void Menu_loop(void) {
 				ox += SCALE1(WINDOW_RADIUS);
 				oy += SCALE1(WINDOW_RADIUS);
 				
-				if (menu.preview_exists) { // has save, has preview
+				if (menu.save_status) {
+					SDL_Rect preview_rect = {ox,oy,hw,hh};
+					SDL_FillRect(screen, &preview_rect, SDL_MapRGBA(screen->format,0,0,0,255));
+					GFX_blitMessage(font.large, menu.save_status, screen, &preview_rect);
+				}
+				else if (menu.preview_exists && ((preview_slot==menu.slot && preview_generation==SlotIndex_get(menu.slot).generation) || SlotIndex_loadPreview(menu.slot, preview, &preview_generation))) {
+					preview_slot = menu.slot;
+					SDL_Rect preview_rect = {ox,oy,hw,hh};
+					SDL_FillRect(screen, &preview_rect, SDL_MapRGBA(screen->format,0,0,0,255));
+					SDL_BlitSurface(preview, NULL, screen, &(SDL_Rect){ox,oy});
+				}
+				else if (menu.preview_exists) { // has save, only has a png preview
+					preview_slot = -1;
 					// lotta memory churn here
 					SDL_Surface* bmp = IMG_Load(menu.bmp_path);
 					SDL_Surface* raw_preview = SDL_ConvertSurfaceFormat(bmp, SDL_PIXELFORMAT_RGBA8888,0);
@@ -7068,7 +9466,262 @@ void onAudioSinkChanged(int device, int watch_event)
 		LOG_error("asoundrc is not deleted yet!!!\n");
 }
 
+///////////////////////////////
+// warm start
+
+// `minarch.elf --warm` is exec'd and linked ahead of time and then idles on a
+// local socket, MinUI.pak starts one after every game. it runs alongside
+// nextui so it doesn't touch the display, audio, input, power or cpu until a
+// launch arrives, from there on it does exactly what a cold launch would.
+// a regular launch hands it its working directory, environment, paths and
+// stdout/stderr (so the game logs where launch.sh pointed it) then waits for
+// it to exit so launch.sh can't tell the difference. the warm instance
+// serves exactly one game. it refuses (and exits, to be replaced) when the
+// launch wants a different LD_* since the loader only reads those at exec
+#define WARM_ARG "--warm"
+#define WARM_SOCKET_PATH "/tmp/minarch.sock"
+#define WARM_ENV_MAX (16 * 1024)
+#define WARM_REQUEST_MAX (MAX_PATH * 3 + WARM_ENV_MAX)
+
+extern char** environ;
+
+static int warm_fd = -1; // the launch we're serving, kept open until we exit
+static const char* warm_fixed[] = {"LD_LIBRARY_PATH","LD_PRELOAD",NULL}; // must match the launch
+
+static int Warm_socket(struct sockaddr_un* addr) {
+	memset(addr, 0, sizeof(struct sockaddr_un));
+	addr->sun_family = AF_UNIX;
+	strncpy(addr->sun_path, WARM_SOCKET_PATH, sizeof(addr->sun_path) - 1);
+	return socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+}
+static int Warm_request(const char* core_path, const char* rom_path) { // returns 1 if a warm instance ran the game
+	if (!exists(WARM_SOCKET_PATH)) return 0;
+	
+	struct sockaddr_un addr;
+	int fd = Warm_socket(&addr);
+	if (fd<0) return 0;
+	if (connect(fd, (struct sockaddr*)&addr, sizeof(addr))!=0) {
+		LOG_info("Warm_request: no warm instance (%s)\n", strerror(errno));
+		close(fd);
+		return 0;
+	}
+	
+	// it runs with our working directory, launch.sh may have cd'd somewhere
+	char cwd[MAX_PATH];
+	if (!getcwd(cwd, sizeof(cwd))) strcpy(cwd, "/");
+	
+	// followed by our environment, one variable per line and a blank line to end
+	char request[WARM_REQUEST_MAX];
+	int len = snprintf(request, sizeof(request), "%s\n%s\n%s\n", cwd, core_path, rom_path);
+	for (char** env=environ; *env && len<sizeof(request); env++) {
+		if (strchr(*env, '\n')) continue; // can't be forwarded, rare enough to ignore
+		len += snprintf(request+len, sizeof(request)-len, "%s\n", *env);
+	}
+	if (len<sizeof(request)) len += snprintf(request+len, sizeof(request)-len, "\n");
+	
+	// our stdout and stderr ride along with it
+	int fds[2] = {STDOUT_FILENO, STDERR_FILENO};
+	char control[CMSG_SPACE(sizeof(fds))];
+	memset(control, 0, sizeof(control));
+	struct iovec iov = {request, len};
+	struct msghdr message = {0};
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+	struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_RIGHTS;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+	memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+	
+	char ack = 0;
+	if (len>=sizeof(request) || sendmsg(fd, &message, MSG_NOSIGNAL)!=len || read(fd, &ack, 1)!=1 || ack!='1') {
+		LOG_info("Warm_request: handoff %s, starting cold\n", ack=='0' ? "refused" : "failed");
+		close(fd);
+		return 0;
+	}
+	
+	LOG_info("Warm_request: handed off to warm instance\n");
+	while (read(fd, &ack, 1)!=0) { // the socket closes when it exits
+		if (errno!=EINTR) break;
+	}
+	close(fd);
+	return 1;
+}
+static const char* Warm_getenv(char** env, int count, const char* name) {
+	int len = strlen(name);
+	for (int i=0; i<count; i++) {
+		if (!strncmp(env[i], name, len) && env[i][len]=='=') return env[i] + len + 1;
+	}
+	return NULL;
+}
+static int Warm_isStale(char** env, int count) { // anything we already acted on that this launch would do differently
+	for (int i=0; warm_fixed[i]; i++) {
+		const char* ours = getenv(warm_fixed[i]);
+		const char* theirs = Warm_getenv(env, count, warm_fixed[i]);
+		if ((ours || theirs) && (!ours || !theirs || strcmp(ours, theirs))) {
+			LOG_info("Warm_isStale: %s differs\n", warm_fixed[i]);
+			return 1;
+		}
+	}
+	return 0;
+}
+static int Warm_readRequest(int fd, char* request, char* cwd, char* core_path, char* rom_path, char** env, int* env_count, int* fds) { // request must be WARM_REQUEST_MAX, fds 2
+	// don't let a wedged client keep us from the next one
+	struct timeval timeout = {1, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	
+	request[0] = '\0';
+	int len = 0;
+	while (!strstr(request, "\n\n")) {
+		if (len>=WARM_REQUEST_MAX-1) return 0;
+		
+		// the client's stdout and stderr arrive with the first bytes
+		char control[CMSG_SPACE(2 * sizeof(int))];
+		struct iovec iov = {request+len, WARM_REQUEST_MAX-1-len};
+		struct msghdr message = {0};
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		ssize_t count = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+		if (count<=0) return 0;
+		for (struct cmsghdr* cmsg=CMSG_FIRSTHDR(&message); cmsg; cmsg=CMSG_NXTHDR(&message, cmsg)) {
+			if (cmsg->cmsg_level!=SOL_SOCKET || cmsg->cmsg_type!=SCM_RIGHTS || cmsg->cmsg_len!=CMSG_LEN(2 * sizeof(int))) continue;
+			if (fds[0]<0) memcpy(fds, CMSG_DATA(cmsg), 2 * sizeof(int));
+		}
+		len += count;
+		request[len] = '\0';
+	}
+	
+	char* lines[3];
+	char* tmp = request;
+	for (int i=0; i<3; i++) {
+		lines[i] = tmp;
+		tmp = strchr(tmp, '\n');
+		if (!tmp) return 0;
+		*tmp++ = '\0';
+	}
+	if (!lines[1][0] || !lines[2][0]) return 0;
+	
+	*env_count = 0;
+	while (*tmp!='\n') {
+		char* end = strchr(tmp, '\n');
+		if (!end) return 0;
+		*end = '\0';
+		if (strchr(tmp, '=') && *env_count<WARM_ENV_MAX/2) env[(*env_count)++] = tmp;
+		tmp = end + 1;
+	}
+	
+	snprintf(cwd, MAX_PATH, "%s", lines[0]);
+	snprintf(core_path, MAX_PATH, "%s", lines[1]);
+	snprintf(rom_path, MAX_PATH, "%s", lines[2]);
+	return 1;
+}
+static void Warm_setEnvironment(char** env, int count) {
+	clearenv();
+	for (int i=0; i<count; i++) {
+		char* equals = strchr(env[i], '=');
+		*equals = '\0';
+		setenv(env[i], equals+1, 1);
+		*equals = '=';
+	}
+}
+static int Warm_wait(char* core_path, char* rom_path) {
+	struct sockaddr_un addr;
+	int fd = Warm_socket(&addr);
+	if (fd<0) return 0;
+	
+	unlink(WARM_SOCKET_PATH); // left behind by a warm instance that didn't exit cleanly
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr))!=0 || listen(fd, 1)!=0) {
+		LOG_error("Warm_wait: unable to listen on %s (%s)\n", WARM_SOCKET_PATH, strerror(errno));
+		close(fd);
+		return 0;
+	}
+	
+	static char request[WARM_REQUEST_MAX];
+	static char* env[WARM_ENV_MAX/2];
+	LOG_info("Warm_wait: waiting for a launch\n");
+	while (warm_fd<0) {
+		int client = accept(fd, NULL, NULL);
+		if (client<0) {
+			if (errno==EINTR) continue;
+			LOG_error("Warm_wait: accept failed (%s)\n", strerror(errno));
+			break;
+		}
+		
+		char cwd[MAX_PATH];
+		int env_count;
+		int fds[2] = {-1,-1};
+		int ok = Warm_readRequest(client, request, cwd, core_path, rom_path, env, &env_count, fds);
+		if (!ok || fds[0]<0) {
+			LOG_error("Warm_wait: dropped malformed request\n");
+		}
+		else if (Warm_isStale(env, env_count)) {
+			// the launch goes cold and MinUI.pak starts a fresh warm instance after it
+			write(client, "0", 1);
+			close(client);
+			client = -1;
+		}
+		else if (chdir(cwd)!=0) {
+			LOG_error("Warm_wait: dropped request for %s\n", cwd);
+		}
+		else {
+			Warm_setEnvironment(env, env_count);
+			fflush(stdout);
+			fflush(stderr);
+			dup2(fds[0], STDOUT_FILENO);
+			dup2(fds[1], STDERR_FILENO);
+			if (write(client, "1", 1)==1) warm_fd = client; // already close-on-exec, keep it from the core
+		}
+		for (int i=0; i<2; i++) {
+			if (fds[i]>=0) close(fds[i]);
+		}
+		if (client<0) break;
+		if (warm_fd<0) close(client);
+	}
+	
+	// nobody else should try to hand off to us now
+	close(fd);
+	unlink(WARM_SOCKET_PATH);
+	if (warm_fd<0) return 0;
+	
+	LOG_info("Warm_wait: launching %s with %s\n", rom_path, core_path);
+	return 1;
+}
+
+static uint32_t phase_start = 0;
+static void logPhase(const char* phase) { // startup timings
+	uint32_t now = SDL_GetTicks();
+	LOG_info("startup: %s %ims\n", phase, now - phase_start);
+	phase_start = now;
+}
+
 int main(int argc , char* argv[]) {
+	if(argc < 2)
+		return EXIT_FAILURE;
+	
+	char core_path[MAX_PATH];
+	char rom_path[MAX_PATH]; 
+	char tag_name[MAX_PATH];
+	
+	int warm = exactMatch(argv[1], WARM_ARG);
+	if (!warm) {
+		strncpy(core_path, argv[1], MAX_PATH - 1);
+		core_path[MAX_PATH - 1] = '\0';
+		strncpy(rom_path, argv[2], MAX_PATH - 1);
+		rom_path[MAX_PATH - 1] = '\0';
+		
+		// an idle instance already did the exec
+		if (Warm_request(core_path, rom_path)) return EXIT_SUCCESS;
+	}
+	else if (!Warm_wait(core_path, rom_path)) return EXIT_FAILURE;
+	
+	// only time what's left after the handoff
+	uint32_t launch_start = SDL_GetTicks();
+	phase_start = launch_start;
+	
 	LOG_info("MinArch\n");
 
 	static char asoundpath[MAX_PATH];
@@ -7087,21 +9740,6 @@ int main(int argc , char* argv[]) {
 	// char tmp[2];
 	// tmp[2] = 'a';
 	
-	char core_path[MAX_PATH];
-	char rom_path[MAX_PATH]; 
-	char tag_name[MAX_PATH];
-
-	if(argc < 2)
-		return EXIT_FAILURE;
-
-	strncpy(core_path, argv[1], MAX_PATH - 1);
-	core_path[MAX_PATH - 1] = '\0';
-	strncpy(rom_path, argv[2], MAX_PATH - 1);
-	rom_path[MAX_PATH - 1] = '\0';
-	getEmuName(rom_path, tag_name);
-	
-	LOG_info("rom_path: %s\n", rom_path);
-	
 	screen = GFX_init(MODE_MENU);
 
 	// initialize default shaders
@@ -7120,13 +9758,25 @@ int main(int argc , char* argv[]) {
 		PWR_disableSleep();
 	MSG_init();
 	IMG_Init(IMG_INIT_PNG);
+	
+	getEmuName(rom_path, tag_name);
+	LOG_info("rom_path: %s\n", rom_path);
+	logPhase("init");
+	
+	// if we already know the frontend will read the rom, get the kernel
+	// started on it while dlopen pulls in the core
+	CoreInfo core_info;
+	if (CoreInfo_get(core_path, &core_info) && CoreInfo_readsRom(&core_info, rom_path)) prefetchFile(rom_path);
+	
 	Core_open(core_path, tag_name);
+	logPhase("Core_open");
 
 	fmt = RETRO_PIXEL_FORMAT_XRGB8888;
 	environment_callback(RETRO_ENVIRONMENT_SET_PIXEL_FORMAT, &fmt);
 
 	Game_open(rom_path); // nes tries to load gamegenie setting before this returns ffs
 	if (!game.is_open) goto finish;
+	logPhase("Game_open");
 	
 	simple_mode = exists(SIMPLE_MODE_PATH);
 	
@@ -7135,15 +9785,23 @@ int main(int argc , char* argv[]) {
 	Config_init();
 	Config_readOptions(); // cores with boot logo option (eg. gb) need to load options early
 	setOverclock(overclock);
+	logPhase("Config");
 	
 	Core_init();
+	logPhase("Core_init");
 
 	// TODO: find a better place to do this
 	// mixing static and loaded data is messy
 	// why not move to Core_init()?
 	// ah, because it's defined before options_menu...
 	options_menu.items[1].desc = (char*)core.version;
+	
+	// a zipped game may still be extracting
+	if (!Extractor_wait()) goto finish;
+	logPhase("Extractor_wait");
+	
 	Core_load();
+	logPhase("Core_load");
 	Input_init(NULL);
 	Config_readOptions(); // but others load and report options later (eg. nes)
 	Config_readControls(); // restore controls (after the core has reported its defaults)
@@ -7155,6 +9813,8 @@ int main(int argc , char* argv[]) {
 	State_resume();
 	Menu_initState(); // make ready for state shortcuts
 
+	logPhase("Menu_init");
+
 	PWR_warn(1);
 	PWR_disableAutosleep();
 	// we dont need five second updates while ingame, and wifi status isnt displayed either
@@ -7187,12 +9847,17 @@ int main(int argc , char* argv[]) {
 	applyShaderSettings();
 	// release config when all is loaded
 	Config_free();
+	warmShaders(); // after ours so they don't hold up the first frame
+	logPhase("shaders");
 
-	LOG_info("total startup time %ims\n\n",SDL_GetTicks());
+	LOG_info("total startup time %ims%s\n\n",SDL_GetTicks() - launch_start, warm ? " (warm)" : "");
 	while (!quit) {
 		GFX_startFrame();
 	
+		if (rewinding) Rewind_step();
 		core.run();
+		if (!rewinding) Rewind_push();
+		SRAM_monitor();
 		limitFF();
 		trackFPS();
 		
@@ -7248,9 +9913,13 @@ int main(int argc , char* argv[]) {
 	
 finish:
 
+	Rewind_quit();
+	State_writerQuit();
+	State_freeBuffers();
 	Game_close();
 	Core_unload();
 	Core_quit();
+	SRAM_writerQuit();
 	Core_close();
 	Config_quit();
 	Special_quit();
@@ -12,6 +12,7 @@
 #include "api.h"
 #include "utils.h"
 #include "config.h"
+#include "slots.h"
 #include <sys/resource.h>
 #include <pthread.h>
 #include <assert.h>
@@ -544,6 +545,8 @@ static int simple_mode = 0;
 static int switcher_selected = 0;
 static char slot_path[256];
 static char preview_path[256];
+static char slots_path[256];
+static int preview_slot = 0;
 static int animationdirection = 0;
 
 static int restore_depth = -1;
@@ -1268,9 +1271,28 @@ static void readyResumePath(char* rom_path, int type) {
 		getFile(slot_path, slot, 16);
 		int s = atoi(slot);
 		snprintf(preview_path, sizeof(preview_path), "%s/.minui/%s/%s.%0d.bmp", SHARED_USERDATA_PATH, emu_name, rom_file, s); // /.userdata/.minui/<EMU>/<romname>.ext.<n>.bmp
+		snprintf(slots_path, sizeof(slots_path), "%s/.minui/%s/%s.slots", SHARED_USERDATA_PATH, emu_name, rom_file); // /.userdata/.minui/<EMU>/<romname>.ext.slots
+		preview_slot = s;
 		has_preview = exists(preview_path);
 	}
 }
+static SDL_Surface* loadResumePreview(void) { // the slot index's thumbnail if it has one, it's much smaller than the bmp
+	SlotIndex index;
+	uint8_t* file = Slots_read(slots_path, &index);
+	if (file) {
+		SDL_Surface* preview = NULL;
+		const uint8_t* data = Slots_getPreview(&index, file, preview_slot);
+		SlotInfo* info = data ? &index.slots[preview_slot] : NULL;
+		if (info) preview = SDL_CreateRGBSurface(SDL_SWSURFACE, info->preview_w, info->preview_h, 32, RGBA_MASK_8888);
+		if (preview && !Slots_decodePreview(info, data, preview->pixels)) {
+			SDL_FreeSurface(preview);
+			preview = NULL;
+		}
+		free(file);
+		if (preview) return preview;
+	}
+	return IMG_Load(preview_path);
+}
 static void readyResume(Entry* entry) {
 	readyResumePath(entry->path, entry->type);
 }
@@ -1390,6 +1412,10 @@ static void openRom(char* path, char* last) {
 	char emu_path[256];
 	getEmuPath(emu_name, emu_path);
 	
+	// warm the page cache for roms minarch will read or inflate itself
+	CoreInfo core_info;
+	if (CoreInfo_getByTag(emu_name, &core_info) && CoreInfo_readsRom(&core_info, sd_path)) prefetchFile(sd_path);
+	
 	// NOTE: escapeSingleQuotes() modifies the passed string 
 	// so we need to save the path before we call that
 	addRecent(recent_path, recent_alias); // yiiikes
@@ -2082,7 +2108,7 @@ void animcallback(finishedTask *task) {
 			pilltargetY = task->targetY;
 			pilltargetTextY = task->targetTextY;
 			SDL_Color text_color = uintToColour(THEME_COLOR5_255);
-			SDL_Surface *tmp = TTF_RenderUTF8_Blended(font.large, task->entry_name, text_color);
+			SDL_Surface *tmp = GFX_renderUTF8(font.large, task->entry_name, text_color);
 
 			SDL_Surface *converted = SDL_ConvertSurfaceFormat(tmp, SDL_PIXELFORMAT_RGBA8888, 0);
 			SDL_FreeSurface(tmp); // tmp no longer needed
@@ -2884,7 +2910,7 @@ int main (int argc, char *argv[]) {
 
 						SDL_Surface* text;
 						SDL_Color textColor = uintToColour(THEME_COLOR6_255);
-						text = TTF_RenderUTF8_Blended(font.large, display_name, textColor);
+						text = GFX_renderUTF8(font.large, display_name, textColor);
 						const int text_offset_y = (SCALE1(PILL_SIZE) - text->h + 1) >> 1;
 						GFX_blitPillLight(ASSET_WHITE_PILL, screen, &(SDL_Rect){
 							SCALE1(PADDING),
@@ -2912,7 +2938,7 @@ int main (int argc, char *argv[]) {
 					if(has_preview) {
 						// lotta memory churn here
 					
-						SDL_Surface* bmp = IMG_Load(preview_path);
+						SDL_Surface* bmp = loadResumePreview();
 						SDL_Surface* raw_preview = SDL_ConvertSurfaceFormat(bmp, SDL_PIXELFORMAT_RGBA8888, 0);
 						if (raw_preview) {
 							SDL_FreeSurface(bmp); 
@@ -3133,8 +3159,8 @@ int main (int argc, char *argv[]) {
 							text_color = uintToColour(THEME_COLOR5_255);
 							notext=1;
 						}
-						SDL_Surface* text = TTF_RenderUTF8_Blended(font.large, entry_name, text_color);
-						SDL_Surface* text_unique = TTF_RenderUTF8_Blended(font.large, display_name, COLOR_DARK_TEXT);
+						SDL_Surface* text = GFX_renderUTF8(font.large, entry_name, text_color);
+						SDL_Surface* text_unique = GFX_renderUTF8(font.large, display_name, COLOR_DARK_TEXT);
 						const int text_offset_y = (SCALE1(PILL_SIZE) - text->h + 1) >> 1;
 						if (j == selected_row) {
 							is_scrolling = GFX_resetScrollText(font.large,display_name, max_width - SCALE1(BUTTON_PADDING*2));
@@ -0,0 +1,157 @@
+// replays the GET_VARIABLE traffic of a core that polls every one of its
+// options each frame, against the old linear scan and the hashed index
+// minarch uses now. both lookups are copied from minarch.c, keep them in
+// step with it. builds for the host or the device:
+//   optionbench [options] [frames]
+// defaults to 120 options, about what the bigger cores declare, polled for
+// 600 frames
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+typedef struct Option {
+	char* key;
+	int value;
+	int count;
+	char** values;
+} Option;
+typedef struct OptionList {
+	int count;
+	Option* options;
+	int* index; // open addressed, holds option index + 1
+	int index_size; // power of two
+} OptionList;
+
+static char* values[] = {"disabled","enabled","auto","2x","4x",NULL};
+
+///////////////////////////////////////
+// before: scan the list, count values on every call
+
+static Option* scan_getOption(OptionList* list, const char* key) {
+	for (int i=0; i<list->count; i++) {
+		Option* item = &list->options[i];
+		if (!strcmp(item->key, key)) return item;
+	}
+	return NULL;
+}
+static char* scan_getOptionValue(OptionList* list, const char* key) {
+	Option* item = scan_getOption(list, key);
+	if (item) {
+		int count = 0;
+		while (item->values && item->values[count]) count++;
+		if (item->value >= 0 && item->value < count) {
+			return item->values[item->value];
+		}
+	}
+	return NULL;
+}
+
+///////////////////////////////////////
+// after: fnv-1a into an open addressed index, precomputed value count
+
+static uint32_t hash_key(const char* key) { // fnv-1a
+	uint32_t hash = 2166136261u;
+	while (*key) {
+		hash ^= (uint8_t)*key++;
+		hash *= 16777619u;
+	}
+	return hash;
+}
+static void hash_index(OptionList* list) {
+	int size = 16;
+	while (size < list->count * 2) size <<= 1; // keep it at most half full
+	list->index = calloc(size, sizeof(int));
+	list->index_size = size;
+	
+	int mask = size - 1;
+	for (int i=0; i<list->count; i++) {
+		const char* key = list->options[i].key;
+		int slot = hash_key(key) & mask;
+		while (list->index[slot]) {
+			if (!strcmp(list->options[list->index[slot]-1].key, key)) break;
+			slot = (slot + 1) & mask;
+		}
+		if (!list->index[slot]) list->index[slot] = i + 1;
+	}
+}
+static Option* hash_getOption(OptionList* list, const char* key) {
+	int mask = list->index_size - 1;
+	int slot = hash_key(key) & mask;
+	while (list->index[slot]) {
+		Option* item = &list->options[list->index[slot]-1];
+		if (!strcmp(item->key, key)) return item;
+		slot = (slot + 1) & mask;
+	}
+	return NULL;
+}
+static char* hash_getOptionValue(OptionList* list, const char* key) {
+	Option* item = hash_getOption(list, key);
+	if (item && item->values && item->value >= 0 && item->value < item->count) {
+		return item->values[item->value];
+	}
+	return NULL;
+}
+
+///////////////////////////////////////
+
+static uint64_t now(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return (uint64_t)time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+typedef char* (*lookup_t)(OptionList* list, const char* key);
+static double replay(lookup_t lookup, OptionList* list, char** keys, int frames, unsigned* checksum) { // ns per lookup
+	uint64_t start = now();
+	for (int frame=0; frame<frames; frame++) {
+		for (int i=0; i<list->count; i++) {
+			char* value = lookup(list, keys[i]);
+			*checksum = *checksum * 31 + (value ? value[0] : 0);
+		}
+	}
+	return (double)(now() - start) / ((double)frames * list->count);
+}
+
+int main(int argc, char* argv[]) {
+	int count = argc>1 ? atoi(argv[1]) : 120;
+	int frames = argc>2 ? atoi(argv[2]) : 600;
+	if (count<1 || frames<1) {
+		fprintf(stderr, "usage: %s [options] [frames]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	
+	// keys share a long core prefix like real ones do, which is the worst
+	// case for strcmp in the scan
+	OptionList list = {0};
+	list.count = count;
+	list.options = calloc(count, sizeof(Option));
+	char** keys = calloc(count, sizeof(char*));
+	for (int i=0; i<count; i++) {
+		char key[64];
+		snprintf(key, sizeof(key), "examplecore_option_%03i", i);
+		list.options[i].key = strdup(key);
+		list.options[i].values = values;
+		list.options[i].count = 5;
+		list.options[i].value = i % 5;
+		keys[i] = strdup(key); // a copy, cores pass their own strings
+	}
+	hash_index(&list);
+	
+	// core order, as polled
+	unsigned scan_sum = 0;
+	unsigned hash_sum = 0;
+	replay(scan_getOptionValue, &list, keys, 1, &scan_sum); // warm up
+	replay(hash_getOptionValue, &list, keys, 1, &hash_sum);
+	scan_sum = hash_sum = 0;
+	double scan_ns = replay(scan_getOptionValue, &list, keys, frames, &scan_sum);
+	double hash_ns = replay(hash_getOptionValue, &list, keys, frames, &hash_sum);
+	
+	printf("%i options, %i frames, %i lookups each\n", count, frames, count * frames);
+	printf("  scan  %7.1fns per lookup, %8.1fus per frame\n", scan_ns, scan_ns * count / 1000);
+	printf("  hash  %7.1fns per lookup, %8.1fus per frame\n", hash_ns, hash_ns * count / 1000);
+	printf("  results %s (%08x)\n", scan_sum==hash_sum ? "match" : "DIFFER", hash_sum);
+	return scan_sum==hash_sum ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -438,7 +438,7 @@ SDL_Rect MenuList::itemSizeHint(const AbstractMenuItem &item)
     {
         // calculate the size of the list
         int w = 0;
-        TTF_SizeUTF8(font.small, item.getName().c_str(), &w, NULL);
+        GFX_sizeUTF8(font.small, item.getName().c_str(), &w, NULL);
         w += SCALE1(OPTION_PADDING * 2);
         return {0, 0, w, SCALE1(PILL_SIZE)};
     }
@@ -447,7 +447,7 @@ SDL_Rect MenuList::itemSizeHint(const AbstractMenuItem &item)
         int w = 0;
         int lw = 0;
         int rw = 0;
-        TTF_SizeUTF8(font.small, item.getName().c_str(), &lw, NULL);
+        GFX_sizeUTF8(font.small, item.getName().c_str(), &lw, NULL);
         // get the width of the widest row
         int mrw = 0;
         // every value list in an input table is the same
@@ -456,7 +456,7 @@ SDL_Rect MenuList::itemSizeHint(const AbstractMenuItem &item)
         {
             for (int j = 0; item.getValues().size() > j && !item.getLabels()[j].empty(); j++)
             {
-                TTF_SizeUTF8(font.tiny, item.getLabels()[j].c_str(), &rw, NULL);
+                GFX_sizeUTF8(font.tiny, item.getLabels()[j].c_str(), &rw, NULL);
                 if (lw + rw > w)
                     w = lw + rw;
                 if (rw > mrw)
@@ -473,7 +473,7 @@ SDL_Rect MenuList::itemSizeHint(const AbstractMenuItem &item)
     else if (type == MenuItemType::Main)
     {
         int w = 0;
-        TTF_SizeUTF8(font.large, item.getName().c_str(), &w, NULL);
+        GFX_sizeUTF8(font.large, item.getName().c_str(), &w, NULL);
         w += SCALE1(BUTTON_PADDING * 2);
         return {0, 0, w, SCALE1(PILL_SIZE)};
     }
@@ -585,13 +585,13 @@ void MenuList::drawListItem(SDL_Surface *surface, const SDL_Rect &dst, const Abs
     {
         // move out of conditional if centering
         int w = 0;
-        TTF_SizeUTF8(font.small, item.getName().c_str(), &w, NULL);
+        GFX_sizeUTF8(font.small, item.getName().c_str(), &w, NULL);
         w += SCALE1(OPTION_PADDING * 2);
 
         GFX_blitPillDarkCPP(ASSET_BUTTON, surface, {dst.x, dst.y, w, SCALE1(BUTTON_SIZE)});
         text_color = uintToColour(THEME_COLOR5_255);
     }
-    text = TTF_RenderUTF8_Blended(font.small, item.getName().c_str(), text_color);
+    text = GFX_renderUTF8(font.small, item.getName().c_str(), text_color);
     SDL_BlitSurfaceCPP(text, {}, surface, {dst.x + SCALE1(OPTION_PADDING), dst.y  + ((dst.h - text->h) / 2)});
     SDL_FreeSurface(text);
 }
@@ -650,7 +650,7 @@ void MenuList::drawFixedItem(SDL_Surface *surface, const SDL_Rect &dst, const Ab
 
     if (item.getValue().has_value())
     {
-        text = TTF_RenderUTF8_Blended(font.tiny, item.getLabel().c_str(), text_color_value);
+        text = GFX_renderUTF8(font.tiny, item.getLabel().c_str(), text_color_value);
 
         if (item.getType() == ListItemType::Color)
         {
@@ -683,13 +683,13 @@ void MenuList::drawFixedItem(SDL_Surface *surface, const SDL_Rect &dst, const Ab
     {
         // white pill
         int w = 0;
-        TTF_SizeUTF8(font.small, item.getName().c_str(), &w, NULL);
+        GFX_sizeUTF8(font.small, item.getName().c_str(), &w, NULL);
         w += SCALE1(OPTION_PADDING * 2);
         GFX_blitPillDarkCPP(ASSET_BUTTON, surface, {dst.x, dst.y, w, SCALE1(BUTTON_SIZE)});
         text_color = uintToColour(THEME_COLOR5_255);
     }
 
-    text = TTF_RenderUTF8_Blended(font.small, item.getName().c_str(), text_color);
+    text = GFX_renderUTF8(font.small, item.getName().c_str(), text_color);
     SDL_BlitSurfaceCPP(text, {}, surface, {dst.x + SCALE1(OPTION_PADDING), dst.y + ((dst.h - text->h) / 2)});
     SDL_FreeSurface(text);
 }
@@ -739,12 +739,12 @@ void MenuList::drawInputItem(SDL_Surface *surface, const SDL_Rect &dst, const Ab
 
         // white pill
         int w = 0;
-        TTF_SizeUTF8(font.small, item.getName().c_str(), &w, NULL);
+        GFX_sizeUTF8(font.small, item.getName().c_str(), &w, NULL);
         w += SCALE1(OPTION_PADDING * 2);
         GFX_blitPillDarkCPP(ASSET_BUTTON, surface, {dst.x, dst.y, w, SCALE1(BUTTON_SIZE)});
         text_color = COLOR_BLACK;
     }
-    text = TTF_RenderUTF8_Blended(font.small, item.getName().c_str(), text_color);
+    text = GFX_renderUTF8(font.small, item.getName().c_str(), text_color);
     SDL_BlitSurfaceCPP(text, {}, surface, {dst.x + SCALE1(OPTION_PADDING), dst.y + ((dst.h - text->h) / 2)});
     SDL_FreeSurface(text);
 
@@ -754,7 +754,7 @@ void MenuList::drawInputItem(SDL_Surface *surface, const SDL_Rect &dst, const Ab
     }
     else if (item.getValue().has_value())
     {
-        text = TTF_RenderUTF8_Blended(font.tiny, item.getLabel().c_str(), COLOR_WHITE); // always white
+        text = GFX_renderUTF8(font.tiny, item.getLabel().c_str(), COLOR_WHITE); // always white
         SDL_BlitSurfaceCPP(text, {}, surface, {dst.x + mw - text->w - SCALE1(OPTION_PADDING), dst.y + ((dst.h - text->h) / 2)});
         SDL_FreeSurface(text);
     }
@@ -806,7 +806,7 @@ void MenuList::drawMainItem(SDL_Surface *surface, const SDL_Rect &dst, const Abs
     {
         // TODO: port this over when needed. Its complete spaghetti code...
     }
-    text = TTF_RenderUTF8_Blended(font.large, truncated, text_color);
+    text = GFX_renderUTF8(font.large, truncated, text_color);
     SDL_BlitSurfaceCPP(text, {}, surface, {dst.x + SCALE1(BUTTON_PADDING), dst.y + ((dst.h - text->h) / 2)});
     SDL_FreeSurface(text);
 }
@@ -0,0 +1,221 @@
+// compares the save state codecs minarch can write (none, lz4, zstd 1/3/9)
+// on real states: ratio, compress and decompress speed, and a round trip
+// check. takes raw states or minarch's own NXSTATE files (decoded first),
+// rzip states need to be saved again with another codec. builds for the
+// host or the device:
+//   statebench <file.st0> [more states...]
+// without arguments it runs on a generated 1MB state, mostly so it can be
+// tried anywhere, real states compress very differently
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <dlfcn.h>
+
+#include "lz4.h"
+
+#define STATE_MAGIC "NXSTATE" // must match minarch.c
+#define REPEATS 5 // best of
+
+enum { // as stored in StateHeader.codec
+	CODEC_RAW,
+	CODEC_ZSTD,
+	CODEC_LZ4,
+};
+
+typedef struct StateHeader {
+	char magic[8];
+	uint8_t version;
+	uint8_t codec;
+	uint8_t level;
+	uint8_t reserved[5];
+	uint64_t size;
+	uint64_t data_size;
+} StateHeader;
+
+static struct {
+	void* handle;
+	size_t (*compressBound)(size_t src_size);
+	size_t (*compress)(void* dst, size_t dst_capacity, const void* src, size_t src_size, int level);
+	size_t (*decompress)(void* dst, size_t dst_capacity, const void* src, size_t src_size);
+	unsigned (*isError)(size_t code);
+} zstd;
+
+static void loadZstd(void) {
+	zstd.handle = dlopen("libzstd.so.1", RTLD_NOW|RTLD_LOCAL);
+	if (!zstd.handle) {
+		printf("no libzstd (%s), skipping zstd\n", dlerror());
+		return;
+	}
+	zstd.compressBound = dlsym(zstd.handle, "ZSTD_compressBound");
+	zstd.compress = dlsym(zstd.handle, "ZSTD_compress");
+	zstd.decompress = dlsym(zstd.handle, "ZSTD_decompress");
+	zstd.isError = dlsym(zstd.handle, "ZSTD_isError");
+	if (!zstd.compressBound || !zstd.compress || !zstd.decompress || !zstd.isError) {
+		dlclose(zstd.handle);
+		zstd.handle = NULL;
+	}
+}
+
+static double now(void) {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec * 1000.0 + time.tv_nsec / 1000000.0;
+}
+
+static size_t compressState(int codec, int level, const uint8_t* state, size_t size, uint8_t* packed, size_t capacity) { // 0 on failure
+	if (codec==CODEC_RAW) {
+		memcpy(packed, state, size);
+		return size;
+	}
+	if (codec==CODEC_LZ4) return LZ4_compress_default((const char*)state, (char*)packed, size, capacity);
+	size_t packed_size = zstd.compress(packed, capacity, state, size, level);
+	return zstd.isError(packed_size) ? 0 : packed_size;
+}
+static size_t decompressState(int codec, const uint8_t* packed, size_t packed_size, uint8_t* state, size_t size) {
+	if (codec==CODEC_RAW) {
+		memcpy(state, packed, packed_size);
+		return packed_size;
+	}
+	if (codec==CODEC_LZ4) {
+		int unpacked = LZ4_decompress_safe((const char*)packed, (char*)state, packed_size, size);
+		return unpacked<0 ? 0 : unpacked;
+	}
+	size_t unpacked = zstd.decompress(state, size, packed, packed_size);
+	return zstd.isError(unpacked) ? 0 : unpacked;
+}
+
+// raw states as they are, minarch's own decoded, NULL for rzip and anything unreadable
+static uint8_t* loadState(const char* path, size_t* size) {
+	FILE* file = fopen(path, "rb");
+	if (!file) return NULL;
+	fseek(file, 0, SEEK_END);
+	size_t file_size = ftell(file);
+	rewind(file);
+	uint8_t* contents = malloc(file_size ? file_size : 1);
+	if (contents && fread(contents, 1, file_size, file)!=file_size) {
+		free(contents);
+		contents = NULL;
+	}
+	fclose(file);
+	if (!contents) return NULL;
+	
+	if (file_size>=8 && !memcmp(contents, "#RZIPv", 6)) {
+		printf("%s: rzip, save it with another codec first\n", path);
+		free(contents);
+		return NULL;
+	}
+	
+	StateHeader header;
+	if (file_size<sizeof(header) || memcmp(contents, STATE_MAGIC, sizeof(header.magic))) {
+		*size = file_size;
+		return contents;
+	}
+	
+	memcpy(&header, contents, sizeof(header));
+	uint8_t* state = malloc(header.size ? header.size : 1);
+	int usable = header.codec==CODEC_RAW || header.codec==CODEC_LZ4 || (header.codec==CODEC_ZSTD && zstd.handle);
+	if (!state || !usable || sizeof(header)+header.data_size>file_size
+		|| decompressState(header.codec, contents + sizeof(header), header.data_size, state, header.size)!=header.size
+	) {
+		printf("%s: unable to decode\n", path);
+		free(state);
+		state = NULL;
+	}
+	free(contents);
+	*size = header.size;
+	return state;
+}
+
+// something with the texture of a state: ram full of tiles and tables,
+// zeroed regions and a little noise
+static uint8_t* generateState(size_t* size) {
+	*size = 1024 * 1024;
+	uint8_t* state = malloc(*size);
+	srand(1);
+	for (size_t i=0; i<*size; i++) {
+		size_t region = (i / 4096) % 8;
+		if (region<3) state[i] = 0;
+		else if (region<6) state[i] = i>=64 && rand() % 8 ? state[i - 16 * (1 + rand() % 4)] : rand();
+		else if (region==6) state[i] = (i * 7) & 0xFF;
+		else state[i] = rand();
+	}
+	return state;
+}
+
+static void benchState(const char* name, const uint8_t* state, size_t size) {
+	struct {
+		const char* label;
+		int codec;
+		int level;
+	} codecs[] = {
+		{"none", CODEC_RAW, 0},
+		{"lz4", CODEC_LZ4, 0},
+		{"zstd 1", CODEC_ZSTD, 1},
+		{"zstd 3", CODEC_ZSTD, 3},
+		{"zstd 9", CODEC_ZSTD, 9},
+	};
+	
+	size_t capacity = size + size / 255 + 16;
+	if (zstd.handle && zstd.compressBound(size)>capacity) capacity = zstd.compressBound(size);
+	uint8_t* packed = malloc(capacity);
+	uint8_t* unpacked = malloc(size);
+	if (!packed || !unpacked) return;
+	
+	printf("%s (%zuKB)\n", name, size / 1024);
+	for (int i=0; i<sizeof(codecs) / sizeof(codecs[0]); i++) {
+		if (codecs[i].codec==CODEC_ZSTD && !zstd.handle) continue;
+		
+		double compress_ms = 0;
+		double decompress_ms = 0;
+		size_t packed_size = 0;
+		int ok = 1;
+		for (int repeat=0; repeat<REPEATS && ok; repeat++) {
+			double start = now();
+			packed_size = compressState(codecs[i].codec, codecs[i].level, state, size, packed, capacity);
+			double compressed = now();
+			memset(unpacked, 0, size);
+			double decompress_start = now();
+			ok = packed_size && decompressState(codecs[i].codec, packed, packed_size, unpacked, size)==size;
+			double decompressed = now();
+			ok = ok && !memcmp(state, unpacked, size);
+			
+			if (!repeat || compressed-start<compress_ms) compress_ms = compressed - start;
+			if (!repeat || decompressed-decompress_start<decompress_ms) decompress_ms = decompressed - decompress_start;
+		}
+		if (!ok) {
+			printf("  %-7s ROUND TRIP FAILED\n", codecs[i].label);
+			continue;
+		}
+		double mb = size / 1024.0 / 1024.0;
+		printf("  %-7s %6zuKB %5.1f%%  save %7.2fms (%6.0fMB/s)  load %7.2fms (%6.0fMB/s)\n", codecs[i].label,
+			packed_size / 1024, 100.0 * packed_size / size,
+			compress_ms, compress_ms>0 ? mb / (compress_ms / 1000.0) : 0,
+			decompress_ms, decompress_ms>0 ? mb / (decompress_ms / 1000.0) : 0);
+	}
+	free(packed);
+	free(unpacked);
+}
+
+int main(int argc, char* argv[]) {
+	loadZstd();
+	
+	if (argc<2) {
+		size_t size;
+		uint8_t* state = generateState(&size);
+		benchState("generated", state, size);
+		free(state);
+	}
+	for (int i=1; i<argc; i++) {
+		size_t size;
+		uint8_t* state = loadState(argv[i], &size);
+		if (!state) continue;
+		benchState(argv[i], state, size);
+		free(state);
+	}
+	
+	if (zstd.handle) dlclose(zstd.handle);
+	return EXIT_SUCCESS;
+}
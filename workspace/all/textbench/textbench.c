@@ -0,0 +1,115 @@
+// times what drawing a rom list costs in text: truncating 500 names to
+// the width of a list row and rendering them, first straight through
+// SDL_ttf the way GFX_truncateText used to, then through the glyph atlas.
+// run on device, optionally pointed at a rom folder for real names:
+//   textbench.elf [/mnt/SDCARD/Roms/<folder>]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <msettings.h>
+
+#include "defines.h"
+#include "api.h"
+#include "utils.h"
+
+#define ENTRY_COUNT 500
+
+static char names[ENTRY_COUNT][256];
+static int name_count = 0;
+
+static void loadNames(const char* path) {
+	DIR* dir = path ? opendir(path) : NULL;
+	if (dir) {
+		struct dirent* entry;
+		while (name_count<ENTRY_COUNT && (entry = readdir(dir))) {
+			if (entry->d_name[0]=='.') continue;
+			snprintf(names[name_count++], sizeof(names[0]), "%s", entry->d_name);
+		}
+		closedir(dir);
+	}
+	
+	// make up the rest, long enough that most need truncating
+	const char* words[] = {
+		"Super","Legend","of","the","Dragon","Quest","Fantasy","Final","Mega","World",
+		"Adventure","Island","Kart","Racing","Tactics","Chronicles","Warriors","Star",
+		"ドラゴン","クエスト","伝説","(USA)","(Japan)","(Europe)","[!]","(Rev 1)",
+	};
+	int word_count = sizeof(words) / sizeof(words[0]);
+	srand(1);
+	while (name_count<ENTRY_COUNT) {
+		char* name = names[name_count++];
+		int len = 0;
+		int count = 2 + rand() % 10;
+		for (int i=0; i<count; i++) {
+			len += snprintf(name+len, sizeof(names[0])-len, "%s%s", i ? " " : "", words[rand() % word_count]);
+		}
+	}
+}
+
+// GFX_truncateText before the glyph atlas
+static int truncateText(TTF_Font* ttf, const char* in_name, char* out_name, int max_width, int padding) {
+	int text_width;
+	strncpy(out_name, in_name, MAX_PATH - 1);
+	out_name[MAX_PATH - 1] = '\0';
+	TTF_SizeUTF8(ttf, out_name, &text_width, NULL);
+	text_width += padding;
+	
+	while (text_width > max_width) {
+		int len = strlen(out_name);
+		if (len >= 4) {
+			strncpy(&out_name[len - 4], "...", 4);
+			out_name[len - 1] = '\0';
+		}
+		TTF_SizeUTF8(ttf, out_name, &text_width, NULL);
+		text_width += padding;
+	}
+	return text_width;
+}
+
+static void runPass(const char* label, int atlas, int max_width, int padding) {
+	char truncated[MAX_PATH];
+	uint64_t truncating = 0;
+	uint64_t rendering = 0;
+	uint64_t checksum = 0; // so the widths can be compared between the two
+	
+	for (int i=0; i<name_count; i++) {
+		uint64_t start = getMicroseconds();
+		int width = atlas
+			? GFX_truncateText(font.large, names[i], truncated, max_width, padding)
+			: truncateText(font.large, names[i], truncated, max_width, padding);
+		uint64_t truncated_at = getMicroseconds();
+		SDL_Surface* text = atlas
+			? GFX_renderUTF8(font.large, truncated, COLOR_WHITE)
+			: TTF_RenderUTF8_Blended(font.large, truncated, COLOR_WHITE);
+		uint64_t rendered_at = getMicroseconds();
+		
+		truncating += truncated_at - start;
+		rendering += rendered_at - truncated_at;
+		checksum = checksum * 31 + width + (text ? text->w : 0);
+		if (text) SDL_FreeSurface(text);
+	}
+	printf("%-14s truncate %6.2fms  render %6.2fms  (widths %016llx)\n", label,
+		truncating / 1000.0, rendering / 1000.0, (unsigned long long)checksum);
+}
+
+int main(int argc , char* argv[]) {
+	PWR_setCPUSpeed(CPU_SPEED_PERFORMANCE);
+	
+	GFX_init(MODE_MAIN);
+	InitSettings();
+	loadNames(argc>1 ? argv[1] : NULL);
+	
+	int max_width = FIXED_WIDTH - SCALE1(PADDING * 2);
+	int padding = SCALE1(BUTTON_PADDING * 2);
+	printf("%i names, %ipx rows\n", name_count, max_width);
+	
+	runPass("SDL_ttf", 0, max_width, padding);
+	runPass("atlas (cold)", 1, max_width, padding);
+	runPass("atlas (warm)", 1, max_width, padding);
+	
+	QuitSettings();
+	GFX_quit();
+	return EXIT_SUCCESS;
+}
@@ -162,16 +162,17 @@ GLuint link_program(GLuint vertex_shader, GLuint fragment_shader, const char* ca
     // Try to load cached binary first
     FILE *f = fopen(cache_path, "rb");
     if (f) {
-        GLint binaryFormat;
-        fread(&binaryFormat, sizeof(GLint), 1, f);
+        GLenum binaryFormat = 0; // written as a GLenum below
+        fread(&binaryFormat, sizeof(GLenum), 1, f);
         fseek(f, 0, SEEK_END);
-        size_t length = ftell(f) - sizeof(GLint);
-        fseek(f, sizeof(GLint), SEEK_SET);
-        void *binary = malloc(length);
-        fread(binary, 1, length, f);
+        long size = ftell(f);
+        size_t length = size > (long)sizeof(GLenum) ? size - sizeof(GLenum) : 0;
+        fseek(f, sizeof(GLenum), SEEK_SET);
+        void *binary = length ? malloc(length) : NULL;
+        if (binary && fread(binary, 1, length, f) == length) {
+            glProgramBinary(program, binaryFormat, binary, length);
+        }
         fclose(f);
-
-        glProgramBinary(program, binaryFormat, binary, length);
         free(binary);
 
         glGetProgramiv(program, GL_LINK_STATUS, &success);
@@ -180,6 +181,7 @@ GLuint link_program(GLuint vertex_shader, GLuint fragment_shader, const char* ca
             return program;
         } else {
             LOG_info("Cache load failed, falling back to compile.\n");
+            unlink(cache_path); // stale or corrupt, rewritten below
             glDeleteProgram(program);
             program = glCreateProgram();
         }
@@ -833,7 +835,7 @@ static void updateEffect(void) {
 			effect_path = RES_PATH "/line-8.png";
 		}
 	}
-	else if (effect.type==EFFECT_GRID) {
+	else if (effect.type==EFFECT_GRID || effect.type==EFFECT_LCD) { // no subpixel png, the grid is closest
 		if (effect.scale<3) {
 			effect_path = RES_PATH "/grid-2.png";
 			opacity = 64; // 1 - 3/4 = 25%
@@ -8,6 +8,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -20,6 +21,7 @@
 
 #include "scaler.h"
 #include <time.h>
+#include <math.h>
 #include <pthread.h>
 
 #include <dirent.h>
@@ -29,6 +31,8 @@ static int reloadShaderTextures = 1;
 
 // shader stuff
 
+#define MAX_SHADER_PRAGMAS 32
+
 typedef struct Shader {
 	int srcw;
 	int srch;
@@ -40,16 +44,9 @@ typedef struct Shader {
 	int srctype;
 	int scaletype;
 	char *filename;
-	GLuint texture;
-	int updated;
-	GLint u_FrameDirection;
-	GLint u_FrameCount;
-	GLint u_OutputSize;
-	GLint u_TextureSize;
-	GLint u_InputSize;
-	GLint OrigInputSize;
-	GLint texLocation;
-	GLint texelSizeLocation;
+	int origw; // core frame size for OrigInputSize, 0 to use srcw
+	int origh;
+	int frame_count_mod; // 0 for none
 	ShaderParam *pragmas;  // Dynamic array of parsed pragma parameters
 	int num_pragmas;       // Count of valid pragma parameters
 
@@ -58,11 +55,13 @@ typedef struct Shader {
 GLuint g_shader_default = 0;
 GLuint g_shader_overlay = 0;
 GLuint g_noshader = 0;
+GLuint g_shader_effect = 0;
+GLuint g_shader_lcd = 0;
 
 Shader* shaders[MAXSHADERS] = {
-    &(Shader){ .shader_p = 0, .scale = 1, .filter = GL_LINEAR, .scaletype = 1, .srctype = 0, .filename ="stock.glsl", .texture = 0, .updated = 1 },
-    &(Shader){ .shader_p = 0, .scale = 1, .filter = GL_LINEAR, .scaletype = 1, .srctype = 0, .filename ="stock.glsl", .texture = 0, .updated = 1 },
-    &(Shader){ .shader_p = 0, .scale = 1, .filter = GL_LINEAR, .scaletype = 1, .srctype = 0, .filename ="stock.glsl", .texture = 0, .updated = 1 },
+    &(Shader){ .shader_p = 0, .scale = 1, .filter = GL_LINEAR, .scaletype = 1, .srctype = 0, .filename ="stock.glsl" },
+    &(Shader){ .shader_p = 0, .scale = 1, .filter = GL_LINEAR, .scaletype = 1, .srctype = 0, .filename ="stock.glsl" },
+    &(Shader){ .shader_p = 0, .scale = 1, .filter = GL_LINEAR, .scaletype = 1, .srctype = 0, .filename ="stock.glsl" },
 };
 
 static int nrofshaders = 0; // choose between 1 and 3 pipelines, > pipelines = more cpu usage, but more shader options and shader upscaling stuff
@@ -177,7 +176,11 @@ static uint32_t SDL_transparentBlack = 0;
 
 #define OVERLAYS_FOLDER SDCARD_PATH "/Overlays"
 
-static char* overlay_path = NULL;
+static char overlay_path[MAX_PATH] = "";
+static int overlayUpdated = 0;
+static void FramePrep_quit(void);
+static void LayerTexture_freeAll(void);
+static void TextTexture_freeAll(void);
 
 
 #define MAX_SHADERLINE_LENGTH 512
@@ -218,76 +221,6 @@ int extractPragmaParameters(const char *shaderSource, ShaderParam *params, int m
     return paramCount; // number of parameters found
 }
 
-GLuint link_program(GLuint vertex_shader, GLuint fragment_shader, const char* cache_key) {
-    char cache_path[512];
-    snprintf(cache_path, sizeof(cache_path), "/mnt/SDCARD/.shadercache/%s.bin", cache_key);
-
-    GLuint program = glCreateProgram();
-    GLint success;
-
-    // Try to load cached binary first
-    FILE *f = fopen(cache_path, "rb");
-    if (f) {
-        GLint binaryFormat;
-        fread(&binaryFormat, sizeof(GLint), 1, f);
-        fseek(f, 0, SEEK_END);
-        size_t length = ftell(f) - sizeof(GLint);
-        fseek(f, sizeof(GLint), SEEK_SET);
-        void *binary = malloc(length);
-        fread(binary, 1, length, f);
-        fclose(f);
-
-        glProgramBinary(program, binaryFormat, binary, length);
-        free(binary);
-
-        glGetProgramiv(program, GL_LINK_STATUS, &success);
-        if (success) {
-            LOG_info("Loaded shader program from cache: %s\n", cache_key);
-            return program;
-        } else {
-            LOG_info("Cache load failed, falling back to compile.\n");
-            glDeleteProgram(program);
-            program = glCreateProgram();
-        }
-    }
-
-    // Compile and link if cache failed
-    glAttachShader(program, vertex_shader);
-    glAttachShader(program, fragment_shader);
-    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
-    glLinkProgram(program);
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-
-    if (!success) {
-        GLint logLength;
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
-        char* log = (char*)malloc(logLength);
-        glGetProgramInfoLog(program, logLength, &logLength, log);
-        printf("Program link error: %s\n", log);
-        free(log);
-        return program;
-    }
-
-    GLint binaryLength;
-    GLenum binaryFormat;
-    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binaryLength);
-    void* binary = malloc(binaryLength);
-    glGetProgramBinary(program, binaryLength, NULL, &binaryFormat, binary);
-
-    mkdir("/mnt/SDCARD/.shadercache", 0755); 
-    f = fopen(cache_path, "wb");
-    if (f) {
-        fwrite(&binaryFormat, sizeof(GLenum), 1, f);
-        fwrite(binary, 1, binaryLength, f);
-        fclose(f);
-        LOG_info("Saved shader program to cache: %s\n", cache_key);
-    }
-    free(binary);
-
-    LOG_info("Program linked and cached\n");
-    return program;
-}
-
 char* load_shader_source(const char* filename) {
 	char filepath[256];
 	snprintf(filepath, sizeof(filepath), "%s", filename);
@@ -314,11 +247,12 @@ char* load_shader_source(const char* filename) {
     return source;
 }
 
-GLuint load_shader_from_file(GLenum type, const char* filename, const char* path) {
+// returns the source as it will be compiled, caller must free
+char* prepare_shader_source(GLenum type, const char* filename, const char* path) {
     char filepath[256];
     snprintf(filepath, sizeof(filepath), "%s/%s", path, filename);
     char* source = load_shader_source(filepath);
-    if (!source) return 0;
+    if (!source) return NULL;
 
     LOG_info("load shader from file %s\n", filepath);
 
@@ -331,13 +265,14 @@ GLuint load_shader_from_file(GLenum type, const char* filename, const char* path
     }
     cleaned[0] = '\0';
 
+    size_t capacity = strlen(source) + 1; // strtok cuts source up as it goes
     char* line = strtok(source, "\n");
     while (line) {
         if (strncmp(line, "#pragma parameter", 17) != 0) {
             size_t cleaned_len = strlen(cleaned);
             size_t line_len = strlen(line);
-            size_t remaining = strlen(source) - cleaned_len;
-            if (cleaned_len + line_len + 2 < strlen(source) + 1) {
+            size_t remaining = capacity - cleaned_len;
+            if (cleaned_len + line_len + 2 <= capacity) {
                 strncat(cleaned, line, remaining - 1);
                 strncat(cleaned, "\n", remaining - 1);
             }
@@ -458,14 +393,15 @@ GLuint load_shader_from_file(GLenum type, const char* filename, const char* path
         strncat(combined, cleaned, combined_len - strlen(combined) - 1);
     }
 
-    GLuint shader = glCreateShader(type);
-    const char* combined_ptr = combined;
-    glShaderSource(shader, 1, &combined_ptr, NULL);
-    glCompileShader(shader);
-
     free(source);
     free(cleaned);
-    free(combined);
+    return combined;
+}
+
+GLuint compile_shader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
 
     GLint compiled;
     glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
@@ -480,26 +416,729 @@ GLuint load_shader_from_file(GLenum type, const char* filename, const char* path
     return shader;
 }
 
-void PLAT_initShaders() {
-	SDL_GL_MakeCurrent(vid.window, vid.gl_context);
-	glViewport(0, 0, device_width, device_height);
+GLuint load_shader_from_file(GLenum type, const char* filename, const char* path) {
+    char* source = prepare_shader_source(type, filename, path);
+    if (!source) return 0;
+    GLuint shader = compile_shader(type, source);
+    free(source);
+    return shader;
+}
+
+///////////////////////////////
+// shader cache
+
+// linked program binaries, named by a hash of both preprocessed sources and
+// the driver identity so an edited shader or a driver update simply misses.
+// entries carry a checksum and are deleted when they fail to validate or link.
+// the render thread and the shader compiler both use it, lock covers the
+// directory, the counters and the driver hash
+#define SHADER_CACHE_DIR SDCARD_PATH "/.shadercache"
+#define SHADER_CACHE_MAGIC "NXSHBIN"
+#define SHADER_CACHE_VERSION 1
+#define SHADER_CACHE_MAX_SIZE (16 * 1024 * 1024)
+
+typedef struct ShaderCacheHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t format; // GLenum binaryFormat
+	uint32_t length;
+	uint32_t checksum; // of the binary
+	uint64_t key; // must match the filename
+	uint32_t cost; // us it took to compile and link
+	uint32_t reserved;
+} ShaderCacheHeader;
+
+static struct {
+	SDL_mutex* lock;
+	uint64_t driver; // hash of the gl driver identity
+	off_t total; // bytes on disk, -1 until the first eviction pass counts them
+	int hits;
+	int misses;
+	int rejected;
+	int evicted;
+	uint64_t saved; // us of compiling avoided
+	uint64_t spent; // us spent compiling on misses
+} shader_cache;
+
+static uint64_t ShaderCache_hash(uint64_t hash, const char* str) { // fnv-1a
+	if (!str) str = "";
+	while (*str) {
+		hash ^= (uint8_t)*str++;
+		hash *= 1099511628211ull;
+	}
+	hash ^= 0xff; // so ("ab","c") != ("a","bc")
+	hash *= 1099511628211ull;
+	return hash;
+}
+static uint32_t ShaderCache_checksum(const void* data, size_t size) {
+	const uint8_t* bytes = data;
+	uint32_t hash = 2166136261u;
+	for (size_t i=0; i<size; i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+static uint64_t ShaderCache_key(const char* vertex_source, const char* fragment_source) {
+	SDL_LockMutex(shader_cache.lock);
+	if (!shader_cache.driver) {
+		uint64_t driver = 14695981039346656037ull;
+		driver = ShaderCache_hash(driver, (const char*)glGetString(GL_VENDOR));
+		driver = ShaderCache_hash(driver, (const char*)glGetString(GL_RENDERER));
+		driver = ShaderCache_hash(driver, (const char*)glGetString(GL_VERSION));
+		driver = ShaderCache_hash(driver, (const char*)glGetString(GL_SHADING_LANGUAGE_VERSION));
+		shader_cache.driver = driver;
+	}
+	uint64_t key = shader_cache.driver ^ SHADER_CACHE_VERSION;
+	SDL_UnlockMutex(shader_cache.lock);
+
+	key = ShaderCache_hash(key, vertex_source);
+	key = ShaderCache_hash(key, fragment_source);
+	return key;
+}
+static void ShaderCache_getPath(uint64_t key, char* path) {
+	snprintf(path, MAX_PATH, SHADER_CACHE_DIR "/%016llx.bin", (unsigned long long)key);
+}
+static int ShaderCache_has(uint64_t key) { // without validating it, that waits for a real load
+	char path[MAX_PATH];
+	ShaderCache_getPath(key, path);
+	return access(path, F_OK)==0;
+}
+static void ShaderCache_logStats(const char* label) { // lock held
+	int lookups = shader_cache.hits + shader_cache.misses;
+	LOG_info("shader cache: %s (%i/%i hits, %i rejected, %i evicted, saved %ims, compiled %ims)\n", label,
+		shader_cache.hits, lookups, shader_cache.rejected, shader_cache.evicted,
+		(int)(shader_cache.saved / 1000), (int)(shader_cache.spent / 1000));
+}
+
+static GLuint ShaderCache_load(uint64_t key) { // lock held
+	char path[MAX_PATH];
+	ShaderCache_getPath(key, path);
+	
+	FILE* file = fopen(path, "rb");
+	if (!file) return 0;
+	
+	uint64_t start = getMicroseconds();
+	ShaderCacheHeader header;
+	void* binary = NULL;
+	GLuint program = 0;
+	
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (fread(&header, sizeof(header), 1, file)!=1
+		|| memcmp(header.magic, SHADER_CACHE_MAGIC, sizeof(header.magic))
+		|| header.version!=SHADER_CACHE_VERSION
+		|| header.key!=key
+		|| header.length==0
+		|| size!=(long)(sizeof(header) + header.length)
+	) goto reject;
+	
+	binary = malloc(header.length);
+	if (!binary) goto reject;
+	if (fread(binary, 1, header.length, file)!=header.length) goto reject;
+	if (ShaderCache_checksum(binary, header.length)!=header.checksum) goto reject;
+	
+	program = glCreateProgram();
+	glProgramBinary(program, (GLenum)header.format, binary, header.length);
+	
+	GLint success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (!success) goto reject;
+	
+	fclose(file);
+	free(binary);
+	utimes(path, NULL); // most recently used
+	
+	uint64_t elapsed = getMicroseconds() - start;
+	shader_cache.hits += 1;
+	if (header.cost>elapsed) shader_cache.saved += header.cost - elapsed;
+	return program;
+
+reject:
+	fclose(file);
+	if (binary) free(binary);
+	if (program) glDeleteProgram(program);
+	unlink(path);
+	shader_cache.rejected += 1;
+	LOG_info("shader cache: dropped invalid entry %016llx\n", (unsigned long long)key);
+	return 0;
+}
+typedef struct ShaderCacheEntry {
+	time_t mtime;
+	off_t size;
+	char name[24]; // %016llx.bin
+} ShaderCacheEntry;
+static int ShaderCacheEntry_compare(const void* a, const void* b) { // oldest first
+	time_t at = ((const ShaderCacheEntry*)a)->mtime;
+	time_t bt = ((const ShaderCacheEntry*)b)->mtime;
+	return (at>bt) - (at<bt);
+}
+static void ShaderCache_evict(void) { // lock held
+	// the running total is only an estimate (a replaced entry counts twice)
+	// so going over just means it's time to look at the directory
+	if (shader_cache.total>=0 && shader_cache.total<=SHADER_CACHE_MAX_SIZE) return;
+	
+	DIR* dir = opendir(SHADER_CACHE_DIR);
+	if (!dir) return;
+	
+	// anything that isn't a finished entry is left over from a crash, even a .tmp
+	ShaderCacheEntry* entries = NULL;
+	int count = 0;
+	int capacity = 0;
+	off_t total = 0;
+	struct dirent* entry;
+	while ((entry = readdir(dir))) {
+		if (entry->d_name[0]=='.') continue;
+		
+		char path[MAX_PATH];
+		struct stat st;
+		snprintf(path, sizeof(path), SHADER_CACHE_DIR "/%s", entry->d_name);
+		if (stat(path, &st)!=0 || !S_ISREG(st.st_mode)) continue;
+		
+		// entries from before content addressing can never hit again
+		unsigned long long key;
+		char tail[8];
+		if (sscanf(entry->d_name, "%16llx%7s", &key, tail)!=2 || strcmp(tail, ".bin") || strlen(entry->d_name)!=20) {
+			unlink(path);
+			shader_cache.evicted += 1;
+			continue;
+		}
+		
+		if (count==capacity) {
+			int grown = capacity ? capacity * 2 : 64;
+			ShaderCacheEntry* tmp = realloc(entries, grown * sizeof(ShaderCacheEntry));
+			if (!tmp) break;
+			entries = tmp;
+			capacity = grown;
+		}
+		entries[count].mtime = st.st_mtime;
+		entries[count].size = st.st_size;
+		strcpy(entries[count].name, entry->d_name);
+		count += 1;
+		total += st.st_size;
+	}
+	closedir(dir);
+	
+	qsort(entries, count, sizeof(ShaderCacheEntry), ShaderCacheEntry_compare);
+	for (int i=0; i<count && total>SHADER_CACHE_MAX_SIZE; i++) {
+		char path[MAX_PATH];
+		snprintf(path, sizeof(path), SHADER_CACHE_DIR "/%s", entries[i].name);
+		if (unlink(path)!=0) continue;
+		total -= entries[i].size;
+		shader_cache.evicted += 1;
+	}
+	free(entries);
+	shader_cache.total = total;
+}
+static void ShaderCache_store(uint64_t key, GLuint program, uint64_t cost) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length<=0) return;
+	
+	void* binary = malloc(length);
+	if (!binary) return;
+	
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary);
+	
+	ShaderCacheHeader header = {0};
+	memcpy(header.magic, SHADER_CACHE_MAGIC, sizeof(header.magic));
+	header.version = SHADER_CACHE_VERSION;
+	header.format = format;
+	header.length = length;
+	header.checksum = ShaderCache_checksum(binary, length);
+	header.key = key;
+	header.cost = cost>UINT32_MAX ? UINT32_MAX : cost;
+	
+	char path[MAX_PATH];
+	char tmp_path[MAX_PATH];
+	ShaderCache_getPath(key, path);
+	getTempPath(path, tmp_path);
+	
+	SDL_LockMutex(shader_cache.lock);
+	mkdir(SHADER_CACHE_DIR, 0755);
+	FILE* file = fopen(tmp_path, "wb");
+	if (file) {
+		int ok = fwrite(&header, sizeof(header), 1, file)==1 && fwrite(binary, 1, length, file)==(size_t)length;
+		if (fclose(file)) ok = 0;
+		// a torn entry would just fail its checksum, no need to fsync
+		if (!ok || rename(tmp_path, path)) unlink(tmp_path);
+		else if (shader_cache.total>=0) shader_cache.total += sizeof(header) + length;
+	}
+	ShaderCache_evict();
+	SDL_UnlockMutex(shader_cache.lock);
+	free(binary);
+}
+
+// compiles only if the linked program isn't cached already
+GLuint link_program(const char* vertex_source, const char* fragment_source, const char* label) {
+	if (!vertex_source || !fragment_source) return 0;
+	
+	uint64_t key = ShaderCache_key(vertex_source, fragment_source);
+	SDL_LockMutex(shader_cache.lock);
+	GLuint program = ShaderCache_load(key);
+	if (program) ShaderCache_logStats(label);
+	else shader_cache.misses += 1;
+	SDL_UnlockMutex(shader_cache.lock);
+	if (program) return program;
+	
+	uint64_t start = getMicroseconds();
+	
+	GLuint vertex_shader = compile_shader(GL_VERTEX_SHADER, vertex_source);
+	GLuint fragment_shader = compile_shader(GL_FRAGMENT_SHADER, fragment_source);
+	
+	GLint success = 0;
+	program = glCreateProgram();
+	glAttachShader(program, vertex_shader);
+	glAttachShader(program, fragment_shader);
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	
+	// the program keeps what it needs
+	glDetachShader(program, vertex_shader);
+	glDetachShader(program, fragment_shader);
+	glDeleteShader(vertex_shader);
+	glDeleteShader(fragment_shader);
+
+	if (!success) {
+		GLint logLength = 0;
+		glGetProgramiv(program, GL_INFO_LOG_LENGTH, &logLength);
+		char* log = (char*)malloc(logLength + 1);
+		if (log) {
+			log[0] = '\0';
+			glGetProgramInfoLog(program, logLength + 1, NULL, log);
+			printf("Program link error: %s\n", log);
+			free(log);
+		}
+		return program;
+	}
+	
+	uint64_t cost = getMicroseconds() - start;
+	ShaderCache_store(key, program, cost);
+	SDL_LockMutex(shader_cache.lock);
+	shader_cache.spent += cost;
+	ShaderCache_logStats(label);
+	SDL_UnlockMutex(shader_cache.lock);
+	return program;
+}
+
+GLuint load_program_from_file(const char* filename, const char* path) {
+    char* vertex_source = prepare_shader_source(GL_VERTEX_SHADER, filename, path);
+    char* fragment_source = prepare_shader_source(GL_FRAGMENT_SHADER, filename, path);
+    GLuint program = link_program(vertex_source, fragment_source, filename);
+    free(vertex_source);
+    free(fragment_source);
+    return program;
+}
+
+// makes sure the cache has an entry, only building the program if it doesn't
+static int warm_program_from_file(const char* filename, const char* path) {
+	char* vertex_source = prepare_shader_source(GL_VERTEX_SHADER, filename, path);
+	char* fragment_source = prepare_shader_source(GL_FRAGMENT_SHADER, filename, path);
+	int built = 0;
+	if (vertex_source && fragment_source && !ShaderCache_has(ShaderCache_key(vertex_source, fragment_source))) {
+		GLuint program = link_program(vertex_source, fragment_source, filename);
+		if (program) glDeleteProgram(program);
+		built = 1;
+	}
+	free(vertex_source);
+	free(fragment_source);
+	return built;
+}
+
+///////////////////////////////
+// shader programs
+
+// everything runShaderPass needs from a program is looked up once, when the
+// program is adopted, along with a vao describing the shared quad for it
+// (and a flipped one if the program ever draws the last pass to the screen).
+// gl keeps uniform values per program so we shadow them per program too and
+// a pass only submits what changed since that program last drew
+
+#define SYSTEM_SHADER_PROGRAMS 8 // default, overlay, noshader, effect and lcd with room to spare
+#define PRESET_MAX_PASSES 8
+// the stock chain stays loaded while a preset runs
+#define MAX_SHADER_PROGRAMS (SYSTEM_SHADER_PROGRAMS + MAXSHADERS + PRESET_MAX_PASSES)
+
+typedef struct ShaderProgram {
+	GLuint program;
+	GLuint vao[2]; // upright, flipped
+	GLint u_MVPMatrix;
+	GLint u_FrameDirection;
+	GLint u_FrameCount;
+	GLint u_OutputSize;
+	GLint u_TextureSize;
+	GLint u_InputSize;
+	GLint u_OrigInputSize;
+	GLint u_Texture;
+	GLint u_texelSize;
+	
+	// last submitted values
+	int primed; // constants (mvp, direction, sampler) are set
+	int frame_count;
+	GLfloat output_size[2];
+	GLfloat texture_size[2];
+	GLfloat input_size[2];
+	GLfloat orig_input_size[2];
+	GLfloat texel_size[2];
+	GLfloat pragmas[MAX_SHADER_PRAGMAS];
+} ShaderProgram;
+
+static ShaderProgram programs[MAX_SHADER_PROGRAMS];
+static ShaderProgram no_program = { .u_MVPMatrix=-1, .u_FrameDirection=-1, .u_FrameCount=-1, .u_OutputSize=-1, .u_TextureSize=-1,
+	.u_InputSize=-1, .u_OrigInputSize=-1, .u_Texture=-1, .u_texelSize=-1, .primed=1 };
+static ShaderProgram* bound_program = NULL; // what runShaderPass last made current
+static GLint bound_vao = -1;
+static GLuint bound_texture = 0; // on unit 0
+static GLint bound_fbo = -1;
+static GLuint quad_vbo[2] = {0,0};
+
+// gl calls made drawing the current frame, published for the debug hud by PLAT_GL_Swap
+static struct {
+	int calls;
+	int uniforms;
+	int draws;
+} gl_stats;
+
+// flipped draws the quad upside down, doing g_shader_default's flip for a
+// pass that renders straight to the backbuffer
+static GLuint ShaderProgram_vao(ShaderProgram* info, int flipped) {
+	if (info->vao[flipped] || !info->program) return info->vao[flipped];
+	
+	if (!quad_vbo[flipped]) {
+		float y = flipped ? -1.0f : 1.0f;
+		float vertices[] = {
+			// x,    y,    z,    w,     u,    v,    s,    t
+			-1.0f,  y, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, 0.0f,  // top-left
+			-1.0f, -y, 0.0f, 1.0f,  0.0f, 0.0f, 0.0f, 0.0f,  // bottom-left
+			1.0f,  y, 0.0f, 1.0f,  1.0f, 1.0f, 0.0f, 0.0f,  // top-right
+			1.0f, -y, 0.0f, 1.0f,  1.0f, 0.0f, 0.0f, 0.0f   // bottom-right
+		};
+		glGenBuffers(1, &quad_vbo[flipped]);
+		glBindBuffer(GL_ARRAY_BUFFER, quad_vbo[flipped]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+	}
+	
+	glGenVertexArrays(1, &info->vao[flipped]);
+	glBindVertexArray(info->vao[flipped]);
+	glBindBuffer(GL_ARRAY_BUFFER, quad_vbo[flipped]);
+	GLint posAttrib = glGetAttribLocation(info->program, "VertexCoord");
+	if (posAttrib >= 0) {
+		glVertexAttribPointer(posAttrib, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(posAttrib);
+	}
+	GLint texAttrib = glGetAttribLocation(info->program, "TexCoord");
+	if (texAttrib >= 0) {
+		glVertexAttribPointer(texAttrib,  4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float)));
+		glEnableVertexAttribArray(texAttrib);
+	}
+	bound_vao = info->vao[flipped];
+	
+	return info->vao[flipped];
+}
+static ShaderProgram* ShaderProgram_get(GLuint program) {
+	if (!program) return &no_program; // failed to build, draws nothing
+	
+	ShaderProgram* info = NULL;
+	for (int i=0; i<MAX_SHADER_PROGRAMS; i++) {
+		if (programs[i].program==program) return &programs[i];
+		if (!info && !programs[i].program) info = &programs[i];
+	}
+	if (!info) {
+		// programs are forgotten as they're deleted so this means a leak somewhere
+		LOG_error("ShaderProgram: no room for program %i\n", program);
+		return &no_program;
+	}
+	
+	info->program = program;
+	info->u_MVPMatrix = glGetUniformLocation(program, "MVPMatrix");
+	info->u_FrameDirection = glGetUniformLocation(program, "FrameDirection");
+	info->u_FrameCount = glGetUniformLocation(program, "FrameCount");
+	info->u_OutputSize = glGetUniformLocation(program, "OutputSize");
+	info->u_TextureSize = glGetUniformLocation(program, "TextureSize");
+	info->u_InputSize = glGetUniformLocation(program, "InputSize");
+	info->u_OrigInputSize = glGetUniformLocation(program, "OrigInputSize");
+	info->u_Texture = glGetUniformLocation(program, "Texture");
+	info->u_texelSize = glGetUniformLocation(program, "texelSize");
+	
+	// nothing submitted yet, NAN never compares equal
+	info->primed = 0;
+	info->frame_count = -1;
+	GLfloat* values[] = { info->output_size, info->texture_size, info->input_size, info->orig_input_size, info->texel_size };
+	for (int i=0; i<5; i++) values[i][0] = values[i][1] = NAN;
+	for (int i=0; i<MAX_SHADER_PRAGMAS; i++) info->pragmas[i] = NAN;
+	
+	ShaderProgram_vao(info, 0);
+	
+	return info;
+}
+static void ShaderProgram_forget(GLuint program) {
+	if (!program) return;
+	for (int i=0; i<MAX_SHADER_PROGRAMS; i++) {
+		ShaderProgram* info = &programs[i];
+		if (info->program!=program) continue;
+		
+		for (int j=0; j<2; j++) {
+			if (info->vao[j]) glDeleteVertexArrays(1, &info->vao[j]);
+		}
+		memset(info, 0, sizeof(ShaderProgram));
+		bound_program = NULL; // gl may hand the same names out again
+		bound_vao = -1;
+		break;
+	}
+}
+
+static void ShaderProgram_uniform2f(GLint location, GLfloat* last, GLfloat x, GLfloat y) {
+	if (location<0 || (last[0]==x && last[1]==y)) return;
+	glUniform2f(location, x, y);
+	last[0] = x;
+	last[1] = y;
+	gl_stats.uniforms += 1;
+}
+
+///////////////////////////////
+// shader compiler
+
+// programs picked in the menu or by a preset are built on a worker with its
+// own context sharing objects with vid.gl_context. the pass keeps drawing
+// with its previous program until the new one is adopted in PLAT_GL_Swap,
+// and the previous chain or preset keeps drawing until every pass of a new
+// preset is. warm-up jobs only exist to fill the binary cache and run
+// behind real ones
+typedef struct ShaderJob {
+	int pass; // -1 to just warm the cache
+	int preset; // pass is one of the preset being built, not of the chain
+	int generation;
+	char filename[MAX_PATH];
+	char dir[MAX_PATH];
+	GLuint program;
+	struct ShaderJob* next;
+} ShaderJob;
+
+static struct {
+	SDL_GLContext context;
+	SDL_Thread* thread;
+	SDL_mutex* lock;
+	SDL_cond* wake;
+	ShaderJob* queue;
+	ShaderJob* done;
+	int generation[MAXSHADERS]; // newest request per pass, older results are discarded
+	int preset_generation; // of the preset being built, passes of older ones are discarded
+	int enabled; // 0 if the driver won't give us a second context
+	int quit;
+} compiler;
+
+static void Shader_adopt(Shader* shader, GLuint program, const char* filename) {
+	if (shader->shader_p != 0) {
+		LOG_info("Deleting previous shader %i\n",shader->shader_p);
+		ShaderProgram_forget(shader->shader_p);
+		glDeleteProgram(shader->shader_p);
+	}
+	shader->shader_p = program;
+	ShaderProgram_get(shader->shader_p);
+	
+	for (int i = 0; i < shader->num_pragmas; ++i) {
+		shader->pragmas[i].uniformLocation = glGetUniformLocation(shader->shader_p, shader->pragmas[i].name);
+	}
 	
-	GLuint vertex;
-	GLuint fragment;
+	GLint success = 0;
+	if (shader->shader_p) glGetProgramiv(shader->shader_p, GL_LINK_STATUS, &success);
+	if (!success) {
+		LOG_info("Shader linking failed for %s\n", filename);
+	} else {
+		LOG_info("Shader Program Linking Success %s shader ID is %i\n", filename,shader->shader_p);
+	}
+}
 
-	vertex = load_shader_from_file(GL_VERTEX_SHADER, "default.glsl",SYSSHADERS_FOLDER);
-	fragment = load_shader_from_file(GL_FRAGMENT_SHADER, "default.glsl",SYSSHADERS_FOLDER);
-	g_shader_default = link_program(vertex, fragment,"defaultv2.glsl");
+static int ShaderCompiler_thread(void* data) {
+	// no surface, we only ever build programs here
+	int ready = SDL_GL_MakeCurrent(NULL, compiler.context)==0;
+	
+	SDL_LockMutex(compiler.lock);
+	compiler.enabled = ready;
+	SDL_CondSignal(compiler.wake);
+	if (!ready) {
+		LOG_info("ShaderCompiler: no surfaceless context (%s), compiling on the render thread\n", SDL_GetError());
+		SDL_UnlockMutex(compiler.lock);
+		return 0;
+	}
+	
+	while (1) {
+		while (!compiler.queue && !compiler.quit) SDL_CondWait(compiler.wake, compiler.lock);
+		if (compiler.quit) break;
+		
+		ShaderJob* job = compiler.queue;
+		compiler.queue = job->next;
+		int stale = job->preset ? job->generation!=compiler.preset_generation : job->pass>=0 && job->generation!=compiler.generation[job->pass];
+		SDL_UnlockMutex(compiler.lock);
+		
+		if (job->pass<0) {
+			uint64_t start = getMicroseconds();
+			if (warm_program_from_file(job->filename, job->dir)) {
+				LOG_info("ShaderCompiler: warmed %s in %ims\n", job->filename, (int)((getMicroseconds() - start) / 1000));
+			}
+		}
+		else if (!stale) {
+			uint64_t start = getMicroseconds();
+			job->program = load_program_from_file(job->filename, job->dir);
+			glFinish(); // must be complete before the render context touches it
+			LOG_info("ShaderCompiler: built %s in %ims\n", job->filename, (int)((getMicroseconds() - start) / 1000));
+		}
+		
+		SDL_LockMutex(compiler.lock);
+		if (job->pass>=0 && !stale) {
+			job->next = compiler.done;
+			compiler.done = job;
+		}
+		else free(job);
+	}
+	SDL_UnlockMutex(compiler.lock);
+	
+	SDL_GL_MakeCurrent(NULL, NULL);
+	return 0;
+}
+static void ShaderCompiler_init(void) {
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+	compiler.context = SDL_GL_CreateContext(vid.window);
+	SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+	SDL_GL_MakeCurrent(vid.window, vid.gl_context); // creating it made it current
+	if (!compiler.context) {
+		LOG_info("ShaderCompiler: no shared context (%s), compiling on the render thread\n", SDL_GetError());
+		return;
+	}
+	
+	compiler.lock = SDL_CreateMutex();
+	compiler.wake = SDL_CreateCond();
+	
+	// wait to hear whether the worker could use the context
+	SDL_LockMutex(compiler.lock);
+	compiler.enabled = -1;
+	compiler.thread = SDL_CreateThread(ShaderCompiler_thread, "ShaderCompiler", NULL);
+	if (compiler.thread) {
+		while (compiler.enabled<0) SDL_CondWait(compiler.wake, compiler.lock);
+	}
+	else compiler.enabled = 0;
+	SDL_UnlockMutex(compiler.lock);
+	
+	if (!compiler.enabled) {
+		if (compiler.thread) SDL_WaitThread(compiler.thread, NULL);
+		compiler.thread = NULL;
+		SDL_GL_DeleteContext(compiler.context);
+		compiler.context = NULL;
+	}
+}
+static int ShaderCompiler_submit(int pass, int preset, const char* filename, const char* dir) {
+	if (!compiler.enabled) return 0;
+	
+	ShaderJob* job = calloc(1, sizeof(ShaderJob));
+	if (!job) return 0;
+	job->pass = pass;
+	job->preset = preset;
+	snprintf(job->filename, sizeof(job->filename), "%s", filename);
+	snprintf(job->dir, sizeof(job->dir), "%s", dir);
+	
+	SDL_LockMutex(compiler.lock);
+	if (pass>=0) {
+		// passes jump ahead of any warm-ups
+		job->generation = preset ? compiler.preset_generation : ++compiler.generation[pass];
+		ShaderJob** tail = &compiler.queue;
+		while (*tail && (*tail)->pass>=0) tail = &(*tail)->next;
+		job->next = *tail;
+		*tail = job;
+	}
+	else {
+		ShaderJob** tail = &compiler.queue;
+		while (*tail) tail = &(*tail)->next;
+		*tail = job;
+	}
+	SDL_CondSignal(compiler.wake);
+	SDL_UnlockMutex(compiler.lock);
+	return 1;
+}
+static void ShaderCompiler_discardPreset(void) { // whatever is still building for the previous preset
+	if (!compiler.enabled) return;
+	
+	SDL_LockMutex(compiler.lock);
+	compiler.preset_generation += 1;
+	SDL_UnlockMutex(compiler.lock);
+}
+static void Preset_adoptPass(int pass, GLuint program, const char* filename);
+static void ShaderCompiler_poll(void) { // render thread
+	if (!compiler.enabled) return;
+	
+	SDL_LockMutex(compiler.lock);
+	ShaderJob* done = compiler.done;
+	compiler.done = NULL;
+	int generation[MAXSHADERS];
+	memcpy(generation, compiler.generation, sizeof(generation));
+	int preset_generation = compiler.preset_generation;
+	SDL_UnlockMutex(compiler.lock);
+	
+	while (done) {
+		ShaderJob* job = done;
+		done = job->next;
+		if (job->preset && job->generation==preset_generation) Preset_adoptPass(job->pass, job->program, job->filename);
+		else if (!job->preset && job->generation==generation[job->pass]) Shader_adopt(shaders[job->pass], job->program, job->filename);
+		else if (job->program) glDeleteProgram(job->program);
+		free(job);
+	}
+}
+static void ShaderCompiler_quit(void) {
+	if (!compiler.enabled) return;
+	
+	SDL_LockMutex(compiler.lock);
+	compiler.quit = 1;
+	SDL_CondSignal(compiler.wake);
+	SDL_UnlockMutex(compiler.lock);
+	SDL_WaitThread(compiler.thread, NULL);
+	
+	ShaderJob* lists[] = {compiler.queue, compiler.done};
+	for (int i=0; i<2; i++) {
+		while (lists[i]) {
+			ShaderJob* job = lists[i];
+			lists[i] = job->next;
+			if (job->program) glDeleteProgram(job->program);
+			free(job);
+		}
+	}
+	SDL_GL_DeleteContext(compiler.context);
+	SDL_DestroyCond(compiler.wake);
+	SDL_DestroyMutex(compiler.lock);
+	memset(&compiler, 0, sizeof(compiler));
+}
 
-	vertex = load_shader_from_file(GL_VERTEX_SHADER, "overlay.glsl",SYSSHADERS_FOLDER);
-	fragment = load_shader_from_file(GL_FRAGMENT_SHADER, "overlay.glsl",SYSSHADERS_FOLDER);
-	g_shader_overlay = link_program(vertex, fragment,"overlay.glsl");
+static void Preset_warm(const char* path);
+void PLAT_warmShader(const char* filename) {
+	if (!filename || !*filename) return;
+	if (suffixMatch(".glslp", filename)) Preset_warm(filename);
+	else ShaderCompiler_submit(-1, 0, filename, SHADERS_FOLDER "/glsl");
+}
 
-	vertex = load_shader_from_file(GL_VERTEX_SHADER, "noshader.glsl",SYSSHADERS_FOLDER);
-	fragment = load_shader_from_file(GL_FRAGMENT_SHADER, "noshader.glsl",SYSSHADERS_FOLDER);
-	g_noshader = link_program(vertex, fragment,"noshader.glsl");
+void PLAT_initShaders() {
+	SDL_GL_MakeCurrent(vid.window, vid.gl_context);
+	glViewport(0, 0, device_width, device_height);
+	
+	if (!shader_cache.lock) {
+		shader_cache.lock = SDL_CreateMutex(); // before the compiler exists
+		shader_cache.total = -1; // counted by the first store, hits never need to
+	}
+	
+	g_shader_default = load_program_from_file("default.glsl",SYSSHADERS_FOLDER);
+	g_shader_overlay = load_program_from_file("overlay.glsl",SYSSHADERS_FOLDER);
+	g_noshader = load_program_from_file("noshader.glsl",SYSSHADERS_FOLDER);
+	g_shader_effect = load_program_from_file("effect.glsl",SYSSHADERS_FOLDER);
+	g_shader_lcd = load_program_from_file("lcd.glsl",SYSSHADERS_FOLDER);
+	ShaderProgram_get(g_shader_default);
+	ShaderProgram_get(g_shader_overlay);
+	ShaderProgram_get(g_noshader);
+	ShaderProgram_get(g_shader_effect);
+	ShaderProgram_get(g_shader_lcd);
 	
 	LOG_info("default shaders loaded, %i\n\n",g_shader_default);
+	
+	ShaderCompiler_init();
 }
 
 
@@ -647,7 +1286,6 @@ char* PLAT_findFileInDir(const char *directory, const char *filename) {
     return NULL;
 }
 
-#define MAX_SHADER_PRAGMAS 32
 void loadShaderPragmas(Shader *shader, const char *shaderSource) {
 	shader->pragmas = calloc(MAX_SHADER_PRAGMAS, sizeof(ShaderParam));
 	if (!shader->pragmas) {
@@ -674,51 +1312,25 @@ void PLAT_updateShader(int i, const char *filename, int *scale, int *filter, int
 
 		char filepath[512];
 		snprintf(filepath, sizeof(filepath), SHADERS_FOLDER "/glsl/%s",filename);
-		const char *shaderSource  = load_shader_source(filepath);
+		char *shaderSource  = load_shader_source(filepath);
 		loadShaderPragmas(shader,shaderSource);
-
-		GLuint vertex_shader1 = load_shader_from_file(GL_VERTEX_SHADER, filename,SHADERS_FOLDER "/glsl");
-		GLuint fragment_shader1 = load_shader_from_file(GL_FRAGMENT_SHADER, filename,SHADERS_FOLDER "/glsl");
-			
-        // Link the shader program
-		if (shader->shader_p != 0) {
-			LOG_info("Deleting previous shader %i\n",shader->shader_p);
-			glDeleteProgram(shader->shader_p);
-		}
-        shader->shader_p = link_program(vertex_shader1, fragment_shader1,filename);
-        
-		shader->u_FrameDirection = glGetUniformLocation( shader->shader_p, "FrameDirection");
-		shader->u_FrameCount = glGetUniformLocation( shader->shader_p, "FrameCount");
-		shader->u_OutputSize = glGetUniformLocation( shader->shader_p, "OutputSize");
-		shader->u_TextureSize = glGetUniformLocation( shader->shader_p, "TextureSize");
-		shader->u_InputSize = glGetUniformLocation( shader->shader_p, "InputSize");
-		shader->OrigInputSize = glGetUniformLocation( shader->shader_p, "OrigInputSize");
-		shader->texLocation = glGetUniformLocation(shader->shader_p, "Texture");
-		shader->texelSizeLocation = glGetUniformLocation(shader->shader_p, "texelSize");
-		for (int i = 0; i < shader->num_pragmas; ++i) {
-			shader->pragmas[i].uniformLocation = glGetUniformLocation(shader->shader_p, shader->pragmas[i].name);
-			shader->pragmas[i].value = shader->pragmas[i].def;
+		free(shaderSource);
+		
+		for (int j = 0; j < shader->num_pragmas; ++j) {
+			shader->pragmas[j].value = shader->pragmas[j].def;
+			shader->pragmas[j].uniformLocation = -1; // until the program that has them is adopted
 
 			printf("Param: %s = %f (min: %f, max: %f, step: %f)\n",
-				shader->pragmas[i].name,
-				shader->pragmas[i].def,
-				shader->pragmas[i].min,
-				shader->pragmas[i].max,
-				shader->pragmas[i].step);
+				shader->pragmas[j].name,
+				shader->pragmas[j].def,
+				shader->pragmas[j].min,
+				shader->pragmas[j].max,
+				shader->pragmas[j].step);
 		}
-
-        if (shader->shader_p == 0) {
-            LOG_info("Shader linking failed for %s\n", filename);
-        }
-
-        GLint success = 0;
-        glGetProgramiv(shader->shader_p, GL_LINK_STATUS, &success);
-        if (!success) {
-            char infoLog[512];
-            glGetProgramInfoLog(shader->shader_p, 512, NULL, infoLog);
-            LOG_info("Shader Program Linking Failed: %s\n", infoLog);
-        } else {
-			LOG_info("Shader Program Linking Success %s shader ID is %i\n", filename,shader->shader_p);
+		
+		// keeps drawing with the current program until the new one is ready
+		if (!ShaderCompiler_submit(i, 0, filename, SHADERS_FOLDER "/glsl")) {
+			Shader_adopt(shader, load_program_from_file(filename,SHADERS_FOLDER "/glsl"), filename);
 		}
 		shader->filename = strdup(filename);
     }
@@ -736,7 +1348,7 @@ void PLAT_updateShader(int i, const char *filename, int *scale, int *filter, int
         shader->filter = (*filter == 1) ? GL_LINEAR : GL_NEAREST;
 		reloadShaderTextures = 1;
     }
-	shader->updated = 1;
+	reloadShaderTextures = 1;
 
 }
 
@@ -817,7 +1429,11 @@ static void clearVideo(void) {
 void PLAT_quitVideo(void) {
 	clearVideo();
 
-
+	ShaderCompiler_quit();
+	FramePrep_quit();
+	TextTexture_freeAll();
+	LayerTexture_freeAll();
+	PLAT_setFrameTimings(0);
 	glFinish();
 	SDL_GL_DeleteContext(vid.gl_context);
 	SDL_FreeSurface(vid.screen);
@@ -830,7 +1446,6 @@ void PLAT_quitVideo(void) {
 	if (vid.target_layer2) SDL_DestroyTexture(vid.target_layer2);
 	if (vid.target_layer4) SDL_DestroyTexture(vid.target_layer4);
 	if (vid.target_layer5) SDL_DestroyTexture(vid.target_layer5);
-	if (overlay_path) free(overlay_path);
 	SDL_DestroyTexture(vid.stream_layer1);
 	SDL_DestroyRenderer(vid.renderer);
 	SDL_DestroyWindow(vid.window);
@@ -913,21 +1528,11 @@ void PLAT_setSharpness(int sharpness) {
 }
 
 static struct FX_Context {
-	int scale;
 	int type;
-	int color;
-	int next_scale;
-	int next_type;
-	int next_color;
-	int live_type;
+	int color; // rgb565, 0 for black
 } effect = {
-	.scale = 1,
-	.next_scale = 1,
 	.type = EFFECT_NONE,
-	.next_type = EFFECT_NONE,
-	.live_type = EFFECT_NONE,
 	.color = 0,
-	.next_color = 0,
 };
 static void rgb565_to_rgb888(uint32_t rgb565, uint8_t *r, uint8_t *g, uint8_t *b) {
     // Extract the red component (5 bits)
@@ -942,75 +1547,185 @@ static void rgb565_to_rgb888(uint32_t rgb565, uint8_t *r, uint8_t *g, uint8_t *b
     *g = (green << 2) | (green >> 4);
     *b = (blue << 3) | (blue >> 2);
 }
-static char* effect_path;
-static int effectUpdated = 0;
-static void updateEffect(void) {
-	if (effect.next_scale==effect.scale && effect.next_type==effect.type && effect.next_color==effect.color) return; // unchanged
+
+///////////////////////////////
+// frame preparation
+
+// overlay pngs are decoded on a worker that sleeps until the overlay actually
+// changes. decoded surfaces stay in a small cache keyed by path and target
+// size, so switching back to something used recently skips the sd card and
+// the png decode. PLAT_GL_Swap only ever uploads what it's handed
+
+#define PREP_CACHE_SLOTS 8
+#define PREP_CACHE_BUDGET (24 * 1024 * 1024) // decoded bytes kept around
+
+typedef struct PrepImage {
+	char path[MAX_PATH];
+	int target_w; // output it was decoded for
+	int target_h;
+	SDL_Surface* surface; // RGBA32, NULL for an empty slot
+	int refs; // handed to the render thread and not uploaded yet
+	uint32_t last_used;
+} PrepImage;
+
+static struct {
+	SDL_Thread* thread;
+	SDL_mutex* lock;
+	SDL_cond* wake;
+	int dirty; // overlay_path changed since the worker looked
+	int quit;
 	
-	int live_scale = effect.scale;
-	int live_color = effect.color;
-	effect.scale = effect.next_scale;
-	effect.type = effect.next_type;
-	effect.color = effect.next_color;
+	PrepImage images[PREP_CACHE_SLOTS];
+	int bytes;
+	uint32_t tick;
+	int hits;
+	int misses;
+	int evictions;
 	
-	if (effect.type==EFFECT_NONE) return; // disabled
-	if (effect.type==effect.live_type && effect.scale==live_scale && effect.color==live_color) return; // already loaded
+	// waiting for PLAT_GL_Swap, a NULL image clears the overlay
+	PrepImage* overlay;
+	int overlay_ready;
+} prep;
+
+static int PrepImage_bytes(PrepImage* image) {
+	return image->surface->pitch * image->surface->h;
+}
+static void PrepImage_evict(PrepImage* image) {
+	prep.bytes -= PrepImage_bytes(image);
+	prep.evictions += 1;
+	SDL_FreeSurface(image->surface);
+	memset(image, 0, sizeof(PrepImage));
+}
+static void PrepImage_release(PrepImage* image) { // with prep.lock held
+	if (image) image->refs -= 1;
+}
+
+// worker only, so a miss can't be decoded twice
+static PrepImage* PrepImage_acquire(const char* path) {
+	int target_w = device_width;
+	int target_h = device_height;
 	
-	int opacity = 128; // 1 - 1/2 = 50%
-	if (effect.type==EFFECT_LINE) {
-		if (effect.scale<3) {
-			effect_path = RES_PATH "/line-2.png";
-		}
-		else if (effect.scale<4) {
-			effect_path = RES_PATH "/line-3.png";
-		}
-		else if (effect.scale<5) {
-			effect_path = RES_PATH "/line-4.png";
-		}
-		else if (effect.scale<6) {
-			effect_path = RES_PATH "/line-5.png";
-		}
-		else if (effect.scale<8) {
-			effect_path = RES_PATH "/line-6.png";
-		}
-		else {
-			effect_path = RES_PATH "/line-8.png";
-		}
+	SDL_LockMutex(prep.lock);
+	for (int i=0; i<PREP_CACHE_SLOTS; i++) {
+		PrepImage* image = &prep.images[i];
+		if (!image->surface || image->target_w!=target_w || image->target_h!=target_h || !exactMatch(image->path, path)) continue;
+		image->refs += 1;
+		image->last_used = ++prep.tick;
+		prep.hits += 1;
+		SDL_UnlockMutex(prep.lock);
+		return image;
 	}
-	else if (effect.type==EFFECT_GRID) {
-		if (effect.scale<3) {
-			effect_path = RES_PATH "/grid-2.png";
-			opacity = 64; // 1 - 3/4 = 25%
-		}
-		else if (effect.scale<4) {
-			effect_path = RES_PATH "/grid-3.png";
-			opacity = 112; // 1 - 5/9 = ~44%
-		}
-		else if (effect.scale<5) {
-			effect_path = RES_PATH "/grid-4.png";
-			opacity = 144; // 1 - 7/16 = ~56%
-		}
-		else if (effect.scale<6) {
-			effect_path = RES_PATH "/grid-5.png";
-			opacity = 160; // 1 - 9/25 = ~64%
-			// opacity = 96; // TODO: tmp, for white grid
-		}
-		else if (effect.scale<8) {
-			effect_path = RES_PATH "/grid-6.png";
-			opacity = 112; // 1 - 5/9 = ~44%
+	prep.misses += 1;
+	SDL_UnlockMutex(prep.lock);
+	
+	uint64_t start = getMicroseconds();
+	SDL_Surface* tmp = IMG_Load(path);
+	SDL_Surface* surface = tmp ? SDL_ConvertSurfaceFormat(tmp, SDL_PIXELFORMAT_RGBA32, 0) : NULL;
+	if (tmp) SDL_FreeSurface(tmp);
+	if (!surface) {
+		LOG_error("FramePrep: couldn't load %s (%s)\n", path, SDL_GetError());
+		return NULL;
+	}
+	LOG_info("FramePrep: decoded %s in %ims\n", path, (int)((getMicroseconds() - start) / 1000));
+	
+	SDL_LockMutex(prep.lock);
+	// make room, oldest unreferenced first. a single image over budget is still kept
+	int bytes = surface->pitch * surface->h;
+	while (1) {
+		PrepImage* empty = NULL;
+		PrepImage* oldest = NULL;
+		for (int i=0; i<PREP_CACHE_SLOTS; i++) {
+			PrepImage* image = &prep.images[i];
+			if (!image->surface) {
+				if (!empty) empty = image;
+			}
+			else if (!image->refs && (!oldest || image->last_used<oldest->last_used)) oldest = image;
 		}
-		else if (effect.scale<11) {
-			effect_path = RES_PATH "/grid-8.png";
-			opacity = 144; // 1 - 7/16 = ~56%
+		if (empty && (prep.bytes + bytes<=PREP_CACHE_BUDGET || !oldest)) {
+			snprintf(empty->path, sizeof(empty->path), "%s", path);
+			empty->target_w = target_w;
+			empty->target_h = target_h;
+			empty->surface = surface;
+			empty->refs = 1;
+			empty->last_used = ++prep.tick;
+			prep.bytes += bytes;
+			SDL_UnlockMutex(prep.lock);
+			return empty;
 		}
-		else {
-			effect_path = RES_PATH "/grid-11.png";
-			opacity = 136; // 1 - 57/121 = ~52%
+		if (!oldest) break; // every slot is waiting on an upload
+		PrepImage_evict(oldest);
+	}
+	SDL_UnlockMutex(prep.lock);
+	SDL_FreeSurface(surface);
+	return NULL;
+}
+
+// replaces anything PLAT_GL_Swap hasn't picked up yet
+static void FramePrep_hand(PrepImage** pending, int* ready, PrepImage* image) { // with prep.lock held
+	if (*ready) PrepImage_release(*pending);
+	*pending = image;
+	*ready = 1;
+}
+
+static int FramePrep_thread(void* data) {
+	SDL_LockMutex(prep.lock);
+	while (1) {
+		while (!prep.dirty && !prep.quit) SDL_CondWait(prep.wake, prep.lock);
+		if (prep.quit) break;
+		prep.dirty = 0;
+		
+		int load_overlay = overlayUpdated;
+		char overlay_file[MAX_PATH];
+		snprintf(overlay_file, sizeof(overlay_file), "%s", overlay_path);
+		overlayUpdated = 0;
+		SDL_UnlockMutex(prep.lock);
+		
+		// decoding happens unlocked so setters never wait on the sd card
+		PrepImage* overlay_image = load_overlay && overlay_file[0] ? PrepImage_acquire(overlay_file) : NULL;
+		
+		SDL_LockMutex(prep.lock);
+		if (load_overlay) {
+			FramePrep_hand(&prep.overlay, &prep.overlay_ready, overlay_image);
+			LOG_info("FramePrep: overlay %s, cache %i hits %i misses %i evicted, %.1fMB\n",
+				overlay_file[0] ? overlay_file : "cleared",
+				prep.hits, prep.misses, prep.evictions, prep.bytes / (1024.0 * 1024.0));
 		}
 	}
-	effectUpdated = 1;
+	SDL_UnlockMutex(prep.lock);
+	return 0;
+}
+// setters and PLAT_GL_Swap all run on the main thread so this can be lazy
+static void FramePrep_init(void) {
+	if (prep.lock) return;
+	prep.lock = SDL_CreateMutex();
+	prep.wake = SDL_CreateCond();
+	prep.dirty = 1;
+	prep.thread = SDL_CreateThread(FramePrep_thread, "FramePrep", NULL);
+	if (!prep.thread) LOG_error("FramePrep: couldn't create thread: %s\n", SDL_GetError());
+}
+// call with prep.lock held after changing overlay_path
+static void FramePrep_signal(void) {
+	prep.dirty = 1;
+	SDL_CondSignal(prep.wake);
+}
+static void FramePrep_quit(void) {
+	if (!prep.lock) return;
 	
+	SDL_LockMutex(prep.lock);
+	prep.quit = 1;
+	SDL_CondSignal(prep.wake);
+	SDL_UnlockMutex(prep.lock);
+	if (prep.thread) SDL_WaitThread(prep.thread, NULL);
+	
+	LOG_info("FramePrep: %i hits %i misses %i evicted\n", prep.hits, prep.misses, prep.evictions);
+	for (int i=0; i<PREP_CACHE_SLOTS; i++) {
+		if (prep.images[i].surface) SDL_FreeSurface(prep.images[i].surface);
+	}
+	SDL_DestroyCond(prep.wake);
+	SDL_DestroyMutex(prep.lock);
+	memset(&prep, 0, sizeof(prep));
 }
+
 int screenx = 0;
 int screeny = 0;
 void PLAT_setOffsetX(int x) {
@@ -1023,32 +1738,25 @@ void PLAT_setOffsetY(int y) {
     screeny = y - 64; 
 	LOG_info("screeny: %i %i\n",screeny,y);
 }
-static int overlayUpdated=0;
 void PLAT_setOverlay(const char* filename, const char* tag) {
     if (vid.overlay) {
         SDL_DestroyTexture(vid.overlay);
         vid.overlay = NULL;
     }
-	overlay_path = NULL;
-	overlayUpdated=1;
-
-    if (!filename || strcmp(filename, "") == 0) {
-		overlay_path = strdup("");
-        printf("Skipping overlay update.\n");
-        return;
-    }
-
-    size_t path_len = strlen(OVERLAYS_FOLDER) + strlen(tag) + strlen(filename) + 4; // +3 for slashes and null-terminator
-    overlay_path = malloc(path_len);
-
-    if (!overlay_path) {
-        perror("malloc failed");
-        return;
-    }
-
-    snprintf(overlay_path, path_len, "%s/%s/%s", OVERLAYS_FOLDER, tag, filename);
-    printf("Overlay path set to: %s\n", overlay_path);
 
+	FramePrep_init();
+	SDL_LockMutex(prep.lock);
+	if (!filename || strcmp(filename, "") == 0) {
+		overlay_path[0] = '\0';
+		printf("Skipping overlay update.\n");
+	}
+	else {
+		snprintf(overlay_path, sizeof(overlay_path), "%s/%s/%s", OVERLAYS_FOLDER, tag, filename);
+		printf("Overlay path set to: %s\n", overlay_path);
+	}
+	overlayUpdated = 1;
+	FramePrep_signal();
+	SDL_UnlockMutex(prep.lock);
 }
 
 void applyRoundedCorners(SDL_Surface* surface, SDL_Rect* rect, int radius) {
@@ -1078,16 +1786,109 @@ void applyRoundedCorners(SDL_Surface* surface, SDL_Rect* rect, int radius) {
     }
 }
 
-void PLAT_clearLayers(int layer) {
-	if(layer==0 || layer==1) {
-		SDL_SetRenderTarget(vid.renderer, vid.target_layer1);
-		SDL_RenderClear(vid.renderer);
+///////////////////////////////
+// layer textures
+
+// PLAT_drawOnLayer keeps a few textures per layer instead of creating one on
+// every call. surfaces get a generation stamped into their userdata the first
+// time they're drawn, a freshly allocated surface has none so a reused
+// address can't alias an old texture. a hit skips the upload entirely, a
+// miss reuses the oldest slot's texture when the size matches
+
+#define LAYER_COUNT 5
+#define LAYER_SLOTS 2
+
+typedef struct LayerTexture {
+	SDL_Texture* texture;
+	uintptr_t generation; // of the surface last uploaded, 0 for an empty slot
+	int w;
+	int h;
+	uint32_t last_used;
+} LayerTexture;
+
+static struct {
+	LayerTexture slots[LAYER_COUNT][LAYER_SLOTS];
+	uintptr_t generation;
+	uint32_t tick;
+	LayerStats stats;
+} layers;
+
+static uintptr_t LayerTexture_generation(SDL_Surface* surface) {
+	if (!surface->userdata) surface->userdata = (void*)++layers.generation;
+	return (uintptr_t)surface->userdata;
+}
+
+static SDL_Texture* LayerTexture_get(SDL_Surface* surface, int layer) {
+	LayerTexture* slots = layers.slots[layer-1];
+	uintptr_t generation = LayerTexture_generation(surface);
+	layers.tick += 1;
+	
+	LayerTexture* slot = NULL;
+	for (int i=0; i<LAYER_SLOTS; i++) {
+		LayerTexture* candidate = &slots[i];
+		if (candidate->generation==generation && candidate->w==surface->w && candidate->h==surface->h) {
+			candidate->last_used = layers.tick;
+			layers.stats.hits += 1;
+			return candidate->texture;
+		}
+		if (!slot || candidate->last_used<slot->last_used) slot = candidate;
 	}
-	if(layer==0 || layer==2) {
-		SDL_SetRenderTarget(vid.renderer, vid.target_layer2);
-		SDL_RenderClear(vid.renderer);
+	
+	if (slot->texture && (slot->w!=surface->w || slot->h!=surface->h)) {
+		SDL_DestroyTexture(slot->texture);
+		slot->texture = NULL;
 	}
-	if(layer==0 || layer==3) {
+	if (!slot->texture) {
+		slot->texture = SDL_CreateTexture(vid.renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, surface->w, surface->h);
+		if (!slot->texture) {
+			printf("Failed to create layer texture: %s\n", SDL_GetError());
+			slot->generation = 0;
+			return NULL;
+		}
+		SDL_SetTextureBlendMode(slot->texture, SDL_BLENDMODE_BLEND);
+		slot->w = surface->w;
+		slot->h = surface->h;
+		layers.stats.created += 1;
+	}
+	SDL_UpdateTexture(slot->texture, NULL, surface->pixels, surface->pitch);
+	slot->generation = generation;
+	slot->last_used = layers.tick;
+	layers.stats.uploads += 1;
+	return slot->texture;
+}
+
+static void LayerTexture_freeAll(void) {
+	if (layers.stats.draws) {
+		LOG_info("Layers: %i draws, %i hits, %i uploads, %i textures created\n",
+			layers.stats.draws, layers.stats.hits, layers.stats.uploads, layers.stats.created);
+	}
+	for (int i=0; i<LAYER_COUNT; i++) {
+		for (int j=0; j<LAYER_SLOTS; j++) {
+			if (layers.slots[i][j].texture) SDL_DestroyTexture(layers.slots[i][j].texture);
+		}
+	}
+	uintptr_t generation = layers.generation; // surfaces may outlive the renderer
+	memset(&layers, 0, sizeof(layers));
+	layers.generation = generation;
+}
+
+void PLAT_surfaceChanged(SDL_Surface* surface) {
+	if (surface) surface->userdata = NULL;
+}
+void PLAT_getLayerStats(LayerStats* stats) {
+	*stats = layers.stats;
+}
+
+void PLAT_clearLayers(int layer) {
+	if(layer==0 || layer==1) {
+		SDL_SetRenderTarget(vid.renderer, vid.target_layer1);
+		SDL_RenderClear(vid.renderer);
+	}
+	if(layer==0 || layer==2) {
+		SDL_SetRenderTarget(vid.renderer, vid.target_layer2);
+		SDL_RenderClear(vid.renderer);
+	}
+	if(layer==0 || layer==3) {
 		SDL_SetRenderTarget(vid.renderer, vid.target_layer3);
 		SDL_RenderClear(vid.renderer);
 	}
@@ -1105,17 +1906,11 @@ void PLAT_clearLayers(int layer) {
 void PLAT_drawOnLayer(SDL_Surface *inputSurface, int x, int y, int w, int h, float brightness, bool maintainAspectRatio,int layer) {
     if (!inputSurface || !vid.target_layer1 || !vid.renderer) return; 
 
-    SDL_Texture* tempTexture = SDL_CreateTexture(vid.renderer,
-                                                 SDL_PIXELFORMAT_RGBA8888, 
-                                                 SDL_TEXTUREACCESS_TARGET,  
-                                                 inputSurface->w, inputSurface->h); 
-
-    if (!tempTexture) {
-        printf("Failed to create temporary texture: %s\n", SDL_GetError());
-        return;
-    }
+    if (layer<1 || layer>LAYER_COUNT) layer = 1;
+    layers.stats.draws += 1;
+    SDL_Texture* layerTexture = LayerTexture_get(inputSurface, layer);
+    if (!layerTexture) return;
 
-    SDL_UpdateTexture(tempTexture, NULL, inputSurface->pixels, inputSurface->pitch);
     switch (layer)
 	{
 	case 1:
@@ -1146,7 +1941,7 @@ void PLAT_drawOnLayer(SDL_Surface *inputSurface, int x, int y, int w, int h, flo
         r = g = b = 255;
     }
 
-    SDL_SetTextureColorMod(tempTexture, r, g, b);
+    SDL_SetTextureColorMod(layerTexture, r, g, b);
 
     // Aspect ratio handling
     SDL_Rect srcRect = { 0, 0, inputSurface->w, inputSurface->h }; 
@@ -1162,9 +1957,8 @@ void PLAT_drawOnLayer(SDL_Surface *inputSurface, int x, int y, int w, int h, flo
         }
     }
 
-    SDL_RenderCopy(vid.renderer, tempTexture, &srcRect, &dstRect);
+    SDL_RenderCopy(vid.renderer, layerTexture, &srcRect, &dstRect);
     SDL_SetRenderTarget(vid.renderer, NULL);
-    SDL_DestroyTexture(tempTexture);
 }
 
 
@@ -1230,6 +2024,96 @@ void PLAT_animateSurface(
 	SDL_DestroyTexture(tempTexture);
 }
 
+///////////////////////////////
+// text textures
+
+// scrolling titles are rasterized once into a texture holding two copies
+// side by side and then just windowed every frame. keyed on everything that
+// changes the pixels, the least recently drawn entry makes room for new ones
+
+#define TEXT_TEXTURE_COUNT 8
+
+typedef struct TextTexture {
+	SDL_Texture* texture; // NULL for an empty entry
+	TTF_Font* font;
+	char* text;
+	uint32_t color; // rgba of the text
+	uint32_t background;
+	int single_width; // of one copy, the second starts after the padding
+	int height;
+	uint32_t last_used;
+} TextTexture;
+
+static struct {
+	TextTexture entries[TEXT_TEXTURE_COUNT];
+	uint32_t tick;
+} text_textures;
+
+static void TextTexture_free(TextTexture* entry) {
+	if (entry->texture) SDL_DestroyTexture(entry->texture);
+	free(entry->text);
+	memset(entry, 0, sizeof(*entry));
+}
+
+static TextTexture* TextTexture_get(TTF_Font* font, const char* text, SDL_Color color, int padding) {
+	uint32_t rgba = (color.r << 24) | (color.g << 16) | (color.b << 8) | color.a;
+	uint32_t background = THEME_COLOR1;
+	text_textures.tick += 1;
+	
+	TextTexture* entry = NULL;
+	for (int i=0; i<TEXT_TEXTURE_COUNT; i++) {
+		TextTexture* candidate = &text_textures.entries[i];
+		if (candidate->texture && candidate->font==font && candidate->color==rgba && candidate->background==background && exactMatch(candidate->text, text)) {
+			candidate->last_used = text_textures.tick;
+			layers.stats.text_hits += 1;
+			return candidate;
+		}
+		if (!entry || !candidate->texture || (entry->texture && candidate->last_used<entry->last_used)) entry = candidate;
+	}
+	if (entry->texture) layers.stats.text_evictions += 1;
+	TextTexture_free(entry);
+	
+	SDL_Surface* single = TTF_RenderUTF8_Blended(font, text, color);
+	if (!single) return NULL;
+	layers.stats.text_rendered += 1;
+
+	// two copies side by side with padding so the window can wrap around
+	SDL_Surface* surface = SDL_CreateRGBSurfaceWithFormat(0, single->w * 2 + padding, single->h, 32, SDL_PIXELFORMAT_RGBA8888);
+	if (!surface) {
+		SDL_FreeSurface(single);
+		return NULL;
+	}
+	SDL_FillRect(surface, NULL, background);
+	SDL_BlitSurface(single, NULL, surface, NULL);
+	SDL_BlitSurface(single, NULL, surface, &(SDL_Rect){ single->w + padding, 0, single->w, single->h });
+
+	entry->texture = SDL_CreateTextureFromSurface(vid.renderer, surface);
+	entry->single_width = single->w;
+	entry->height = single->h;
+	SDL_FreeSurface(surface);
+	SDL_FreeSurface(single);
+	if (!entry->texture) return NULL;
+
+	SDL_SetTextureBlendMode(entry->texture, SDL_BLENDMODE_BLEND);
+	SDL_SetTextureAlphaMod(entry->texture, color.a);
+	entry->font = font;
+	entry->text = strdup(text);
+	entry->color = rgba;
+	entry->background = background;
+	entry->last_used = text_textures.tick;
+	return entry;
+}
+
+static void TextTexture_freeAll(void) {
+	if (layers.stats.text_draws) {
+		LOG_info("Text: %i draws, %i hits, %i rendered, %i evictions\n",
+			layers.stats.text_draws, layers.stats.text_hits, layers.stats.text_rendered, layers.stats.text_evictions);
+	}
+	for (int i=0; i<TEXT_TEXTURE_COUNT; i++) {
+		TextTexture_free(&text_textures.entries[i]);
+	}
+}
+
 static int text_offset = 0;
 
 int PLAT_resetScrollText(TTF_Font* font, const char* in_name,int max_width) {
@@ -1260,42 +2144,21 @@ void PLAT_scrollTextTexture(
     if (transparency > 1.0f) transparency = 1.0f;
     color.a = (Uint8)(transparency * 255);
 
-    // Render the original text only once
-    SDL_Surface* singleSur = TTF_RenderUTF8_Blended(font, in_name, color);
-    if (!singleSur) return;
-
-    int single_width = singleSur->w;
-    int single_height = singleSur->h;
-
-    // Create a surface to hold two copies side by side with padding
-    SDL_Surface* text_surface = SDL_CreateRGBSurfaceWithFormat(0,
-        single_width * 2 + padding, single_height, 32, SDL_PIXELFORMAT_RGBA8888);
+    layers.stats.text_draws += 1;
+    TextTexture* text = TextTexture_get(font, in_name, color, padding);
+    if (!text) return;
 
-    SDL_FillRect(text_surface, NULL, THEME_COLOR1);
-    SDL_BlitSurface(singleSur, NULL, text_surface, NULL);
-
-    SDL_Rect second = { single_width + padding, 0, single_width, single_height };
-    SDL_BlitSurface(singleSur, NULL, text_surface, &second);
-    SDL_FreeSurface(singleSur);
-
-    SDL_Texture* full_text_texture = SDL_CreateTextureFromSurface(vid.renderer, text_surface);
-    int full_text_width = text_surface->w;
-    SDL_FreeSurface(text_surface);
-
-    if (!full_text_texture) return;
-
-    SDL_SetTextureBlendMode(full_text_texture, SDL_BLENDMODE_BLEND);
-    SDL_SetTextureAlphaMod(full_text_texture, color.a);
+    int single_width = text->single_width;
+    int single_height = text->height;
 
     SDL_SetRenderTarget(vid.renderer, vid.target_layer4);
 
     SDL_Rect src_rect = { text_offset, 0, w, single_height };
     SDL_Rect dst_rect = { x, y, w, single_height };
 
-    SDL_RenderCopy(vid.renderer, full_text_texture, &src_rect, &dst_rect);
+    SDL_RenderCopy(vid.renderer, text->texture, &src_rect, &dst_rect);
 
     SDL_SetRenderTarget(vid.renderer, NULL);
-    SDL_DestroyTexture(full_text_texture);
 
     // Scroll only if text is wider than clip width
     if (single_width > w) {
@@ -1511,10 +2374,10 @@ void PLAT_animateAndFadeSurface(
 }
 
 void PLAT_setEffect(int next_type) {
-	effect.next_type = next_type;
+	effect.type = next_type;
 }
 void PLAT_setEffectColor(int next_color) {
-	effect.next_color = next_color;
+	effect.color = next_color;
 }
 void PLAT_vsync(int remaining) {
 	if (remaining>0) SDL_Delay(remaining);
@@ -1522,7 +2385,6 @@ void PLAT_vsync(int remaining) {
 
 scaler_t PLAT_getScaler(GFX_Renderer* renderer) {
 	// LOG_info("getScaler for scale: %i\n", renderer->scale);
-	effect.next_scale = renderer->scale;
 	return scale1x1_c16;
 }
 
@@ -1638,308 +2500,518 @@ void PLAT_flip(SDL_Surface* IGNORED, int ignored) {
 }
 
 static int frame_count = 0;
-void runShaderPass(GLuint src_texture, GLuint shader_program, GLuint* target_texture,
-                   int x, int y, int dst_width, int dst_height, Shader* shader, int alpha, int filter) {
-
-	static GLuint static_VAO = 0, static_VBO = 0;
-	static GLuint last_program = 0;
-	static GLfloat last_texelSize[2] = {-1.0f, -1.0f};
-	static GLfloat texelSize[2] = {-1.0f, -1.0f};
-	static GLuint fbo = 0;
 
-	texelSize[0] = 1.0f / shader->texw;
-	texelSize[1] = 1.0f / shader->texh;
+///////////////////////////////
+// frame timing
+
+// while the debug hud is up every stage of PLAT_GL_Swap gets a cpu timer
+// and, where EXT_disjoint_timer_query exists, a gpu timer query that's read
+// back a few frames later so it never stalls. the hud shows rolling avg/p99
+// of the most expensive stages, and totals for each chain are appended to
+// FRAME_TIMINGS_PATH when the chain changes so presets can be compared
+
+#define FRAME_TIMINGS_PATH USERDATA_PATH "/frame_timings.csv"
+#define TIMING_WINDOW 120 // frames in the rolling hud stats
+#define TIMING_LATENCY 3 // frames a gpu query gets before we read it
+#define TIMING_BUCKET_US 100
+#define TIMING_BUCKETS 1000 // up to 100ms, for p99 over everything a chain drew
+
+#ifndef GL_TIME_ELAPSED_EXT
+#define GL_TIME_ELAPSED_EXT 0x88BF
+#endif
+#ifndef GL_QUERY_RESULT_EXT
+#define GL_QUERY_RESULT_EXT 0x8866
+#endif
+#ifndef GL_QUERY_RESULT_AVAILABLE_EXT
+#define GL_QUERY_RESULT_AVAILABLE_EXT 0x8867
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+enum {
+	TIMING_UPLOAD,
+	TIMING_PASS, // one per pass, up to PRESET_MAX_PASSES
+	TIMING_SCREEN = TIMING_PASS + 8,
+	TIMING_EFFECT,
+	TIMING_OVERLAY,
+	TIMING_SWAP,
+	TIMING_STAGES,
+};
+static const char* timing_names[TIMING_STAGES] = {
+	"upload", "pass1", "pass2", "pass3", "pass4", "pass5", "pass6", "pass7", "pass8",
+	"screen", "effect", "overlay", "swap",
+};
+// the hud's bitmap font only has a handful of letters
+static const char* timing_tags[TIMING_STAGES] = {
+	"up", "p1", "p2", "p3", "p4", "p5", "p6", "p7", "p8",
+	"scr", "fx", "ov", "sw",
+};
 
+typedef struct TimingStats {
+	float window[TIMING_WINDOW]; // microseconds
+	int head;
+	int count;
+	uint32_t buckets[TIMING_BUCKETS]; // since the chain changed
+	uint64_t total;
+	int frames;
+} TimingStats;
+
+static struct {
+	int enabled;
+	int initialized;
+	int gpu; // timer queries work
+	char label[256]; // chain the totals belong to
+	TimingStats cpu[TIMING_STAGES];
+	TimingStats gpu_stats[TIMING_STAGES];
+	uint64_t started[TIMING_STAGES];
+	GLuint queries[TIMING_LATENCY][TIMING_STAGES];
+	uint32_t issued[TIMING_LATENCY]; // stages queried in that slot
+	int slot;
+	int frames;
+	
+	void (*GenQueries)(GLsizei n, GLuint* ids);
+	void (*BeginQuery)(GLenum target, GLuint id);
+	void (*EndQuery)(GLenum target);
+	void (*GetQueryObjectuiv)(GLuint id, GLenum pname, GLuint* params);
+	void (*GetQueryObjectui64v)(GLuint id, GLenum pname, uint64_t* params);
+} timing;
+
+static void Timing_init(void) {
+	timing.initialized = 1;
+	if (SDL_GL_ExtensionSupported("GL_EXT_disjoint_timer_query")) {
+		timing.GenQueries = SDL_GL_GetProcAddress("glGenQueriesEXT");
+		timing.BeginQuery = SDL_GL_GetProcAddress("glBeginQueryEXT");
+		timing.EndQuery = SDL_GL_GetProcAddress("glEndQueryEXT");
+		timing.GetQueryObjectuiv = SDL_GL_GetProcAddress("glGetQueryObjectuivEXT");
+		timing.GetQueryObjectui64v = SDL_GL_GetProcAddress("glGetQueryObjectui64vEXT");
+		timing.gpu = timing.GenQueries && timing.BeginQuery && timing.EndQuery && timing.GetQueryObjectuiv && timing.GetQueryObjectui64v;
+	}
+	if (timing.gpu) timing.GenQueries(TIMING_LATENCY * TIMING_STAGES, &timing.queries[0][0]);
+	LOG_info("Timing: gpu timer queries %s\n", timing.gpu ? "available" : "unavailable, cpu only");
+}
 
-	if (shader_program != last_program)
-    	glUseProgram(shader_program);
+static void Timing_add(TimingStats* stats, float us) {
+	stats->window[stats->head] = us;
+	stats->head = (stats->head + 1) % TIMING_WINDOW;
+	if (stats->count<TIMING_WINDOW) stats->count += 1;
+	
+	int bucket = us / TIMING_BUCKET_US;
+	stats->buckets[MIN(bucket, TIMING_BUCKETS-1)] += 1;
+	stats->total += us;
+	stats->frames += 1;
+}
+
+static int Timing_compare(const void* a, const void* b) {
+	float x = *(const float*)a;
+	float y = *(const float*)b;
+	return (x > y) - (x < y);
+}
+// in ms over the rolling window
+static void Timing_window(TimingStats* stats, float* avg, float* p99) {
+	float sorted[TIMING_WINDOW];
+	float sum = 0;
+	for (int i=0; i<stats->count; i++) sum += sorted[i] = stats->window[i];
+	qsort(sorted, stats->count, sizeof(float), Timing_compare);
+	*avg = sum / stats->count / 1000.0f;
+	*p99 = sorted[(stats->count * 99 + 99) / 100 - 1] / 1000.0f;
+}
+// in ms over everything since the chain changed
+static float Timing_p99(TimingStats* stats) {
+	uint32_t target = (stats->frames * 99 + 99) / 100;
+	uint32_t seen = 0;
+	for (int i=0; i<TIMING_BUCKETS; i++) {
+		seen += stats->buckets[i];
+		if (seen>=target) return (i + 1) * TIMING_BUCKET_US / 1000.0f;
+	}
+	return TIMING_BUCKETS * TIMING_BUCKET_US / 1000.0f;
+}
 
-	if (static_VAO == 0) {
-		glGenVertexArrays(1, &static_VAO);
-		glGenBuffers(1, &static_VBO);
-		glBindVertexArray(static_VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, static_VBO);
+static void Timing_dump(void) {
+	int frames = 0;
+	for (int i=0; i<TIMING_STAGES; i++) frames = MAX(frames, timing.cpu[i].frames);
+	if (!frames) return;
+	
+	int fresh = !exists(FRAME_TIMINGS_PATH);
+	FILE* file = fopen(FRAME_TIMINGS_PATH, "a");
+	if (!file) return;
+	if (fresh) fprintf(file, "chain,stage,frames,cpu_avg_ms,cpu_p99_ms,gpu_avg_ms,gpu_p99_ms\n");
+	for (int i=0; i<TIMING_STAGES; i++) {
+		TimingStats* cpu = &timing.cpu[i];
+		TimingStats* gpu = &timing.gpu_stats[i];
+		if (!cpu->frames) continue;
+		fprintf(file, "\"%s\",%s,%i,%.3f,%.3f", timing.label, timing_names[i], cpu->frames,
+			cpu->total / 1000.0 / cpu->frames, Timing_p99(cpu));
+		if (gpu->frames) fprintf(file, ",%.3f,%.3f\n", gpu->total / 1000.0 / gpu->frames, Timing_p99(gpu));
+		else fprintf(file, ",,\n");
+	}
+	fclose(file);
+	LOG_info("Timing: wrote %i frames of %s to " FRAME_TIMINGS_PATH "\n", frames, timing.label);
+}
+static void Timing_reset(void) {
+	for (int i=0; i<TIMING_STAGES; i++) {
+		TimingStats* stats[] = { &timing.cpu[i], &timing.gpu_stats[i] };
+		for (int j=0; j<2; j++) {
+			memset(stats[j]->buckets, 0, sizeof(stats[j]->buckets));
+			stats[j]->total = 0;
+			stats[j]->frames = 0;
+		}
+	}
+}
 
-		float vertices[] = {
-			// x,    y,    z,    w,     u,    v,    s,    t
-			-1.0f,  1.0f, 0.0f, 1.0f,  0.0f, 1.0f, 0.0f, 0.0f,  // top-left
-			-1.0f, -1.0f, 0.0f, 1.0f,  0.0f, 0.0f, 0.0f, 0.0f,  // bottom-left
-			1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 0.0f, 0.0f,  // top-right
-			1.0f, -1.0f, 0.0f, 1.0f,  1.0f, 0.0f, 0.0f, 0.0f   // bottom-right
-		};
+// called when a chain is planned, totals so far go to the file under the old label
+static void Timing_chain(const char* label) {
+	if (exactMatch(label, timing.label)) return;
+	if (timing.enabled) Timing_dump();
+	Timing_reset();
+	snprintf(timing.label, sizeof(timing.label), "%s", label);
+}
 
-		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+// the hud line: the three most expensive stages, gpu time where we have it
+static void Timing_summarize(void) {
+	int order[TIMING_STAGES];
+	float avgs[TIMING_STAGES];
+	float p99s[TIMING_STAGES];
+	int count = 0;
+	for (int i=0; i<TIMING_STAGES; i++) {
+		TimingStats* stats = timing.gpu_stats[i].count ? &timing.gpu_stats[i] : &timing.cpu[i];
+		if (!stats->count) continue;
+		Timing_window(stats, &avgs[i], &p99s[i]);
+		int j = count++;
+		while (j>0 && avgs[order[j-1]]<avgs[i]) {
+			order[j] = order[j-1];
+			j--;
+		}
+		order[j] = i;
 	}
 	
+	currentframetimings[0] = '\0';
+	int len = 0;
+	for (int i=0; i<count && i<3; i++) {
+		len += snprintf(currentframetimings+len, sizeof(currentframetimings)-len, "%s%s %.1f/%.1f",
+			i ? " " : "", timing_tags[order[i]], avgs[order[i]], p99s[order[i]]);
+		if (len>=(int)sizeof(currentframetimings)) break;
+	}
+}
 
-	if (shader_program != last_program) {
-		GLint posAttrib = glGetAttribLocation(shader_program, "VertexCoord");
-		if (posAttrib >= 0) {
-			glVertexAttribPointer(posAttrib, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-			glEnableVertexAttribArray(posAttrib);
-		}
-		GLint texAttrib = glGetAttribLocation(shader_program, "TexCoord");
-		if (texAttrib >= 0) {
-			glVertexAttribPointer(texAttrib,  4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float)));
-			glEnableVertexAttribArray(texAttrib);
-		}
+// start of every frame, collects the oldest slot's queries before reusing it
+static void Timing_frame(void) {
+	if (!timing.enabled) return;
+	if (!timing.initialized) Timing_init();
+	
+	timing.frames += 1;
+	if (timing.frames % 60==0) Timing_summarize();
+	if (!timing.gpu) return;
+	
+	timing.slot = (timing.slot + 1) % TIMING_LATENCY;
+	uint32_t issued = timing.issued[timing.slot];
+	if (!issued) return;
+	
+	// a disjoint event (clock change, power state) makes in flight results meaningless
+	GLint disjoint = 0;
+	glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+	for (int i=0; i<TIMING_STAGES; i++) {
+		if (!(issued & (1 << i))) continue;
+		GLuint query = timing.queries[timing.slot][i];
+		GLuint available = 0;
+		timing.GetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE_EXT, &available);
+		if (!available || disjoint) continue; // dropped rather than waited on
+		uint64_t ns = 0;
+		timing.GetQueryObjectui64v(query, GL_QUERY_RESULT_EXT, &ns);
+		Timing_add(&timing.gpu_stats[i], ns / 1000.0f);
+	}
+	timing.issued[timing.slot] = 0;
+}
+static void Timing_begin(int stage) {
+	if (!timing.enabled || !timing.initialized) return;
+	timing.started[stage] = getMicroseconds();
+	// swapping is the driver waiting on the display, there's no gpu work to time
+	if (timing.gpu && stage!=TIMING_SWAP) {
+		timing.BeginQuery(GL_TIME_ELAPSED_EXT, timing.queries[timing.slot][stage]);
+		timing.issued[timing.slot] |= 1 << stage;
+	}
+}
+static void Timing_end(int stage) {
+	if (!timing.enabled || !timing.initialized) return;
+	if (timing.gpu && stage!=TIMING_SWAP) timing.EndQuery(GL_TIME_ELAPSED_EXT);
+	Timing_add(&timing.cpu[stage], getMicroseconds() - timing.started[stage]);
+}
 
-		if (shader->u_FrameDirection >= 0) glUniform1i(shader->u_FrameDirection, 1);
-		if (shader->u_FrameCount >= 0) glUniform1i(shader->u_FrameCount, frame_count);
-		if (shader->u_OutputSize >= 0) glUniform2f(shader->u_OutputSize, dst_width, dst_height);
-		if (shader->u_TextureSize >= 0) glUniform2f(shader->u_TextureSize, shader->texw, shader->texh); 
-		if (shader->OrigInputSize >= 0) glUniform2f(shader->OrigInputSize, shader->srcw, shader->srch); 
-		if (shader->u_InputSize >= 0) glUniform2f(shader->u_InputSize, shader->srcw, shader->srch); 
-		for (int i = 0; i < shader->num_pragmas; ++i) {
-			glUniform1f(shader->pragmas[i].uniformLocation, shader->pragmas[i].value);
+void PLAT_setFrameTimings(int enabled) {
+	if (timing.enabled && !enabled) {
+		Timing_dump();
+		memset(timing.cpu, 0, sizeof(timing.cpu));
+		memset(timing.gpu_stats, 0, sizeof(timing.gpu_stats));
+		memset(timing.issued, 0, sizeof(timing.issued));
+		currentframetimings[0] = '\0';
+	}
+	timing.enabled = enabled;
+}
+
+///////////////////////////////
+// render graph
+
+// PLAT_GL_Swap plans the chain before drawing it. stock passes that wouldn't
+// change the image are dropped, every pass renders into a pooled target
+// matching its size and the filter its reader samples with, and when the last
+// pass already comes out at screen size it draws straight to the backbuffer
+// instead of leaving that to a g_shader_default copy
+
+#define MAX_RENDER_TARGETS 8
+#define RENDER_TARGET_IDLE_FRAMES 300 // unused targets are freed after ~5s
+
+typedef struct RenderTarget {
+	GLuint texture;
+	GLuint fbo;
+	int w;
+	int h;
+	int filter;
+	int wrap;
+	int in_use; // written this frame and not read yet
+	int last_used; // frame_count
+} RenderTarget;
+
+typedef struct RenderPass {
+	Shader* shader;
+	GLuint program;
+	int w; // output size
+	int h;
+	int filter; // how whoever reads our output samples it
+} RenderPass;
+
+static RenderTarget render_targets[MAX_RENDER_TARGETS];
+
+static struct {
+	RenderPass passes[MAXSHADERS];
+	int count;
+	int skipped; // stock passes that would just copy their input
+	int fused; // last pass draws to the backbuffer
+	int input_filter; // how the first pass samples the core's frame
+} graph;
+
+// (re)allocates only when the size changes, new storage starts out cleared
+static void RenderTarget_setup(RenderTarget* target, int w, int h, int filter, int wrap) {
+	if (target->texture && target->w==w && target->h==h && target->filter==filter && target->wrap==wrap) return;
+	
+	if (!target->texture) {
+		glGenTextures(1, &target->texture);
+		glGenFramebuffers(1, &target->fbo);
+	}
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, target->texture);
+	bound_texture = target->texture;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+	if (target->w!=w || target->h!=h) {
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glBindFramebuffer(GL_FRAMEBUFFER, target->fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+		glClear(GL_COLOR_BUFFER_BIT);
+		bound_fbo = target->fbo;
+		LOG_info("RenderTarget: %ix%i %s\n", w, h, filter==GL_LINEAR ? "linear" : "nearest");
+	}
+	target->w = w;
+	target->h = h;
+	target->filter = filter;
+	target->wrap = wrap;
+}
+static void RenderTarget_free(RenderTarget* target) {
+	if (!target->texture) return;
+	glDeleteFramebuffers(1, &target->fbo);
+	glDeleteTextures(1, &target->texture);
+	if (bound_texture==target->texture) bound_texture = 0;
+	if (bound_fbo==(GLint)target->fbo) bound_fbo = -1;
+	memset(target, 0, sizeof(RenderTarget));
+}
+
+static RenderTarget* RenderTarget_acquire(int w, int h, int filter) {
+	RenderTarget* target = NULL;
+	for (int i=0; i<MAX_RENDER_TARGETS; i++) {
+		RenderTarget* t = &render_targets[i];
+		if (t->in_use) continue;
+		if (t->texture && t->w==w && t->h==h && t->filter==filter && t->wrap==GL_CLAMP_TO_EDGE) {
+			target = t;
+			break;
 		}
+		// prefer an empty slot, then the one idle the longest
+		if (!target || (target->texture && (!t->texture || t->last_used<target->last_used))) target = t;
+	}
+	if (!target) {
+		// at most two are ever in use at once so this can't happen
+		LOG_error("RenderTarget: pool exhausted\n");
+		return NULL;
+	}
+	
+	RenderTarget_setup(target, w, h, filter, GL_CLAMP_TO_EDGE);
+	target->in_use = 1;
+	target->last_used = frame_count;
+	return target;
+}
+static void RenderTarget_release(RenderTarget* target) {
+	if (target) target->in_use = 0;
+}
+static void RenderTarget_trim(void) {
+	for (int i=0; i<MAX_RENDER_TARGETS; i++) {
+		RenderTarget* t = &render_targets[i];
+		if (!t->texture || t->in_use || frame_count-t->last_used<RENDER_TARGET_IDLE_FRAMES) continue;
+		RenderTarget_free(t);
+	}
+}
+
+// a stock pass at 1:1 samples every texel at its center so it's an exact copy
+static int RenderGraph_isCopy(Shader* shader, int src_w, int src_h, int dst_w, int dst_h) {
+	if (src_w!=dst_w || src_h!=dst_h) return 0;
+	if (!shader->shader_p) return 1; // drawn with g_noshader
+	const char* name = strrchr(shader->filename, '/');
+	name = name ? name+1 : shader->filename;
+	return exactMatch(name, "stock.glsl");
+}
 
-		GLint u_MVP = glGetUniformLocation(shader_program, "MVPMatrix");
-		if (u_MVP >= 0) {
+static void RenderGraph_report(int src_w, int src_h, SDL_Rect* dst_rect) {
+	// fill rate is what the chain writes per frame, the effect and overlay come on top
+	int64_t pixels = 0;
+	for (int i=0; i<graph.count; i++) pixels += (int64_t)graph.passes[i].w * graph.passes[i].h;
+	if (!graph.fused) pixels += (int64_t)dst_rect->w * dst_rect->h;
+	
+	int targets = 0;
+	int64_t bytes = 0;
+	for (int i=0; i<MAX_RENDER_TARGETS; i++) {
+		if (!render_targets[i].texture) continue;
+		targets += 1;
+		bytes += (int64_t)render_targets[i].w * render_targets[i].h * 4;
+	}
+	
+	char chain[256] = "";
+	for (int i=0; i<graph.count; i++) {
+		RenderPass* pass = &graph.passes[i];
+		char step[64];
+		snprintf(step, sizeof(step), "%s%s %ix%i", i ? " > " : "", pass->shader->shader_p ? pass->shader->filename : "noshader", pass->w, pass->h);
+		strncat(chain, step, sizeof(chain)-strlen(chain)-1);
+	}
+	Timing_chain(chain);
+	LOG_info("RenderGraph: %ix%i > %s%s%s (%i skipped), %i draws, %.2f Mpx/frame, %i targets %.1fMB\n",
+		src_w, src_h, chain, graph.count ? " > " : "", graph.fused ? "screen" : "default > screen", graph.skipped,
+		graph.count + !graph.fused, pixels / 1000000.0, targets, bytes / (1024.0 * 1024.0));
+}
+
+static ShaderProgram* ShaderProgram_use(GLuint program) {
+	ShaderProgram* info = bound_program;
+	if (!info || info->program != program) {
+		info = ShaderProgram_get(program);
+		glUseProgram(program);
+		gl_stats.calls += 1;
+		bound_program = info;
+	}
+	return info;
+}
+
+void runShaderPass(GLuint src_texture, GLuint shader_program, RenderTarget* target,
+                   int x, int y, int dst_width, int dst_height, Shader* shader, int alpha, int flipped) {
+
+	ShaderProgram* info = ShaderProgram_use(shader_program);
+	GLuint vao = ShaderProgram_vao(info, flipped);
+	if ((GLint)vao != bound_vao) {
+		glBindVertexArray(vao);
+		bound_vao = vao;
+		gl_stats.calls += 1;
+	}
+
+	if (!info->primed) {
+		// constant for the life of the program
+		if (info->u_MVPMatrix >= 0) {
 			float identity[16] = {
 				1,0,0,0,
 				0,1,0,0,
 				0,0,1,0,
 				0,0,0,1
 			};
-			glUniformMatrix4fv(u_MVP, 1, GL_FALSE, identity);
+			glUniformMatrix4fv(info->u_MVPMatrix, 1, GL_FALSE, identity);
+			gl_stats.uniforms += 1;
 		}
-		glBindVertexArray(static_VAO);
-	}
-	static GLuint lastfbo = -1;
-	if (target_texture) {
-		if (*target_texture==0 || shader->updated || reloadShaderTextures) { 
-			
-			// if(target_texture) {
-			// 	glDeleteTextures(1,target_texture);
-			// }
-			if(*target_texture==0)
-				glGenTextures(1, target_texture);
-			glActiveTexture(GL_TEXTURE0);	
-			glBindTexture(GL_TEXTURE_2D, *target_texture);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dst_width, dst_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-			shader->updated = 0;
+		if (info->u_FrameDirection >= 0) {
+			glUniform1i(info->u_FrameDirection, 1);
+			gl_stats.uniforms += 1;
 		}
-		if (fbo == 0) {
-			glGenFramebuffers(1, &fbo);
+		if (info->u_Texture >= 0) {
+			glUniform1i(info->u_Texture, 0);
+			gl_stats.uniforms += 1;
 		}
-		
-		if (lastfbo == 0) {
-			glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-			
-		}
-		lastfbo = fbo;
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, *target_texture, 0);
-		
-    } else {
-		// things like overlays and stuff we don't need to write to another texture so they can be directly written to screen framebuffer
-		if (lastfbo != 0) {
-        	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		info->primed = 1;
+	}
+
+	int count = shader->frame_count_mod ? frame_count % shader->frame_count_mod : frame_count;
+	if (info->u_FrameCount >= 0 && info->frame_count != count) {
+		glUniform1i(info->u_FrameCount, count);
+		info->frame_count = count;
+		gl_stats.uniforms += 1;
+	}
+	ShaderProgram_uniform2f(info->u_OutputSize, info->output_size, dst_width, dst_height);
+	ShaderProgram_uniform2f(info->u_TextureSize, info->texture_size, shader->texw, shader->texh);
+	ShaderProgram_uniform2f(info->u_OrigInputSize, info->orig_input_size,
+		shader->origw ? shader->origw : shader->srcw, shader->origw ? shader->origh : shader->srch);
+	ShaderProgram_uniform2f(info->u_InputSize, info->input_size, shader->srcw, shader->srch);
+	ShaderProgram_uniform2f(info->u_texelSize, info->texel_size, 1.0f / shader->texw, 1.0f / shader->texh);
+	// pragma locations belong to the pass's own program, not a stand-in like g_noshader
+	if (shader->shader_p == shader_program) {
+		for (int i = 0; i < shader->num_pragmas; ++i) {
+			ShaderParam* param = &shader->pragmas[i];
+			if (param->uniformLocation < 0 || info->pragmas[i] == param->value) continue;
+			glUniform1f(param->uniformLocation, param->value);
+			info->pragmas[i] = param->value;
+			gl_stats.uniforms += 1;
 		}
-		lastfbo = 0;
-    }
+	}
+
+	// things like overlays and stuff we don't need to write to another texture so they can be directly written to screen framebuffer
+	GLint fbo = target ? target->fbo : 0;
+	if (fbo != bound_fbo) {
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		bound_fbo = fbo;
+		gl_stats.calls += 1;
+	}
 
 	if(alpha==1) {
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		gl_stats.calls += 2;
+	} else if (alpha==2) { // multiplied, for masks like the lcd effect
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_DST_COLOR, GL_ZERO);
+		gl_stats.calls += 2;
 	} else {
 		glDisable(GL_BLEND);
+		gl_stats.calls += 1;
 	}
 
-	static GLuint last_bound_texture = 0;
-	if (src_texture != last_bound_texture) {
+	if (src_texture != bound_texture) {
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, src_texture);
-		last_bound_texture = src_texture;
+		bound_texture = src_texture;
+		gl_stats.calls += 2;
 	}
 	glViewport(x, y, dst_width, dst_height);
 
-	
-	if (shader->texLocation >= 0) glUniform1i(shader->texLocation, 0);  
-	
-	if (shader->texelSizeLocation >= 0) {
-		glUniform2fv(shader->texelSizeLocation, 1, texelSize);
-		last_texelSize[0] = texelSize[0];
-		last_texelSize[1] = texelSize[1];
-	}
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-	last_program = shader_program;
-}
-
-typedef struct {
-    SDL_Surface* loaded_effect;
-    SDL_Surface* loaded_overlay;
-    int effect_ready;
-    int overlay_ready;
-} FramePreparation;
-
-static FramePreparation frame_prep = {0};
-
-int prepareFrameThread(void *data) {
-    while (1) {
-		updateEffect();
-
-        if (effectUpdated) {
-			LOG_info("effect updated %s\n",effect_path);
-			if(effect_path) {
-				SDL_Surface* tmp = IMG_Load(effect_path);
-				if (tmp) {
-					frame_prep.loaded_effect = SDL_ConvertSurfaceFormat(tmp, SDL_PIXELFORMAT_RGBA32, 0);
-					SDL_FreeSurface(tmp);
-				} else {
-					frame_prep.loaded_effect = 0;
-				}
-			} else {
-				frame_prep.loaded_effect = 0;
-			}
-			effectUpdated = 0;
-			frame_prep.effect_ready = 1; 
-        }
-		if(effect.type == EFFECT_NONE && frame_prep.loaded_effect !=0) {
-			frame_prep.loaded_effect = 0;
-			frame_prep.effect_ready = 1;
-	
-		}
-
-        if (overlayUpdated) {
-
-			LOG_info("overlay updated\n");
-			if(overlay_path) {
-				SDL_Surface* tmp = IMG_Load(overlay_path);
-				if (tmp) {
-					frame_prep.loaded_overlay = SDL_ConvertSurfaceFormat(tmp, SDL_PIXELFORMAT_RGBA32, 0);
-					SDL_FreeSurface(tmp);
-				} else {
-					frame_prep.loaded_overlay = 0;
-				}
-			} else {
-				frame_prep.loaded_overlay = 0;
-			}
-			frame_prep.overlay_ready = 1;
-			overlayUpdated=0;
-        }
-
-        SDL_Delay(120); 
-    }
-    return 0;
+	gl_stats.calls += 2;
+	gl_stats.draws += 1;
 }
 
-static SDL_Thread *prepare_thread = NULL;
-
-void PLAT_GL_Swap() {
-
-	if (prepare_thread == NULL) {
-        prepare_thread = SDL_CreateThread(prepareFrameThread, "PrepareFrameThread", NULL);
-
-        if (prepare_thread == NULL) {
-            printf("Error creating background thread: %s\n", SDL_GetError());
-            return; 
-        }
-    }
-
-    static int lastframecount = 0;
-    if (reloadShaderTextures) lastframecount = frame_count;
-    if (frame_count < lastframecount + 3)
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    SDL_Rect dst_rect = {0, 0, device_width, device_height};
-    setRectToAspectRatio(&dst_rect);
-
-    if (!vid.blit->src) {
-        return;
-    }
-
-	SDL_GL_MakeCurrent(vid.window, vid.gl_context);
-
-    static GLuint effect_tex = 0;
-    static int effect_w = 0, effect_h = 0;
-    static GLuint overlay_tex = 0;
-    static int overlay_w = 0, overlay_h = 0;
-    static int overlayload = 0;
-
-
-	 if (frame_prep.effect_ready) {
-		if(frame_prep.loaded_effect) {
-			if(!effect_tex) glGenTextures(1, &effect_tex);
-			glBindTexture(GL_TEXTURE_2D, effect_tex);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, frame_prep.loaded_effect->w, frame_prep.loaded_effect->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, frame_prep.loaded_effect->pixels);
-			effect_w = frame_prep.loaded_effect->w;
-			effect_h = frame_prep.loaded_effect->h;
-		} else {
-			if (effect_tex) {
-				glDeleteTextures(1, &effect_tex);
-			}
-			effect_tex = 0;
-		}
-        frame_prep.effect_ready = 0; 
-    }
-
-    if (frame_prep.overlay_ready) {
-		if(frame_prep.loaded_overlay) {
-			if(!overlay_tex) glGenTextures(1, &overlay_tex);
-			glBindTexture(GL_TEXTURE_2D, overlay_tex);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, frame_prep.loaded_overlay->w, frame_prep.loaded_overlay->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, frame_prep.loaded_overlay->pixels);
-			overlay_w = frame_prep.loaded_overlay->w;
-			overlay_h = frame_prep.loaded_overlay->h;
-		
-		} else {
-			if (overlay_tex) {
-				glDeleteTextures(1, &overlay_tex);
-			}
-			overlay_tex = 0;
-		}
-        frame_prep.overlay_ready = 0; 
-    }
-	
+// the per-pass chain set up in the menu, the core's frame goes in and the
+// screen comes out
+static void RenderGraph_draw(SDL_Rect* dst_rect) {
     static GLuint src_texture = 0;
     static int src_w_last = 0, src_h_last = 0;
-    static int last_w = 0, last_h = 0;
-
-    if (!src_texture || reloadShaderTextures) {
-        // if (src_texture) {
-        //     glDeleteTextures(1, &src_texture);
-        //     src_texture = 0;
-        // }
-		if (src_texture==0)
-        	glGenTextures(1, &src_texture);
-        glBindTexture(GL_TEXTURE_2D, src_texture);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, nrofshaders > 0 ? shaders[0]->filter : finalScaleFilter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, nrofshaders > 0 ? shaders[0]->filter : finalScaleFilter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    }
-
-    glBindTexture(GL_TEXTURE_2D, src_texture);
-    if (vid.blit->src_w != src_w_last || vid.blit->src_h != src_h_last || reloadShaderTextures) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, vid.blit->src_w, vid.blit->src_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, vid.blit->src);
-        src_w_last = vid.blit->src_w;
-        src_h_last = vid.blit->src_h;
-    } else {
-        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, vid.blit->src_w, vid.blit->src_h, GL_RGBA, GL_UNSIGNED_BYTE, vid.blit->src);
-    }
-
-    if (nrofshaders < 1) {
-        runShaderPass(src_texture, g_shader_default, NULL, dst_rect.x, dst_rect.y,
-            dst_rect.w, dst_rect.h,
-            &(Shader){.srcw = vid.blit->src_w, .srch = vid.blit->src_h, .texw = vid.blit->src_w, .texh = vid.blit->src_h},
-            0, GL_NONE);
-    }
-
-    last_w = vid.blit->src_w;
-    last_h = vid.blit->src_h;
-
+    static int src_filter = 0;
+    int last_w = vid.blit->src_w;
+    int last_h = vid.blit->src_h;
+
+    // plan the chain, sizes only change on reload but this is cheap enough to do every frame
+    int planned = graph.count;
+    int skipped = graph.skipped;
+    graph.count = 0;
+    graph.skipped = 0;
     for (int i = 0; i < nrofshaders; i++) {
         int src_w = last_w;
         int src_h = last_h;
@@ -1947,8 +3019,8 @@ void PLAT_GL_Swap() {
         int dst_h = src_h * shaders[i]->scale;
 
         if (shaders[i]->scale == 9) {
-            dst_w = dst_rect.w;
-            dst_h = dst_rect.h;
+            dst_w = dst_rect->w;
+            dst_h = dst_rect->h;
         }
 
         if (reloadShaderTextures) {
@@ -1956,10 +3028,10 @@ void PLAT_GL_Swap() {
                 int real_input_w = (i == 0) ? vid.blit->src_w : last_w;
                 int real_input_h = (i == 0) ? vid.blit->src_h : last_h;
 
-                shaders[i]->srcw = shaders[i]->srctype == 0 ? vid.blit->src_w : shaders[i]->srctype == 2 ? dst_rect.w : real_input_w;
-                shaders[i]->srch = shaders[i]->srctype == 0 ? vid.blit->src_h : shaders[i]->srctype == 2 ? dst_rect.h : real_input_h;
-                shaders[i]->texw = shaders[i]->scaletype == 0 ? vid.blit->src_w : shaders[i]->scaletype == 2 ? dst_rect.w : real_input_w;
-                shaders[i]->texh = shaders[i]->scaletype == 0 ? vid.blit->src_h : shaders[i]->scaletype == 2 ? dst_rect.h : real_input_h;
+                shaders[i]->srcw = shaders[i]->srctype == 0 ? vid.blit->src_w : shaders[i]->srctype == 2 ? dst_rect->w : real_input_w;
+                shaders[i]->srch = shaders[i]->srctype == 0 ? vid.blit->src_h : shaders[i]->srctype == 2 ? dst_rect->h : real_input_h;
+                shaders[i]->texw = shaders[i]->scaletype == 0 ? vid.blit->src_w : shaders[i]->scaletype == 2 ? dst_rect->w : real_input_w;
+                shaders[i]->texh = shaders[i]->scaletype == 0 ? vid.blit->src_h : shaders[i]->scaletype == 2 ? dst_rect->h : real_input_h;
             }
         }
 
@@ -1980,68 +3052,972 @@ void PLAT_GL_Swap() {
         }
         shaderinfocount++;
 
-        if (shaders[i]->shader_p) {
-            runShaderPass(
-                (i == 0) ? src_texture : shaders[i - 1]->texture,
-                shaders[i]->shader_p,
-                &shaders[i]->texture,
-                0, 0, dst_w, dst_h,
-                shaders[i],
-                0,
-                (i == nrofshaders - 1) ? finalScaleFilter : shaders[i + 1]->filter
-            );
-        } else {
-            runShaderPass(
-                (i == 0) ? src_texture : shaders[i - 1]->texture,
-                g_noshader,
-                &shaders[i]->texture,
-                0, 0, dst_w, dst_h,
-                shaders[i],
-                0,
-                (i == nrofshaders - 1) ? finalScaleFilter : shaders[i + 1]->filter
-            );
+        if (RenderGraph_isCopy(shaders[i], src_w, src_h, dst_w, dst_h)) {
+            graph.skipped++;
+            continue;
         }
 
+        RenderPass* pass = &graph.passes[graph.count++];
+        pass->shader = shaders[i];
+        pass->program = shaders[i]->shader_p ? shaders[i]->shader_p : g_noshader;
+        pass->w = dst_w;
+        pass->h = dst_h;
+
         last_w = dst_w;
         last_h = dst_h;
     }
+    // each output is sampled with its reader's filter, the screen copy uses finalScaleFilter
+    for (int i = 0; i < graph.count; i++) {
+        graph.passes[i].filter = (i == graph.count - 1) ? finalScaleFilter : graph.passes[i + 1].shader->filter;
+    }
+    graph.input_filter = graph.count ? graph.passes[0].shader->filter : finalScaleFilter;
+    graph.fused = graph.count && last_w == dst_rect->w && last_h == dst_rect->h;
+    int replanned = reloadShaderTextures || planned != graph.count || skipped != graph.skipped;
 
-    if (nrofshaders > 0) {
+    if (!src_texture || src_filter != graph.input_filter) {
+		if (src_texture==0)
+        	glGenTextures(1, &src_texture);
+        glBindTexture(GL_TEXTURE_2D, src_texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, graph.input_filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, graph.input_filter);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        src_filter = graph.input_filter;
+    }
+
+    Timing_begin(TIMING_UPLOAD);
+    glBindTexture(GL_TEXTURE_2D, src_texture);
+    gl_stats.calls += 2; // bind and upload
+    if (vid.blit->src_w != src_w_last || vid.blit->src_h != src_h_last || reloadShaderTextures) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, vid.blit->src_w, vid.blit->src_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, vid.blit->src);
+        src_w_last = vid.blit->src_w;
+        src_h_last = vid.blit->src_h;
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, vid.blit->src_w, vid.blit->src_h, GL_RGBA, GL_UNSIGNED_BYTE, vid.blit->src);
+    }
+    bound_texture = src_texture;
+    Timing_end(TIMING_UPLOAD);
+
+    GLuint input = src_texture;
+    RenderTarget* input_target = NULL;
+    for (int i = 0; i < graph.count; i++) {
+        RenderPass* pass = &graph.passes[i];
+        int to_screen = graph.fused && i == graph.count - 1;
+        RenderTarget* target = to_screen ? NULL : RenderTarget_acquire(pass->w, pass->h, pass->filter);
+        if (!to_screen && !target) break;
+
+        Timing_begin(TIMING_PASS + i);
         runShaderPass(
-            shaders[nrofshaders - 1]->texture,
-            g_shader_default,
-            NULL,
-            dst_rect.x, dst_rect.y, dst_rect.w, dst_rect.h,
-            &(Shader){.srcw = last_w, .srch = last_h, .texw = last_w, .texh = last_h},
-            0, GL_NONE
+            input,
+            pass->program,
+            target,
+            to_screen ? dst_rect->x : 0, to_screen ? dst_rect->y : 0, pass->w, pass->h,
+            pass->shader,
+            0,
+            to_screen
         );
+        Timing_end(TIMING_PASS + i);
+
+        RenderTarget_release(input_target);
+        input_target = target;
+        input = target ? target->texture : 0;
     }
 
-    if (effect_tex) {
+    if (!graph.fused) {
+        Timing_begin(TIMING_SCREEN);
         runShaderPass(
-            effect_tex,
-            g_shader_overlay,
+            input,
+            g_shader_default,
             NULL,
-			dst_rect.x, dst_rect.y, effect_w, effect_h,
-            &(Shader){.srcw = effect_w, .srch = effect_h, .texw = effect_w, .texh = effect_h},
-            1, GL_NONE
+            dst_rect->x, dst_rect->y, dst_rect->w, dst_rect->h,
+            &(Shader){.srcw = last_w, .srch = last_h, .texw = last_w, .texh = last_h},
+            0, 0
         );
+        Timing_end(TIMING_SCREEN);
+    }
+    RenderTarget_release(input_target);
+    RenderTarget_trim();
+    if (replanned) RenderGraph_report(vid.blit->src_w, vid.blit->src_h, dst_rect);
+}
+
+///////////////////////////////
+// shader presets
+
+// a .glslp preset (RetroArch's multipass format) replaces the per-pass chain
+// while it's set. every pass renders into its own target so later passes can
+// read it by number or alias, a pass read as feedback keeps last frame's
+// output in a second target, Prev#Texture reads from a ring of recent core
+// frames only as deep as the shaders ask for, and LUTs are loaded once and
+// shared by every preset that names the same file until nothing holds them.
+// a new preset is built aside while the old one (or the chain) keeps
+// drawing, and swapped in once the compiler has handed over every pass
+
+#define PRESET_MAX_HISTORY 8 // the current frame plus Prev, Prev1..Prev6
+#define PRESET_MAX_LUTS 8
+#define PRESET_MAX_SAMPLERS 15 // per pass, on units 1 and up
+#define PRESET_MEMORY_BUDGET (32 * 1024 * 1024) // history is cut back to fit
+
+enum {
+	PRESET_SCALE_SOURCE,
+	PRESET_SCALE_VIEWPORT,
+	PRESET_SCALE_ABSOLUTE,
+};
+
+enum {
+	PRESET_READ_HISTORY, // n frames ago, 0 is this frame (Orig)
+	PRESET_READ_PASS, // this frame's output of pass n
+	PRESET_READ_FEEDBACK, // last frame's output of pass n
+	PRESET_READ_LUT,
+};
+
+typedef struct PresetLUT {
+	char path[MAX_PATH];
+	GLuint texture;
+	int w;
+	int h;
+	int refs;
+} PresetLUT;
+
+typedef struct PresetSampler {
+	int read;
+	int index;
+	int unit;
+	GLint u_TextureSize;
+	GLint u_InputSize;
+	GLfloat texture_size[2]; // last submitted
+	GLfloat input_size[2];
+} PresetSampler;
+
+typedef struct PresetPass {
+	Shader shader; // what runShaderPass sees, sizes are filled in every frame
+	char alias[64];
+	int scale_type[2];
+	float scale[2];
+	int filter; // how this pass samples what it reads
+	int wrap;
+	int feedback; // some pass reads last frame's output
+	PresetSampler samplers[PRESET_MAX_SAMPLERS];
+	int sampler_count;
+	RenderTarget targets[2]; // this frame's and, for feedback, last frame's
+	int current;
+	int w;
+	int h;
+} PresetPass;
+
+static PresetLUT preset_luts[PRESET_MAX_LUTS];
+
+typedef struct Preset {
+	char path[MAX_PATH];
+	PresetPass passes[PRESET_MAX_PASSES];
+	int count;
+	int building; // passes still with the compiler
+	char lut_names[PRESET_MAX_LUTS][64];
+	int luts[PRESET_MAX_LUTS]; // into preset_luts
+	int lut_count;
+	GLuint history[PRESET_MAX_HISTORY];
+	int history_wanted; // deepest Prev any pass reads, plus one
+	int history_depth; // what fit the budget
+	int history_head;
+	int history_w;
+	int history_h;
+	int history_filter;
+	int history_wrap;
+	int planned; // sizes and budget have been worked out for this frame size
+} Preset;
+
+static Preset preset; // drawing
+static Preset next_preset; // waiting on its passes
+
+// finds key = value in a .glslp, strips quotes. keys are matched whole
+static int Preset_getValue(const char* cfg, const char* key, char* value, int size) {
+	int key_len = strlen(key);
+	const char* line = cfg;
+	while (line && *line) {
+		while (*line==' ' || *line=='\t') line++;
+		if (!strncmp(line, key, key_len)) {
+			const char* tmp = line + key_len;
+			while (*tmp==' ' || *tmp=='\t') tmp++;
+			if (*tmp=='=') {
+				tmp++;
+				while (*tmp==' ' || *tmp=='\t' || *tmp=='"') tmp++;
+				int len = 0;
+				while (tmp[len] && tmp[len]!='\n' && tmp[len]!='\r' && tmp[len]!='"' && len<size-1) len++;
+				while (len && (tmp[len-1]==' ' || tmp[len-1]=='\t')) len--;
+				memcpy(value, tmp, len);
+				value[len] = '\0';
+				return 1;
+			}
+		}
+		line = strchr(line, '\n');
+		if (line) line++;
+	}
+	return 0;
+}
+static int Preset_getValueN(const char* cfg, const char* key, int n, char* value, int size) {
+	char tmp[128];
+	snprintf(tmp, sizeof(tmp), "%s%i", key, n);
+	return Preset_getValue(cfg, tmp, value, size);
+}
+static int Preset_isTrue(const char* value) {
+	return exactMatch(value, "true") || exactMatch(value, "1");
+}
+static int Preset_scaleType(const char* value) {
+	if (exactMatch(value, "viewport")) return PRESET_SCALE_VIEWPORT;
+	if (exactMatch(value, "absolute")) return PRESET_SCALE_ABSOLUTE;
+	return PRESET_SCALE_SOURCE;
+}
+static int Preset_wrapMode(const char* value) {
+	if (exactMatch(value, "repeat")) return GL_REPEAT;
+	if (exactMatch(value, "mirrored_repeat")) return GL_MIRRORED_REPEAT;
+	return GL_CLAMP_TO_EDGE; // also stands in for clamp_to_border which es doesn't have
+}
+
+static int PresetLUT_acquire(const char* path, int filter, int wrap) {
+	int slot = -1;
+	for (int i=0; i<PRESET_MAX_LUTS; i++) {
+		if (preset_luts[i].refs && exactMatch(preset_luts[i].path, path)) {
+			preset_luts[i].refs += 1;
+			return i;
+		}
+		if (slot<0 && !preset_luts[i].refs) slot = i;
+	}
+	if (slot<0) {
+		LOG_error("Preset: too many LUTs, skipping %s\n", path);
+		return -1;
+	}
+	
+	SDL_Surface* tmp = IMG_Load(path);
+	if (!tmp) {
+		LOG_error("Preset: failed to load LUT %s (%s)\n", path, IMG_GetError());
+		return -1;
+	}
+	SDL_Surface* image = SDL_ConvertSurfaceFormat(tmp, SDL_PIXELFORMAT_RGBA32, 0);
+	SDL_FreeSurface(tmp);
+	if (!image) return -1;
+	
+	PresetLUT* lut = &preset_luts[slot];
+	strncpy(lut->path, path, sizeof(lut->path)-1);
+	lut->w = image->w;
+	lut->h = image->h;
+	lut->refs = 1;
+	glGenTextures(1, &lut->texture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, lut->texture);
+	bound_texture = lut->texture;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image->w, image->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, image->pixels);
+	SDL_FreeSurface(image);
+	LOG_info("Preset: loaded LUT %s %ix%i\n", path, lut->w, lut->h);
+	return slot;
+}
+static void PresetLUT_release(int slot) {
+	if (slot<0) return;
+	PresetLUT* lut = &preset_luts[slot];
+	if (--lut->refs>0) return;
+	if (bound_texture==lut->texture) bound_texture = 0;
+	glDeleteTextures(1, &lut->texture);
+	memset(lut, 0, sizeof(PresetLUT));
+}
+
+static void Preset_free(Preset* preset) {
+	for (int i=0; i<preset->count; i++) {
+		PresetPass* pass = &preset->passes[i];
+		if (pass->shader.shader_p) {
+			ShaderProgram_forget(pass->shader.shader_p);
+			glDeleteProgram(pass->shader.shader_p);
+		}
+		RenderTarget_free(&pass->targets[0]);
+		RenderTarget_free(&pass->targets[1]);
+		free(pass->shader.pragmas);
+		free(pass->shader.filename);
+	}
+	for (int i=0; i<preset->lut_count; i++) PresetLUT_release(preset->luts[i]);
+	for (int i=0; i<PRESET_MAX_HISTORY; i++) {
+		if (!preset->history[i]) continue;
+		if (bound_texture==preset->history[i]) bound_texture = 0;
+		glDeleteTextures(1, &preset->history[i]);
+	}
+	memset(preset, 0, sizeof(Preset));
+}
+
+// works out what a sampler uniform reads, by RetroArch's glsl names. Pass#
+// and PassFeedback# count passes from 1, PassPrev# counts back from this one
+static int Preset_bindSampler(int pass_index, const char* name, PresetSampler* sampler) {
+	int len = strlen(name);
+	if (len<=7 || strcmp(name+len-7, "Texture")) {
+		for (int i=0; i<preset.lut_count; i++) {
+			if (preset.luts[i]<0 || !exactMatch(name, preset.lut_names[i])) continue;
+			sampler->read = PRESET_READ_LUT;
+			sampler->index = preset.luts[i];
+			return 1;
+		}
+		return 0;
+	}
+	
+	char prefix[64];
+	snprintf(prefix, sizeof(prefix), "%.*s", len-7, name);
+	int n = 0;
+	if (exactMatch(prefix, "Orig")) {
+		sampler->read = PRESET_READ_HISTORY;
+		sampler->index = 0;
+	}
+	else if (exactMatch(prefix, "Prev")) {
+		sampler->read = PRESET_READ_HISTORY;
+		sampler->index = 1;
+	}
+	else if (sscanf(prefix, "PassPrev%i", &n)==1) {
+		int index = pass_index - n;
+		if (index<-1) return 0;
+		sampler->read = index<0 ? PRESET_READ_HISTORY : PRESET_READ_PASS;
+		sampler->index = index<0 ? 0 : index;
+	}
+	else if (sscanf(prefix, "PassFeedback%i", &n)==1) {
+		if (n<1 || n>preset.count) return 0;
+		sampler->read = PRESET_READ_FEEDBACK;
+		sampler->index = n-1;
+	}
+	else if (sscanf(prefix, "Pass%i", &n)==1) {
+		if (n<1 || n>pass_index) return 0; // can only read passes that already ran
+		sampler->read = PRESET_READ_PASS;
+		sampler->index = n-1;
+	}
+	else if (sscanf(prefix, "Prev%i", &n)==1) {
+		if (n<1 || n+1>=PRESET_MAX_HISTORY) return 0;
+		sampler->read = PRESET_READ_HISTORY;
+		sampler->index = n+1;
+	}
+	else {
+		int found = 0;
+		for (int i=0; i<preset.count && !found; i++) {
+			PresetPass* pass = &preset.passes[i];
+			if (!pass->alias[0]) continue;
+			int alias_len = strlen(pass->alias);
+			if (strncmp(prefix, pass->alias, alias_len)) continue;
+			if (!prefix[alias_len] && i<pass_index) {
+				sampler->read = PRESET_READ_PASS;
+				sampler->index = i;
+				found = 1;
+			}
+			else if (exactMatch(prefix+alias_len, "Feedback")) {
+				sampler->read = PRESET_READ_FEEDBACK;
+				sampler->index = i;
+				found = 1;
+			}
+		}
+		if (!found) return 0;
+	}
+	
+	GLuint program = preset.passes[pass_index].shader.shader_p;
+	char uniform[128];
+	snprintf(uniform, sizeof(uniform), "%sTextureSize", prefix);
+	sampler->u_TextureSize = glGetUniformLocation(program, uniform);
+	snprintf(uniform, sizeof(uniform), "%sInputSize", prefix);
+	sampler->u_InputSize = glGetUniformLocation(program, uniform);
+	return 1;
+}
+
+static void Preset_reflect(int pass_index) {
+	PresetPass* pass = &preset.passes[pass_index];
+	GLuint program = pass->shader.shader_p;
+	if (!program) return;
+	
+	GLint count = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+	for (int i=0; i<count && pass->sampler_count<PRESET_MAX_SAMPLERS; i++) {
+		char name[128];
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(program, i, sizeof(name), NULL, &size, &type, name);
+		if (type!=GL_SAMPLER_2D || exactMatch(name, "Texture")) continue;
+		
+		PresetSampler* sampler = &pass->samplers[pass->sampler_count];
+		memset(sampler, 0, sizeof(PresetSampler));
+		if (!Preset_bindSampler(pass_index, name, sampler)) {
+			LOG_info("Preset: pass %i samples %s which we don't provide\n", pass_index, name);
+			continue;
+		}
+		sampler->unit = ++pass->sampler_count;
+		sampler->texture_size[0] = sampler->input_size[0] = NAN;
+		
+		// units never change so they're set once
+		ShaderProgram_use(program);
+		glUniform1i(glGetUniformLocation(program, name), sampler->unit);
+		
+		if (sampler->read==PRESET_READ_HISTORY && sampler->index+1>preset.history_wanted) preset.history_wanted = sampler->index+1;
+		if (sampler->read==PRESET_READ_FEEDBACK) preset.passes[sampler->index].feedback = 1;
+	}
+}
+
+int PLAT_setShaderPreset(const char* path) {
+	SDL_GL_MakeCurrent(vid.window, vid.gl_context);
+	
+	if (!path || (preset.count && exactMatch(path, preset.path))) { // nothing new to build
+		ShaderCompiler_discardPreset();
+		Preset_free(&next_preset);
+	}
+	if (!path) {
+		if (preset.count) LOG_info("Preset: cleared %s\n", preset.path);
+		Preset_free(&preset);
+		reloadShaderTextures = 1;
+		return 0;
+	}
+	if (preset.count && exactMatch(path, preset.path)) return 0;
+	if (next_preset.count && exactMatch(path, next_preset.path)) return 0;
+	
+	char* cfg = load_shader_source(path);
+	if (!cfg) return -1;
+	
+	char value[MAX_PATH];
+	char dir[MAX_PATH];
+	strncpy(dir, path, sizeof(dir)-1);
+	dir[sizeof(dir)-1] = '\0';
+	char* slash = strrchr(dir, '/');
+	if (slash) *slash = '\0';
+	else strcpy(dir, ".");
+	
+	int count = Preset_getValue(cfg, "shaders", value, sizeof(value)) ? atoi(value) : 0;
+	if (count<1) {
+		LOG_error("Preset: %s has no shaders\n", path);
+		free(cfg);
+		return -1;
+	}
+	if (count>PRESET_MAX_PASSES) { // leaving passes out would draw something else entirely
+		LOG_error("Preset: %s has %i passes, at most %i are supported\n", path, count, PRESET_MAX_PASSES);
+		free(cfg);
+		return -1;
+	}
+	
+	// take the new preset's LUTs before dropping the old ones so shared ones stay uploaded
+	char lut_names[PRESET_MAX_LUTS][64];
+	int luts[PRESET_MAX_LUTS];
+	int lut_count = 0;
+	char textures[512];
+	if (Preset_getValue(cfg, "textures", textures, sizeof(textures))) {
+		char* save = NULL;
+		for (char* name=strtok_r(textures, ";", &save); name && lut_count<PRESET_MAX_LUTS; name=strtok_r(NULL, ";", &save)) {
+			char lut_path[MAX_PATH];
+			if (!Preset_getValue(cfg, name, value, sizeof(value))) continue;
+			snprintf(lut_path, sizeof(lut_path), "%s/%s", dir, value);
+			
+			char key[128];
+			snprintf(key, sizeof(key), "%s_linear", name);
+			int filter = Preset_getValue(cfg, key, value, sizeof(value)) && Preset_isTrue(value) ? GL_LINEAR : GL_NEAREST;
+			snprintf(key, sizeof(key), "%s_wrap_mode", name);
+			int wrap = Preset_getValue(cfg, key, value, sizeof(value)) ? Preset_wrapMode(value) : GL_CLAMP_TO_EDGE;
+			
+			snprintf(lut_names[lut_count], sizeof(lut_names[0]), "%s", name);
+			luts[lut_count++] = PresetLUT_acquire(lut_path, filter, wrap);
+		}
+	}
+	
+	ShaderCompiler_discardPreset();
+	Preset_free(&next_preset);
+	strncpy(next_preset.path, path, sizeof(next_preset.path)-1);
+	memcpy(next_preset.lut_names, lut_names, sizeof(lut_names));
+	memcpy(next_preset.luts, luts, sizeof(luts));
+	next_preset.lut_count = lut_count;
+	next_preset.count = count;
+	
+	for (int i=0; i<count; i++) {
+		PresetPass* pass = &next_preset.passes[i];
+		if (!Preset_getValueN(cfg, "shader", i, value, sizeof(value))) {
+			LOG_error("Preset: %s is missing shader%i\n", path, i);
+			Preset_free(&next_preset);
+			free(cfg);
+			return -1;
+		}
+		pass->shader.filename = strdup(value);
+		
+		char key[128];
+		int filter_set = Preset_getValueN(cfg, "filter_linear", i, value, sizeof(value));
+		// unset follows the sharpness setting like retroarch follows its smooth option
+		pass->filter = !filter_set ? finalScaleFilter : Preset_isTrue(value) ? GL_LINEAR : GL_NEAREST;
+		pass->wrap = Preset_getValueN(cfg, "wrap_mode", i, value, sizeof(value)) ? Preset_wrapMode(value) : GL_CLAMP_TO_EDGE;
+		if (Preset_getValueN(cfg, "alias", i, value, sizeof(value))) snprintf(pass->alias, sizeof(pass->alias), "%s", value);
+		if (Preset_getValueN(cfg, "frame_count_mod", i, value, sizeof(value))) pass->shader.frame_count_mod = atoi(value);
+		if ((Preset_getValueN(cfg, "float_framebuffer", i, value, sizeof(value)) && Preset_isTrue(value)) ||
+			(Preset_getValueN(cfg, "srgb_framebuffer", i, value, sizeof(value)) && Preset_isTrue(value))) {
+			LOG_info("Preset: pass %i wants a float/srgb framebuffer, using rgba8\n", i);
+		}
+		
+		// unscaled last pass goes straight to the viewport, everything else defaults to 1x source
+		int scaled = 0;
+		for (int axis=0; axis<2; axis++) {
+			pass->scale_type[axis] = i==count-1 ? PRESET_SCALE_VIEWPORT : PRESET_SCALE_SOURCE;
+			pass->scale[axis] = 1.0f;
+		}
+		if (Preset_getValueN(cfg, "scale_type", i, value, sizeof(value))) {
+			pass->scale_type[0] = pass->scale_type[1] = Preset_scaleType(value);
+			scaled = 1;
+		}
+		const char* axis_types[] = {"scale_type_x", "scale_type_y"};
+		const char* axis_scales[] = {"scale_x", "scale_y"};
+		for (int axis=0; axis<2; axis++) {
+			if (Preset_getValueN(cfg, axis_types[axis], i, value, sizeof(value))) {
+				pass->scale_type[axis] = Preset_scaleType(value);
+				scaled = 1;
+			}
+		}
+		if (scaled) {
+			if (Preset_getValueN(cfg, "scale", i, value, sizeof(value))) pass->scale[0] = pass->scale[1] = strtof(value, NULL);
+			for (int axis=0; axis<2; axis++) {
+				if (Preset_getValueN(cfg, axis_scales[axis], i, value, sizeof(value))) pass->scale[axis] = strtof(value, NULL);
+			}
+		}
+		
+		char file[MAX_PATH];
+		snprintf(file, sizeof(file), "%s/%s", dir, pass->shader.filename);
+		char* source = load_shader_source(file);
+		if (source) {
+			loadShaderPragmas(&pass->shader, source);
+			free(source);
+		}
+		for (int j=0; j<pass->shader.num_pragmas; j++) {
+			ShaderParam* param = &pass->shader.pragmas[j];
+			param->value = param->def;
+			// presets can override parameters by name
+			if (Preset_getValue(cfg, param->name, value, sizeof(value))) param->value = strtof(value, NULL);
+		}
+	}
+	free(cfg);
+	
+	// passes only come back through ShaderCompiler_poll on this thread, so
+	// none can be adopted before all of them are counted
+	next_preset.building = count;
+	for (int i=0; i<count; i++) {
+		PresetPass* pass = &next_preset.passes[i];
+		if (!ShaderCompiler_submit(i, 1, pass->shader.filename, dir)) {
+			Preset_adoptPass(i, load_program_from_file(pass->shader.filename, dir), pass->shader.filename);
+		}
+	}
+	return 0;
+}
+
+static void Preset_activate(void) { // render thread, once every pass of next_preset is adopted
+	Preset_free(&preset);
+	preset = next_preset;
+	memset(&next_preset, 0, sizeof(Preset));
+	
+	// needs every alias known first
+	for (int i=0; i<preset.count; i++) Preset_reflect(i);
+	
+	preset.history_wanted = MAX(1, preset.history_wanted);
+	reloadShaderTextures = 1;
+	LOG_info("Preset: loaded %s, %i passes, %i LUTs, %i frames of history\n", preset.path, preset.count, preset.lut_count, preset.history_wanted);
+}
+static void Preset_adoptPass(int pass, GLuint program, const char* filename) {
+	if (pass>=next_preset.count || !next_preset.building) { // shouldn't happen, the generation guards it
+		if (program) glDeleteProgram(program);
+		return;
+	}
+	Shader_adopt(&next_preset.passes[pass].shader, program, filename);
+	next_preset.building -= 1;
+	if (!next_preset.building) Preset_activate();
+}
+
+static void Preset_warm(const char* path) {
+	char* cfg = load_shader_source(path);
+	if (!cfg) return;
+	
+	char dir[MAX_PATH];
+	snprintf(dir, sizeof(dir), "%s", path);
+	char* slash = strrchr(dir, '/');
+	if (slash) *slash = '\0';
+	else strcpy(dir, ".");
+	
+	char value[MAX_PATH];
+	int count = Preset_getValue(cfg, "shaders", value, sizeof(value)) ? atoi(value) : 0;
+	for (int i=0; i<count && i<PRESET_MAX_PASSES; i++) {
+		if (Preset_getValueN(cfg, "shader", i, value, sizeof(value))) ShaderCompiler_submit(-1, 0, value, dir);
+	}
+	free(cfg);
+}
+
+static int Preset_size(int type, float scale, int source, int viewport) {
+	if (type==PRESET_SCALE_ABSOLUTE) return MAX(1, (int)scale);
+	return MAX(1, (int)((type==PRESET_SCALE_VIEWPORT ? viewport : source) * scale + 0.5f));
+}
+
+// sizes every pass for this frame size and trims history to fit the budget
+static void Preset_plan(int src_w, int src_h, SDL_Rect* dst_rect) {
+	int w = src_w;
+	int h = src_h;
+	int64_t bytes = 0;
+	int64_t pixels = 0;
+	for (int i=0; i<preset.count; i++) {
+		PresetPass* pass = &preset.passes[i];
+		pass->w = w = Preset_size(pass->scale_type[0], pass->scale[0], w, dst_rect->w);
+		pass->h = h = Preset_size(pass->scale_type[1], pass->scale[1], h, dst_rect->h);
+		bytes += (int64_t)w * h * 4 * (pass->feedback ? 2 : 1);
+		pixels += (int64_t)w * h;
+	}
+	for (int i=0; i<preset.lut_count; i++) {
+		if (preset.luts[i]>=0) bytes += (int64_t)preset_luts[preset.luts[i]].w * preset_luts[preset.luts[i]].h * 4;
+	}
+	
+	int64_t frame = (int64_t)src_w * src_h * 4;
+	int depth = preset.history_wanted;
+	while (depth>1 && bytes + depth * frame > PRESET_MEMORY_BUDGET) depth--;
+	if (depth<preset.history_wanted) LOG_info("Preset: keeping %i of %i history frames to stay under %iMB\n", depth, preset.history_wanted, PRESET_MEMORY_BUDGET / (1024 * 1024));
+	for (int i=depth; i<PRESET_MAX_HISTORY; i++) {
+		if (!preset.history[i]) continue;
+		if (bound_texture==preset.history[i]) bound_texture = 0;
+		glDeleteTextures(1, &preset.history[i]);
+		preset.history[i] = 0;
+	}
+	preset.history_depth = depth;
+	preset.history_head %= depth;
+	bytes += depth * frame;
+	
+	PresetPass* last = &preset.passes[preset.count-1];
+	int fused = last->w==dst_rect->w && last->h==dst_rect->h && !last->feedback;
+	if (!fused) pixels += (int64_t)dst_rect->w * dst_rect->h;
+	const char* name = strrchr(preset.path, '/');
+	char label[MAX_PATH];
+	snprintf(label, sizeof(label), "%s %ix%i", name ? name+1 : preset.path, src_w, src_h);
+	Timing_chain(label);
+	LOG_info("Preset: %s at %ix%i, %i draws, %.2f Mpx/frame, %.1fMB\n", name ? name+1 : preset.path, src_w, src_h,
+		preset.count + !fused, pixels / 1000000.0, bytes / (1024.0 * 1024.0));
+}
+
+static void Preset_draw(SDL_Rect* dst_rect) {
+	int src_w = vid.blit->src_w;
+	int src_h = vid.blit->src_h;
+	int resized = src_w!=preset.history_w || src_h!=preset.history_h;
+	if (!preset.planned || resized || reloadShaderTextures) {
+		Preset_plan(src_w, src_h, dst_rect);
+		preset.planned = 1;
+	}
+	
+	// the core's frame goes into the history ring, no copy needed to keep it around
+	preset.history_head = (preset.history_head + 1) % preset.history_depth;
+	GLuint* frame = &preset.history[preset.history_head];
+	int filter = preset.passes[0].filter;
+	int wrap = preset.passes[0].wrap;
+	int changed = resized || filter!=preset.history_filter || wrap!=preset.history_wrap;
+	for (int i=0; i<preset.history_depth; i++) {
+		// fresh ones are new or the ring grew back after a budget cut
+		int fresh = !preset.history[i];
+		if (!fresh && !changed) continue;
+		if (fresh) glGenTextures(1, &preset.history[i]);
+		glBindTexture(GL_TEXTURE_2D, preset.history[i]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+		if (fresh || resized) glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, src_w, src_h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	}
+	preset.history_w = src_w;
+	preset.history_h = src_h;
+	preset.history_filter = filter;
+	preset.history_wrap = wrap;
+	Timing_begin(TIMING_UPLOAD);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, *frame);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, src_w, src_h, GL_RGBA, GL_UNSIGNED_BYTE, vid.blit->src);
+	bound_texture = *frame;
+	gl_stats.calls += 3;
+	Timing_end(TIMING_UPLOAD);
+	
+	GLuint input = *frame;
+	int in_w = src_w;
+	int in_h = src_h;
+	for (int i=0; i<preset.count; i++) {
+		PresetPass* pass = &preset.passes[i];
+		int last = i==preset.count-1;
+		int to_screen = last && pass->w==dst_rect->w && pass->h==dst_rect->h && !pass->feedback;
+		
+		RenderTarget* target = NULL;
+		if (!to_screen) {
+			if (pass->feedback) pass->current ^= 1;
+			target = &pass->targets[pass->current];
+			int filter = last ? finalScaleFilter : preset.passes[i+1].filter;
+			int wrap = last ? GL_CLAMP_TO_EDGE : preset.passes[i+1].wrap;
+			RenderTarget_setup(target, pass->w, pass->h, filter, wrap);
+			if (pass->feedback) RenderTarget_setup(&pass->targets[pass->current^1], pass->w, pass->h, filter, wrap);
+		}
+		
+		// everything besides Texture goes on units 1 and up
+		Timing_begin(TIMING_PASS + i);
+		ShaderProgram_use(pass->shader.shader_p);
+		for (int j=0; j<pass->sampler_count; j++) {
+			PresetSampler* sampler = &pass->samplers[j];
+			GLuint texture = 0;
+			int w = 0, h = 0;
+			if (sampler->read==PRESET_READ_HISTORY) {
+				int index = MIN(sampler->index, preset.history_depth-1);
+				texture = preset.history[(preset.history_head - index + preset.history_depth) % preset.history_depth];
+				w = src_w;
+				h = src_h;
+			}
+			else if (sampler->read==PRESET_READ_LUT) {
+				texture = preset_luts[sampler->index].texture;
+				w = preset_luts[sampler->index].w;
+				h = preset_luts[sampler->index].h;
+			}
+			else {
+				PresetPass* other = &preset.passes[sampler->index];
+				// passes toggle when they run, so last frame's output is only behind current for ones that already have
+				int which = other->current;
+				if (sampler->read==PRESET_READ_FEEDBACK && sampler->index<=i) which ^= 1;
+				texture = other->targets[which].texture;
+				w = other->w;
+				h = other->h;
+			}
+			glActiveTexture(GL_TEXTURE0 + sampler->unit);
+			glBindTexture(GL_TEXTURE_2D, texture);
+			gl_stats.calls += 2;
+			ShaderProgram_uniform2f(sampler->u_TextureSize, sampler->texture_size, w, h);
+			ShaderProgram_uniform2f(sampler->u_InputSize, sampler->input_size, w, h);
+		}
+		if (pass->sampler_count) {
+			glActiveTexture(GL_TEXTURE0);
+			gl_stats.calls += 1;
+		}
+		
+		pass->shader.srcw = pass->shader.texw = in_w;
+		pass->shader.srch = pass->shader.texh = in_h;
+		pass->shader.origw = src_w;
+		pass->shader.origh = src_h;
+		runShaderPass(
+			input,
+			pass->shader.shader_p ? pass->shader.shader_p : g_noshader,
+			target,
+			to_screen ? dst_rect->x : 0, to_screen ? dst_rect->y : 0, pass->w, pass->h,
+			&pass->shader,
+			0,
+			to_screen
+		);
+		Timing_end(TIMING_PASS + i);
+		
+		input = target ? target->texture : 0;
+		in_w = pass->w;
+		in_h = pass->h;
+		if (to_screen) return;
+	}
+	
+	Timing_begin(TIMING_SCREEN);
+	runShaderPass(
+		input,
+		g_shader_default,
+		NULL,
+		dst_rect->x, dst_rect->y, dst_rect->w, dst_rect->h,
+		&(Shader){.srcw = in_w, .srch = in_h, .texw = in_w, .texh = in_h},
+		0, 0
+	);
+	Timing_end(TIMING_SCREEN);
+}
+
+///////////////////////////////
+// screen effects
+
+// line, grid and lcd are drawn over the game rect by effect.glsl and lcd.glsl
+// instead of tiling a png per integer scale. the pattern follows the real
+// scale of the game's pixels so fractional and large scales still line up.
+// line and grid blend their colour over the game, lcd multiplies it by a
+// subpixel mask
+
+#define EFFECT_MIN_SCALE 2.0f // below this a pattern per game pixel is just noise
+#define EFFECT_LCD_INTENSITY 0.5f
+#define EFFECT_LCD_LAYOUT 0 // 0 rgb, 1 bgr
+
+typedef struct EffectProgram {
+	GLuint program;
+	GLint u_EffectScale;
+	GLint u_EffectBand;
+	GLint u_EffectIntensity;
+	GLint u_EffectColor;
+	GLint u_EffectLayout;
+	// last submitted
+	float scale[2];
+	float band[2];
+	float intensity;
+	float color[3];
+	float layout;
+} EffectProgram;
+
+static EffectProgram effect_programs[2]; // blended and multiplied
+
+static EffectProgram* EffectProgram_get(int slot, GLuint program) {
+	EffectProgram* info = &effect_programs[slot];
+	if (info->program==program) return info;
+	
+	info->program = program;
+	info->u_EffectScale = glGetUniformLocation(program, "EffectScale");
+	info->u_EffectBand = glGetUniformLocation(program, "EffectBand");
+	info->u_EffectIntensity = glGetUniformLocation(program, "EffectIntensity");
+	info->u_EffectColor = glGetUniformLocation(program, "EffectColor");
+	info->u_EffectLayout = glGetUniformLocation(program, "EffectLayout");
+	info->scale[0] = info->scale[1] = NAN;
+	info->band[0] = info->band[1] = NAN;
+	info->intensity = NAN;
+	info->color[0] = info->color[1] = info->color[2] = NAN;
+	info->layout = NAN;
+	return info;
+}
+
+// thickness of a grid line or lcd row gap, matches the old grid-N.png
+static float Effect_edge(float scale) {
+	float edge = floorf(scale * 0.25f + 0.5f);
+	return edge<1 ? 1 : edge;
+}
+
+static void Effect_draw(SDL_Rect* dst_rect) {
+	int lcd = effect.type==EFFECT_LCD;
+	GLuint program = lcd ? g_shader_lcd : g_shader_effect;
+	if (!program) return;
+	
+	float scale_x = (float)dst_rect->w / vid.blit->src_w;
+	float scale_y = (float)dst_rect->h / vid.blit->src_h;
+	if (scale_x<EFFECT_MIN_SCALE) scale_x = EFFECT_MIN_SCALE;
+	if (scale_y<EFFECT_MIN_SCALE) scale_y = EFFECT_MIN_SCALE;
+	
+	float band_x = 0; // line only darkens rows
+	float band_y = scale_y * 0.5f;
+	float intensity = 1.0f;
+	float color[3] = {0,0,0};
+	if (effect.type==EFFECT_GRID) {
+		band_x = Effect_edge(scale_x);
+		band_y = Effect_edge(scale_y);
+		if (effect.color) {
+			uint8_t r,g,b;
+			rgb565_to_rgb888(effect.color, &r,&g,&b);
+			color[0] = r / 255.0f;
+			color[1] = g / 255.0f;
+			color[2] = b / 255.0f;
+		}
+	}
+	else if (lcd) {
+		band_x = scale_x / 3.0f; // a stripe per channel
+		band_y = Effect_edge(scale_y);
+		intensity = EFFECT_LCD_INTENSITY;
+	}
+	
+	EffectProgram* info = EffectProgram_get(lcd, program);
+	ShaderProgram_use(program);
+	ShaderProgram_uniform2f(info->u_EffectScale, info->scale, scale_x, scale_y);
+	ShaderProgram_uniform2f(info->u_EffectBand, info->band, band_x, band_y);
+	if (info->u_EffectIntensity>=0 && info->intensity!=intensity) {
+		glUniform1f(info->u_EffectIntensity, intensity);
+		info->intensity = intensity;
+		gl_stats.uniforms += 1;
+	}
+	if (info->u_EffectColor>=0 && memcmp(info->color, color, sizeof(color))) {
+		glUniform3fv(info->u_EffectColor, 1, color);
+		memcpy(info->color, color, sizeof(color));
+		gl_stats.uniforms += 1;
+	}
+	if (info->u_EffectLayout>=0 && info->layout!=EFFECT_LCD_LAYOUT) {
+		glUniform1f(info->u_EffectLayout, EFFECT_LCD_LAYOUT);
+		info->layout = EFFECT_LCD_LAYOUT;
+		gl_stats.uniforms += 1;
+	}
+	
+	// nothing is sampled, leave whatever is bound alone
+	runShaderPass(
+		bound_texture,
+		program,
+		NULL,
+		dst_rect->x, dst_rect->y, dst_rect->w, dst_rect->h,
+		&(Shader){.srcw = vid.blit->src_w, .srch = vid.blit->src_h, .texw = vid.blit->src_w, .texh = vid.blit->src_h},
+		lcd ? 2 : 1, 0
+	);
+}
+
+void PLAT_GL_Swap() {
+
+	FramePrep_init();
+
+    static int lastframecount = 0;
+    if (reloadShaderTextures) lastframecount = frame_count;
+    if (frame_count < lastframecount + 3)
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    SDL_Rect dst_rect = {0, 0, device_width, device_height};
+    setRectToAspectRatio(&dst_rect);
+
+    if (!vid.blit->src) {
+        return;
+    }
+
+	SDL_GL_MakeCurrent(vid.window, vid.gl_context);
+	ShaderCompiler_poll();
+	Timing_frame();
+
+    static GLuint overlay_tex = 0;
+    static int overlay_w = 0, overlay_h = 0;
+
+	SDL_LockMutex(prep.lock);
+	PrepImage* overlay_image = prep.overlay_ready ? prep.overlay : NULL;
+	int overlay_ready = prep.overlay_ready;
+	prep.overlay_ready = 0;
+	SDL_UnlockMutex(prep.lock);
+
+	// the image stays referenced, so cached, until it's uploaded
+    if (overlay_ready) {
+		if (overlay_image) {
+			SDL_Surface* loaded_overlay = overlay_image->surface;
+			if(!overlay_tex) glGenTextures(1, &overlay_tex);
+			glBindTexture(GL_TEXTURE_2D, overlay_tex);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, loaded_overlay->w, loaded_overlay->h, 0, GL_RGBA, GL_UNSIGNED_BYTE, loaded_overlay->pixels);
+			overlay_w = loaded_overlay->w;
+			overlay_h = loaded_overlay->h;
+			bound_texture = overlay_tex;
+		
+		} else {
+			if (overlay_tex) {
+				if (bound_texture==overlay_tex) bound_texture = 0;
+				glDeleteTextures(1, &overlay_tex);
+			}
+			overlay_tex = 0;
+		}
+    }
+
+	if (overlay_image) {
+		SDL_LockMutex(prep.lock);
+		PrepImage_release(overlay_image);
+		SDL_UnlockMutex(prep.lock);
+	}
+	
+    if (preset.count) Preset_draw(&dst_rect);
+    else RenderGraph_draw(&dst_rect);
+
+    if (effect.type != EFFECT_NONE) {
+        Timing_begin(TIMING_EFFECT);
+        Effect_draw(&dst_rect);
+        Timing_end(TIMING_EFFECT);
     }
 
     if (overlay_tex) {
+        Timing_begin(TIMING_OVERLAY);
         runShaderPass(
             overlay_tex,
             g_shader_overlay,
             NULL,
             0, 0, device_width, device_height,
             &(Shader){.srcw = vid.blit->src_w, .srch = vid.blit->src_h, .texw = overlay_w, .texh = overlay_h},
-            1, GL_NONE
+            1, 0
         );
+        Timing_end(TIMING_OVERLAY);
     }
 
+    Timing_begin(TIMING_SWAP);
     SDL_GL_SwapWindow(vid.window);
+    Timing_end(TIMING_SWAP);
     frame_count++;
     reloadShaderTextures = 0;
+
+    currentglcalls = gl_stats.calls + gl_stats.uniforms;
+    currentgluniforms = gl_stats.uniforms;
+    currentgldraws = gl_stats.draws;
+    memset(&gl_stats, 0, sizeof(gl_stats));
 }
 
 